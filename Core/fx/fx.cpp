@@ -1,11 +1,18 @@
 #include "fx.h"
 #include "common.h"
+#include "fx_autowah.hpp"
 #include "fx_chorus.hpp"
+#include "fx_compressor.hpp"
 #include "fx_delay.hpp"
+#include "fx_mod.hpp"
 #include "fx_overdrive.hpp"
 #include "fx_phaser.hpp"
 #include "fx_reverb.hpp"
 #include "fx_tremolo.hpp"
+#include "lib_snapshot.hpp"
+#include "main.h" // DWT
+#include <algorithm>
+#include <cmath>
 
 namespace {
 /// オーバードライブ
@@ -20,29 +27,275 @@ fx::chorus s_ce1;
 fx::phaser s_ph1;
 /// リバーブ
 fx::reverb s_rv1;
+/// オートワウ
+fx::autowah s_aw1;
+/// コンプレッサー
+fx::compressor s_cp1;
+/// モジュレーションマトリクス 全エフェクト共通
+fx::modMatrix s_mod;
 /// エフェクター順序
-fx::base* s_effects[fx::COUNT] = { &s_od1, &s_dd1, &s_tr1, &s_ce1, &s_ph1, &s_rv1 };
+fx::base* s_effects[fx::COUNT] = { &s_od1, &s_dd1, &s_tr1, &s_ce1, &s_ph1, &s_rv1, &s_aw1, &s_cp1 };
 /// エフェクトオン・オフ
 bool s_on = false;
-/// @brief 現在選択されているエフェクター取得
+/// 画面表示タスク → I2S割込み パラメータ受渡し
+snapshot<FxParamSet> s_paramSnapshot;
+/// I2S割込みで処理中のエフェクト番号 fx::COUNT: 未初期化
+uint8_t s_processFxNum = fx::COUNT;
+/// モーフィング 移行先のパラメータ値 画面表示タスクで設定し、publishで渡す
+int16_t s_morphTarget[PARAM_COUNT] = {};
+/// モーフィング 有効
+bool s_morphEnabled = false;
+/// モーフィング 方向 true: 移行先へ
+bool s_morphToTarget = false;
+/// モーフィング 1ブロックあたりの移動量
+float s_morphStep = 1.0f;
+/// I2S割込みでのモーフィング位置 0: 現在のパラメータ値 ～ 1: 移行先
+float s_morphPos = 0.0f;
+/// モーフィング起点の変更回数 画面表示タスクで増やし、publishで渡す
+uint32_t s_morphSeq = 0;
+/// I2S割込みでモーフィング位置を0に戻した起点の変更回数
+uint32_t s_morphSeqAudio = 0;
+/// パラメータ反映（補間・変調・係数計算）の最大CPUサイクル数
+uint32_t s_updateCycleMax = 0;
+/// モジュレーション（変調元・変調量の計算）の最大CPUサイクル数
+uint32_t s_modCycleMax = 0;
+/// テンポ 画面表示タスクで設定し、publishで渡す
+float s_beatMsec = 0.0f;
+uint32_t s_tapSeq = 0;
+float s_beatPos = 0.0f;
+/// I2S割込みでのテンポ ブロックごとに拍位置を進める
+fx::beatClock s_clock = { 0.0f, 0.0f };
+/// I2S割込みで拍位置を合わせたテンポ更新回数
+uint32_t s_clockSeq = 0;
+/// I2S割込みで反映するパラメータ値 モーフィング中は補間した小数を含む
+float s_value[PARAM_COUNT] = {};
+/// trueの場合、次のブロックで全てのパラメータを反映する エフェクト初期化直後
+bool s_updateAll = true;
+/// エクスプレッション 画面表示タスクで設定し、publishで渡す
+float s_expression = 0.0f;
+/// モジュレーション 変調先の選択肢 現在のエフェクトのパラメータ名 画面表示タスク用
+char const* s_modDstStr[PARAM_COUNT] = {};
+/// モジュレーション 変調先のパラメータ定義 現在のエフェクトに合わせて作る 画面表示タスク用
+fx::paramDef s_modDstDef[fx::modMatrix::SLOTS] = {};
+/// @brief 現在選択されているエフェクター取得 画面表示タスク用
 /// @return 現在選択されているエフェクター
 inline fx::base* current() { return s_effects[g_fxNum]; }
+/// @brief 選択肢のパラメータか モジュレーションパラメータを含む I2S割込み用
+inline bool isList(fx::base const* fx, uint32_t paramIdx) {
+    const uint8_t count = fx->getParamTypeCount();
+    if (paramIdx < count)
+        return fx->getParamDef(paramIdx).curve == fx::LIST;
+    return paramIdx < count + (uint32_t)fx::modMatrix::PARAM_TYPE_COUNT &&
+           fx::modMatrix::PARAMS[paramIdx - count].curve == fx::LIST;
+}
 } // namespace
 
 char const* fx::getName() { return current()->getFxName(); }
 
+char const* fx::getName(uint8_t fxNum) { return s_effects[fxNum]->getFxName(); }
+
 uint16_t fx::getLedColor() { return current()->getLedColor(s_on); }
 
-uint8_t fx::getParamTypeCount() { return current()->getParamTypeCount(); }
+uint8_t fx::getParamTypeCount() { return current()->getParamTypeCount() + modMatrix::PARAM_TYPE_COUNT; }
+
+void fx::loadParam(int16_t const* loadData) {
+    for (uint32_t i = 0; i < PARAM_COUNT; i++) {
+        FxParam& fp = g_fxParam[i];
+        paramDef const* pd = getParamDef(i);
+        if (!pd) {
+            fp.nameTxt = "";
+            fp.max = 0;
+            fp.min = 0;
+            fp.value = 0;
+            continue;
+        }
+        fp.nameTxt = pd->name;
+        fp.max = pd->max;
+        fp.min = pd->min;
+        fp.value = pd->valid(loadData[i]) ? loadData[i] : pd->def; // 範囲外の場合は初期値
+    }
+}
+
+void fx::publish() {
+    FxParamSet p;
+    p.fxNum = g_fxNum;
+    p.on = s_on;
+    for (uint32_t i = 0; i < PARAM_COUNT; i++)
+        p.value[i] = g_fxParam[i].value;
+    current()->adjustParam(p.value, g_tapTime);
+    for (uint32_t i = 0; i < PARAM_COUNT; i++) {
+        g_fxParam[i].value = p.value[i]; // 補正後の値を表示する
+        p.morph[i] = p.value[i];
+    }
+    if (s_morphEnabled) {
+        for (uint32_t i = 0; i < PARAM_COUNT; i++)
+            p.morph[i] = s_morphTarget[i];
+        current()->adjustParam(p.morph, g_tapTime);
+    }
+    p.morphStep = s_morphStep;
+    p.morphToTarget = s_morphToTarget;
+    p.morphSeq = s_morphSeq;
+    p.beatMsec = s_beatMsec;
+    p.beatPos = s_beatPos;
+    p.tapSeq = s_tapSeq;
+    p.expression = s_expression;
+    s_paramSnapshot.write(p);
+}
+
+bool fx::receive() {
+    if (s_paramSnapshot.count() == 0)
+        return false; // 起動直後 まだ受け渡されていない
+    s_paramSnapshot.read(g_audioParam);
+    if (g_audioParam.fxNum == s_processFxNum)
+        return false;
+    if (s_processFxNum < COUNT)
+        s_effects[s_processFxNum]->deinit();
+    s_processFxNum = g_audioParam.fxNum;
+    s_effects[s_processFxNum]->init();
+    s_updateAll = true;
+    s_morphPos = 0.0f;
+    return true;
+}
+
+void fx::process(float (&xL)[BLOCK_SIZE], float (&xR)[BLOCK_SIZE]) {
+    if (s_processFxNum >= COUNT)
+        return; // 未初期化の場合は原音のまま
+    fx::base* fx = s_effects[s_processFxNum];
+    const uint32_t start = DWT->CYCCNT;
+
+    // モーフィング位置を1ブロック分進め、全パラメータを同じ位置で補間する
+    if (g_audioParam.morphSeq != s_morphSeqAudio) {
+        s_morphSeqAudio = g_audioParam.morphSeq;
+        s_morphPos = 0.0f; // 起点が現在の音に変わった
+    }
+    if (g_audioParam.morphToTarget)
+        s_morphPos = std::min(1.0f, s_morphPos + g_audioParam.morphStep);
+    else
+        s_morphPos = std::max(0.0f, s_morphPos - g_audioParam.morphStep);
+    for (uint32_t i = 0; i < PARAM_COUNT; i++) {
+        const float a = g_audioParam.value[i];
+        const float b = g_audioParam.morph[i];
+        if (a == b || s_morphPos <= 0.0f)
+            s_value[i] = a;
+        else if (isList(fx, i))
+            s_value[i] = (s_morphPos < 0.5f) ? a : b; // 選択肢は中間で切り替える
+        else
+            s_value[i] = a + (b - a) * s_morphPos;
+    }
+    // テンポ タップされた場合はこのブロックの先頭で拍位置を合わせる
+    if (g_audioParam.tapSeq != s_clockSeq) {
+        s_clockSeq = g_audioParam.tapSeq;
+        s_clock.pos = fmodf(g_audioParam.beatPos, BEAT_WRAP);
+    }
+    if (g_audioParam.beatMsec != s_clock.msec) {
+        s_clock.msec = g_audioParam.beatMsec;
+        s_updateAll = true; // テンポなしに戻った場合、LFOの周期をRATEに戻す
+    }
+    // モジュレーション 補間後の値に変調量を加える
+    const uint32_t modStart = DWT->CYCCNT;
+    s_mod.process(s_value, *fx, xL, s_clock, g_audioParam.expression);
+    s_modCycleMax = std::max<uint32_t>(s_modCycleMax, DWT->CYCCNT - modStart);
+    fx->update(s_value, s_updateAll, s_clock); // 変わったパラメータのみ反映する プリセット呼出時も1ブロックで全て反映
+    s_updateAll = false;
+    s_updateCycleMax = std::max<uint32_t>(s_updateCycleMax, DWT->CYCCNT - start);
+    fx->process(xL, xR, g_audioParam.on);
+
+    // 拍位置を1ブロック分進める
+    if (s_clock.msec > 0.0f) {
+        s_clock.pos += 1000.0f * BLOCK_SIZE / (SAMPLING_FREQ * s_clock.msec);
+        if (s_clock.pos >= BEAT_WRAP)
+            s_clock.pos -= BEAT_WRAP;
+    }
+}
 
-void fx::process(float (&xL)[BLOCK_SIZE], float (&xR)[BLOCK_SIZE]) { current()->process(xL, xR, s_on); }
+fx::paramDef const* fx::getParamDef(uint8_t paramIdx) {
+    fx::base* fx = current();
+    const uint8_t count = fx->getParamTypeCount();
+    if (paramIdx < count)
+        return &fx->getParamDef(paramIdx);
+    if (paramIdx >= count + modMatrix::PARAM_TYPE_COUNT)
+        return nullptr;
+    const uint8_t m = paramIdx - count; // モジュレーションパラメータ
+    if (m < modMatrix::M1SRC || (m - modMatrix::M1SRC) % 3 != modMatrix::M1DST - modMatrix::M1SRC)
+        return &modMatrix::PARAMS[m];
+    // 変調先 現在のエフェクトのパラメータ名を選択肢とする
+    for (uint32_t i = 0; i < count; i++)
+        s_modDstStr[i] = fx->getParamDef(i).name;
+    paramDef& pd = s_modDstDef[(m - modMatrix::M1SRC) / 3];
+    pd = modMatrix::PARAMS[m];
+    pd.max = count - 1;
+    pd.list = s_modDstStr;
+    return &pd;
+}
 
-void fx::init() { current()->init(g_fxAllData[g_fxNum]); }
+void fx::setParamStr(uint8_t paramIdx) {
+    FxParam& fp = g_fxParam[paramIdx];
+    strFormat str(fp.valueTxt);
+    paramDef const* pd = getParamDef(paramIdx);
+    if (pd)
+        pd->format(str, fp.value, PARAM_VALUE_WIDTH);
+}
 
-void fx::deinit() { current()->deinit(); }
+void fx::setMorph(int16_t const* target, bool toTarget, float msec) {
+    s_morphEnabled = (target != nullptr);
+    s_morphToTarget = s_morphEnabled && toTarget;
+    s_morphStep = 1.0f;
+    if (!s_morphEnabled)
+        return;
+    for (uint32_t i = 0; i < PARAM_COUNT; i++)
+        s_morphTarget[i] = target[i];
+    if (msec > 0.0f)
+        s_morphStep = std::min(1.0f, 1000.0f * BLOCK_SIZE / (SAMPLING_FREQ * msec));
+}
 
-void fx::setParamStr(uint8_t paramNum) { current()->setParamStr(paramNum); }
+void fx::rebaseMorph() {
+    if (!s_morphEnabled)
+        return;
+    int16_t target[PARAM_COUNT];
+    for (uint32_t i = 0; i < PARAM_COUNT; i++)
+        target[i] = s_morphTarget[i];
+    current()->adjustParam(target, g_tapTime); // publishと同じ補正をした移行先
+    const float pos = s_morphPos;
+    const uint8_t count = getParamTypeCount();
+    for (uint32_t i = 0; i < count; i++) {
+        const int16_t a = g_fxParam[i].value;
+        const int16_t b = target[i];
+        if (getParamDef(i)->curve == LIST)
+            g_fxParam[i].value = (pos < 0.5f) ? a : b; // I2S割込みの補間と同じく中間で切り替える
+        else
+            g_fxParam[i].value = (int16_t)lroundf(a + (b - a) * pos);
+    }
+    s_morphEnabled = false;
+    s_morphToTarget = false;
+    s_morphSeq++;
+}
+
+void fx::setBeat(float beatMsec, uint32_t seq, float beatPos) {
+    s_beatMsec = beatMsec;
+    s_tapSeq = seq;
+    s_beatPos = beatPos;
+}
+
+void fx::setExpression(float value) { s_expression = value; }
+
+float fx::getMorphPos() { return s_morphPos; }
+
+uint32_t fx::getUpdateCycleMax(bool reset) {
+    const uint32_t c = s_updateCycleMax;
+    if (reset)
+        s_updateCycleMax = 0;
+    return c;
+}
+
+uint32_t fx::getModCycleMax(bool reset) {
+    const uint32_t c = s_modCycleMax;
+    if (reset)
+        s_modCycleMax = 0;
+    return c;
+}
 
 void fx::change(int shiftCount) { g_fxNum = (fx::COUNT + g_fxNum + shiftCount) % fx::COUNT; }
 
 void fx::toggle() { s_on = !s_on; }
+
+bool fx::isOn() { return s_on; }
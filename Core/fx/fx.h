@@ -4,27 +4,75 @@
 
 namespace fx {
 /// エフェクト総数
-constexpr uint32_t COUNT = 6;
+constexpr uint32_t COUNT = 8;
 /// @brief エフェクト名文字列 取得
 /// @return エフェクト名文字列
 char const* getName();
+/// @brief エフェクト名文字列 取得
+/// @param[in] fxNum エフェクト番号
+/// @return エフェクト名文字列
+char const* getName(uint8_t fxNum);
 /// @brief LED色(RGB565) 取得
 /// @return LED色(RGB565)
 uint16_t getLedColor();
 /// @brief パラメータ総数 取得
-/// @return パラメータ総数
+/// @return パラメータ総数 エフェクトのパラメータの後ろに並ぶモジュレーションパラメータを含む
 uint8_t getParamTypeCount();
-/// @brief エフェクト処理
+/// @brief パラメータ定義 取得
+/// @param[in] paramIdx パラメータインデックス
+/// @return パラメータ定義 パラメータ総数以上の場合nullptr
+paramDef const* getParamDef(uint8_t paramIdx);
+/// @brief パラメータ読込 保存データ・プリセットから現在のエフェクトのパラメータを読み込む
+/// @param[in] data パラメータ値 PARAM_COUNT個 範囲外の値は初期値にする
+void loadParam(int16_t const* data);
+/// @brief パラメータ受渡し 画面表示タスクから呼ぶ
+/// エフェクト番号・オン/オフ・パラメータ値をまとめてI2S割込みへ渡す
+void publish();
+/// @brief パラメータ受取り I2S割込みの最初に呼ぶ
+/// 受け取った値は g_audioParam に入り、割込み処理中は変化しない
+/// @return エフェクト種類が変わり、終了処理・初期化を行った場合true
+bool receive();
+/// @brief モーフィング設定 画面表示タスクから呼び、publishでI2S割込みへ渡す
+/// I2S割込みで現在のパラメータ値と移行先の間をブロックごとに補間する 選択肢のパラメータは中間で切り替える
+/// @param[in] target 移行先のパラメータ値 PARAM_COUNT個 nullptr: モーフィング解除
+/// @param[in] toTarget true: 移行先へ false: 現在のパラメータ値へ戻る
+/// @param[in] msec 端から端まで移行する時間 ms
+void setMorph(int16_t const* target, bool toTarget, float msec);
+/// @brief モーフィング起点変更 移行先を変える前に呼ぶ
+/// 現在の補間位置の値をパラメータ値に書き込み、publishでI2S割込みの補間位置を0に戻す
+/// 値は整数に丸めるため、また補間位置は画面更新1回分遅れて読むため、わずかな差は残る
+void rebaseMorph();
+/// @brief モーフィング位置 取得
+/// @return 0: 現在のパラメータ値 ～ 1: 移行先
+float getMorphPos();
+/// @brief パラメータ反映（補間・変調・係数計算）の1ブロックあたり最大CPUサイクル数 取得
+/// @param[in] reset trueの場合、取得後に0に戻す
+uint32_t getUpdateCycleMax(bool reset);
+/// @brief モジュレーション（変調元・変調量の計算）の1ブロックあたり最大CPUサイクル数 取得
+/// modMatrix::TOTAL_CYCLES（見積り）と比べる 変調先の係数計算は含まない
+/// @param[in] reset trueの場合、取得後に0に戻す
+uint32_t getModCycleMax(bool reset);
+/// @brief テンポ設定 画面表示タスクから呼び、publishでI2S割込みへ渡す
+/// @param[in] beatMsec 1拍の時間 ms 0: テンポなし
+/// @param[in] seq テンポ更新回数 変わった場合、I2S割込みで拍位置を beatPos に合わせる
+/// @param[in] beatPos 現在の拍位置 拍数
+void setBeat(float beatMsec, uint32_t seq, float beatPos);
+/// @brief エクスプレッション設定 画面表示タスクから呼び、publishでI2S割込みへ渡す
+/// モジュレーションの変調元 EXPRESSION として使う
+/// @param[in] value 0 ～ 1
+void setExpression(float value);
+/// @brief エフェクト処理 I2S割込みから呼ぶ
 void process(float (&xL)[BLOCK_SIZE], float (&xR)[BLOCK_SIZE]);
-/// @brief 初期化処理 パラメータ読込、ディレイ用メモリ確保等
-void init();
-/// @brief 終了処理 ディレイ用メモリ縮小等
-void deinit();
-/// @brief エフェクトパラメータ文字列更新処理
+/// パラメータ数値表示の最大文字数
+constexpr uint32_t PARAM_VALUE_WIDTH = 4;
+/// @brief エフェクトパラメータ文字列更新処理 実際の値を単位なしで表示幅に収める
 void setParamStr(uint8_t paramIdx);
 /// @brief エフェクト種類切替
 /// @param shiftCount 切替方向
 void change(int shiftCount);
 /// @brief エフェクトオン・オフ切替
 void toggle();
+/// @brief エフェクトオン・オフ 取得
+/// @return オンの場合true
+bool isOn();
 } // namespace fx
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "common.h"
+#include "fx_base.h"
+#include "lib_calc.hpp"
+#include "lib_filter.hpp"
+
+namespace fx {
+class autowah;
+}
+
+/// @brief オートワウ
+/// 入力のエンベロープで状態変数フィルタの周波数をサンプルごとに動かす
+class fx::autowah : public fx::base {
+private:
+    enum PARAM_TYPE {
+        LEVEL,
+        SENS,
+        FREQ,
+        RANGE,
+        Q,
+        ATTACK,
+        RELEASE,
+        MODE,
+        PARAM_TYPE_COUNT, // パラメータ種類総数
+    };
+    static constexpr char const* MODE_STR[] = { "LPF", "BPF", "HPF" };
+    static constexpr paramDef PARAMS[] = {
+        { "LEVEL", 0, 100, 50, LINEAR, -20.0f, 20.0f, DB, 1, nullptr },
+        { "SENS", 0, 100, 50, LINEAR, 0.0f, 40.0f, DB, 0, nullptr },   // エンベロープの増幅量
+        { "FREQ", 0, 100, 30, EXP, 100.0f, 2000.0f, HZ, 0, nullptr },  // 無音時の周波数
+        { "RANGE", 0, 80, 60, LINEAR, -4.0f, 4.0f, NONE, 1, nullptr }, // 周波数の変化幅 オクターブ 負: 下がる
+        { "Q", 0, 100, 50, EXP, 0.7f, 10.0f, NONE, 1, nullptr },
+        { "ATTACK", 0, 100, 30, EXP, 0.5f, 50.0f, MS, 1, nullptr },
+        { "RELEASE", 0, 100, 50, EXP, 10.0f, 1000.0f, MS, 0, nullptr },
+        { "MODE", 0, 2, 1, LIST, 0.0f, 0.0f, NONE, 0, MODE_STR },
+    };
+    static_assert(sizeof(PARAMS) / sizeof(PARAMS[0]) == PARAM_TYPE_COUNT, "PARAMS size");
+    float param_[PARAM_TYPE_COUNT] = { 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f };
+
+    static constexpr float FREQ_MAX = 0.35f * SAMPLING_FREQ; // tanApproxの使用範囲内
+
+    signalSw bypass_;
+    envFollower env_;
+    svf svf_;
+
+public:
+    autowah() : base(PARAMS) {}
+
+    char const* getFxName() const override { return "AUTO WAH"; }
+
+    uint16_t getLedColor(bool on) const override { return on ? 0b0000011111100000 /*緑*/ : 0; }
+
+    void init() override {}
+
+    void deinit() override {}
+
+    void setParam() override {
+        if (changed(LEVEL))
+            param_[LEVEL] = dbToGain(real(LEVEL));
+        if (changed(SENS))
+            param_[SENS] = dbToGain(real(SENS));
+        if (changed(FREQ))
+            param_[FREQ] = real(FREQ);
+        if (changed(RANGE))
+            param_[RANGE] = 6.0206f * real(RANGE); // オクターブ → dB
+        const bool attack = changed(ATTACK);
+        if (changed(RELEASE) || attack) {
+            param_[ATTACK] = real(ATTACK);
+            param_[RELEASE] = real(RELEASE);
+            env_.set(param_[ATTACK], param_[RELEASE]);
+        }
+        if (changed(Q)) {
+            param_[Q] = real(Q);
+            svf_.set(param_[FREQ], param_[Q]);
+        }
+        if (changed(MODE))
+            param_[MODE] = value(MODE);
+    }
+
+    void process(float (&xL)[BLOCK_SIZE], float (&xR)[BLOCK_SIZE], bool on) override {
+        float fxL[BLOCK_SIZE] = {};
+        const uint8_t mode = (uint8_t)param_[MODE];
+        const float bpGain = 1.0f / param_[Q]; // BPFのピークを0dBにする
+
+        for (uint32_t i = 0; i < BLOCK_SIZE; i++) {
+            float e = env_.process(xL[i]) * param_[SENS]; // エンベロープ 0 ～ 1
+            if (e > 1.0f)
+                e = 1.0f;
+            float freq = param_[FREQ] * dbToGain(param_[RANGE] * e);
+            if (freq > FREQ_MAX)
+                freq = FREQ_MAX;
+            svf_.setFreq(freq);
+            svf_.process(xL[i]);
+
+            if (mode == 0)
+                fxL[i] = svf_.lp;
+            else if (mode == 1)
+                fxL[i] = svf_.bp * bpGain;
+            else
+                fxL[i] = svf_.hp;
+            xL[i] = bypass_.process(xL[i], fxL[i] * param_[LEVEL], on);
+        }
+    }
+};
+
+// 静的メンバの定義 C++11ではconstexprでも必要
+constexpr char const* fx::autowah::MODE_STR[];
+constexpr fx::paramDef fx::autowah::PARAMS[];
@@ -1,12 +1,68 @@
 #pragma once
 
+#include "fx_param.hpp"
 #include <cstdint>
 
 namespace fx {
 /// ブロックサイズ まとめて処理を行う数
 constexpr uint32_t BLOCK_SIZE = 16;
+/// 1エフェクトのパラメータ最大数
+constexpr uint32_t PARAM_MAX = 20;
+/// 全エフェクト共通のモジュレーションパラメータ数 各エフェクトのパラメータの後ろに並べる fx_mod.hpp
+constexpr uint32_t MOD_PARAM_COUNT = 8;
+/// LFO拍同期 選択肢 タップ間隔の何倍を1周期とするか
+constexpr char const* SYNC_STR[] = { "OFF", "4/1", "2/1", "1/1", "3/4", "1/2", "1/3", "1/4" };
+/// LFO拍同期 1周期の拍数 0: 同期しない
+constexpr float SYNC_BEATS[] = { 0.0f, 4.0f, 2.0f, 1.0f, 0.75f, 0.5f, 1.0f / 3.0f, 0.25f };
+/// 拍位置を0に戻す拍数 SYNC_BEATSの全ての値で割り切れること
+constexpr float BEAT_WRAP = 12.0f;
+/// テンポ I2S割込みでブロックごとに進める
+struct beatClock {
+    float msec; ///< 1拍の時間 ms 0: テンポなし
+    float pos;  ///< ブロック先頭の拍位置 0 ～ BEAT_WRAP
+};
 /// @brief 各エフェクトクラスの基底クラス 純粋仮想関数を含む抽象クラス
 class base {
+private:
+    paramDef const* params_;        // パラメータ定義
+    uint8_t paramCount_;            // パラメータ総数
+    float const* value_ = nullptr;  // 反映するパラメータ値
+    float applied_[PARAM_MAX] = {}; // 前回反映したパラメータ値
+    bool all_ = true;               // trueの場合、全てのパラメータを反映する
+    beatClock clock_ = { 0.0f, 0.0f };
+
+protected:
+    /// @param[in] params パラメータ定義 要素数がパラメータ総数となる
+    template <uint32_t N>
+    base(paramDef const (&params)[N]) : params_(params), paramCount_(N) {
+        static_assert(N + MOD_PARAM_COUNT <= PARAM_MAX, "too many params");
+    }
+    /// @brief パラメータ値が前回反映した値から変わったか setParamで使う
+    /// trueを返した場合、反映済として記録する
+    bool changed(uint8_t paramIdx) {
+        if (!all_ && value_[paramIdx] == applied_[paramIdx])
+            return false;
+        applied_[paramIdx] = value_[paramIdx];
+        return true;
+    }
+    /// @brief パラメータ値 モーフィング中は補間した小数を含む
+    float value(uint8_t paramIdx) const { return value_[paramIdx]; }
+    /// @brief パラメータ値から計算した実際の値
+    float real(uint8_t paramIdx) const { return params_[paramIdx].real(value_[paramIdx]); }
+    /// @brief LFOの拍同期 processの最初に呼び、ブロックの先頭で位相を拍に合わせる
+    /// @param[in] beats 1周期の拍数 0: 同期しない
+    /// @param[out] period 周期 秒
+    /// @param[out] phase 位相 0 ～ 1
+    /// @return テンポがない、または同期しない場合false
+    bool beatSync(float beats, float& period, float& phase) const {
+        if (beats <= 0.0f || clock_.msec <= 0.0f)
+            return false;
+        period = 0.001f * clock_.msec * beats;
+        const float cycles = clock_.pos / beats;
+        phase = cycles - floorf(cycles);
+        return true;
+    }
+
 public:
     /// @brief エフェクト名文字列 取得
     /// @return エフェクト名文字列
@@ -17,20 +73,36 @@ public:
     virtual uint16_t getLedColor(bool on) const = 0;
     /// @brief パラメータ総数 取得
     /// @return パラメータ総数
-    virtual uint8_t getParamTypeCount() const = 0;
+    uint8_t getParamTypeCount() const { return paramCount_; }
+    /// @brief パラメータ定義 取得
+    /// @param[in] paramIdx パラメータインデックス パラメータ総数未満
+    /// @return パラメータ定義
+    paramDef const& getParamDef(uint8_t paramIdx) const { return params_[paramIdx]; }
     /// @brief 初期化
-    /// I2S受信割込み（ハーフ/フル）からエフェクト種類変更時に呼ばれる
-    /// @param[in] loadData フラッシュから読み込んだデータ
-    virtual void init(int16_t const* loadData) = 0;
+    /// I2S受信割込み（ハーフ/フル）からエフェクト種類変更時に、パラメータ読込後に呼ばれる
+    virtual void init() = 0;
     /// @brief 終了処理
     /// I2S受信割込み（ハーフ/フル）からエフェクト種類変更時に呼ばれる
     virtual void deinit() = 0;
-    /// @brief パラメータ文字列を設定
-    /// メインループから毎回呼ばれる
-    /// @param[in] paramIdx パラメータインデックス
-    virtual void setParamStr(uint8_t paramIdx) = 0;
+    /// @brief パラメータ値の補正
+    /// 画面表示タスクからパラメータ受渡しの前に呼ばれる タップテンポの反映、値の循環等
+    /// @param[inout] value パラメータ値
+    /// @param[in] tapTime タップテンポ入力時間 ms
+    virtual void adjustParam(int16_t* value, float tapTime) const {}
+    /// @brief パラメータ反映
+    /// I2S受信割込み（ハーフ/フル）からprocessの前に毎回呼ばれる
+    /// @param[in] value パラメータ値 パラメータ総数分
+    /// @param[in] all trueの場合、変わっていないパラメータも反映する 初期化直後に使う
+    /// @param[in] clock テンポ
+    void update(float const* value, bool all, beatClock const& clock) {
+        value_ = value;
+        all_ = all;
+        clock_ = clock;
+        setParam();
+        all_ = false;
+    }
     /// @brief パラメータ設定
-    /// processから毎回呼ばれる
+    /// updateから呼ばれる changed()で変わったパラメータのみ計算する
     virtual void setParam() = 0;
     /// @brief エフェクト処理
     /// I2S受信割込み（ハーフ/フル）から毎回呼ばれる
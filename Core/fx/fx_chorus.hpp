@@ -6,8 +6,6 @@
 #include "lib_delay.hpp"
 #include "lib_filter.hpp"
 #include "lib_osc.hpp"
-#include <string.h>
-#include <string.h> // strcpy
 
 namespace fx {
 class chorus;
@@ -23,12 +21,20 @@ private:
         RATE,
         DEPTH,
         TONE,
+        SYNC,
         PARAM_TYPE_COUNT, // パラメータ種類総数
     };
-    float param_[PARAM_COUNT] = { 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f };
-    const int16_t PARAM_MAX[PARAM_COUNT] = { 100, 100, 99, 100, 100, 100, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1 };
-    const int16_t PARAM_MIN[PARAM_COUNT] = { 0, 0, 0, 0, 0, 0 };
-    char const* const PARAM_NAME[PARAM_COUNT] = { "LEVEL", "MIX", "F.BACK", "RATE", "DEPTH", "TONE" };
+    static constexpr paramDef PARAMS[] = {
+        { "LEVEL", 0, 100, 50, LINEAR, -20.0f, 20.0f, DB, 1, nullptr },
+        { "MIX", 0, 100, 50, LINEAR, 0.0f, 100.0f, PERCENT, 0, nullptr },
+        { "F.BACK", 0, 99, 49, LINEAR, 0.0f, 99.0f, PERCENT, 0, nullptr },
+        { "RATE", 0, 100, 50, LINEAR, 2.1f, 0.1f, SEC, 2, nullptr }, // 揺れの周期
+        { "DEPTH", 0, 100, 50, LINEAR, 0.0f, 10.0f, MS, 1, nullptr },
+        { "TONE", 0, 100, 50, EXP, 800.0f, 8000.0f, HZ, 0, nullptr }, // ハイカット
+        { "SYNC", 0, 7, 0, LIST, 0.0f, 0.0f, NONE, 0, SYNC_STR },     // タップテンポ同期 OFF: RATEを使う
+    };
+    static_assert(sizeof(PARAMS) / sizeof(PARAMS[0]) == PARAM_TYPE_COUNT, "PARAMS size");
+    float param_[PARAM_TYPE_COUNT] = { 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f, 0.0f };
 
     signalSw bypass_;
     triangleWave tri1_;
@@ -38,81 +44,48 @@ private:
     lpf2nd lpf2nd2_;
 
 public:
+    chorus() : base(PARAMS) {}
+
     char const* getFxName() const override { return "CHORUS"; }
 
     uint16_t getLedColor(bool on) const override { return on ? 0b0000000000011111 /*青*/ : 0; }
 
-    uint8_t getParamTypeCount() const override { return PARAM_TYPE_COUNT; }
-
-    void init(int16_t const* loadData) override {
-        for (uint32_t i = 0; i < PARAM_COUNT; i++) {
-            g_fxParam[i].nameTxt = PARAM_NAME[i] ? PARAM_NAME[i] : "";
-            g_fxParam[i].max = PARAM_MAX[i];
-            g_fxParam[i].min = PARAM_MIN[i];
-            if (PARAM_MIN[i] <= loadData[i] && loadData[i] <= PARAM_MAX[i]) {
-                g_fxParam[i].value = loadData[i];
-            }
-            else {
-                g_fxParam[i].value = (PARAM_MIN[i] + PARAM_MAX[i]) / 2;
-            }
-        }
-
+    void init() override {
         del1_.set(20.0f);  // 最大ディレイタイム設定
         hpf1_.set(100.0f); // ウェット音のローカット設定
     }
 
     void deinit() override { del1_.erase(); }
 
-    void setParamStr(uint8_t paramIdx) override {
-        FxParam& fp = g_fxParam[paramIdx];
-        if (paramIdx < PARAM_TYPE_COUNT) {
-            snprintf(fp.valueTxt, sizeof(fp.valueTxt), "%d", fp.value);
-        }
-        else {
-            memset(fp.valueTxt, 0, sizeof(fp.valueTxt));
-        }
-    }
-
     void setParam() override {
-        static uint8_t count = 0;
-        count = (count + 1) % 10; // 負荷軽減のためパラメータ計算を分散させる
-        switch (count) {
-        case 0:
-            param_[LEVEL] = logPot(g_fxParam[LEVEL].value, -20.0f, 20.0f); // LEVEL -20 ～ 20dB
-            break;
-        case 1:
-            param_[MIX] = mixPot(g_fxParam[MIX].value, -20.0f); // MIX
-            break;
-        case 2:
-            param_[FBACK] = (float)g_fxParam[FBACK].value / 100.0f; // Feedback 0～0.99
-            break;
-        case 3:
-            param_[RATE] = 0.02f * (105.0f - (float)g_fxParam[RATE].value); // Rate 2s
-            break;
-        case 4:
-            param_[DEPTH] = 0.1f * (float)g_fxParam[DEPTH].value; // Depth 10ms
-            break;
-        case 5:
-            param_[TONE] = 800.0f * logPot(g_fxParam[TONE].value, 0.0f, 20.0f); // HI CUT FREQ 800 ～ 8000 Hz
-            break;
-        case 6:
+        if (changed(LEVEL))
+            param_[LEVEL] = dbToGain(real(LEVEL));
+        if (changed(MIX))
+            param_[MIX] = mixPot(value(MIX), -20.0f); // MIX
+        if (changed(FBACK))
+            param_[FBACK] = 0.01f * real(FBACK);
+        const bool sync = changed(SYNC);
+        if (sync)
+            param_[SYNC] = SYNC_BEATS[(uint8_t)value(SYNC)];
+        if (changed(RATE) || sync) {
+            param_[RATE] = real(RATE);
+            tri1_.set(param_[RATE]);
+        }
+        if (changed(DEPTH))
+            param_[DEPTH] = real(DEPTH);
+        if (changed(TONE)) {
+            param_[TONE] = real(TONE);
             lpf2nd1_.set(param_[TONE]);
-            break;
-        case 7:
             lpf2nd2_.set(param_[TONE]);
-            break;
-        case 8:
-            tri1_.set(param_[RATE]);
-            break;
-        default:
-            break;
         }
     }
 
     void process(float (&xL)[BLOCK_SIZE], float (&xR)[BLOCK_SIZE], bool on) override {
         float fxL[BLOCK_SIZE] = {};
 
-        setParam();
+        float period, phase;
+        if (beatSync(param_[SYNC], period, phase))
+            tri1_.set(period, phase); // タップテンポ同期
 
         for (uint32_t i = 0; i < BLOCK_SIZE; i++) {
             float dtime = param_[DEPTH] * tri1_.output() + 5.0f; // ディレイタイム5~15ms
@@ -125,3 +98,6 @@ public:
         }
     }
 };
+
+// 静的メンバの定義 C++11ではconstexprでも必要
+constexpr fx::paramDef fx::chorus::PARAMS[];
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "common.h"
+#include "fx_base.h"
+#include "lib_calc.hpp"
+#include "lib_dynamics.hpp"
+
+namespace fx {
+class compressor;
+}
+
+/// @brief コンプレッサー
+/// フィードフォワード 1ブロックのピークまたはRMSからゲインを求め、ブロック内はゲインを直線補間する
+class fx::compressor : public fx::base {
+private:
+    enum PARAM_TYPE {
+        THRESH,
+        RATIO,
+        KNEE,
+        ATTACK,
+        RELEASE,
+        MAKEUP,
+        DETECT,
+        PARAM_TYPE_COUNT, // パラメータ種類総数
+    };
+    static constexpr char const* DETECT_STR[] = { "PEAK", "RMS" };
+    static constexpr paramDef PARAMS[] = {
+        { "THRESH", 0, 60, 40, LINEAR, -60.0f, 0.0f, DB, 0, nullptr },
+        { "RATIO", 0, 100, 50, EXP, 1.0f, 20.0f, NONE, 1, nullptr },
+        { "KNEE", 0, 24, 6, LINEAR, 0.0f, 24.0f, DB, 0, nullptr },
+        { "ATTACK", 0, 100, 40, EXP, 0.5f, 100.0f, MS, 1, nullptr },
+        { "RELEASE", 0, 100, 50, EXP, 20.0f, 2000.0f, MS, 0, nullptr },
+        { "MAKEUP", 0, 60, 10, LINEAR, 0.0f, 30.0f, DB, 1, nullptr },
+        { "DETECT", 0, 1, 1, LIST, 0.0f, 0.0f, NONE, 0, DETECT_STR }, // レベル検出
+    };
+    static_assert(sizeof(PARAMS) / sizeof(PARAMS[0]) == PARAM_TYPE_COUNT, "PARAMS size");
+    float param_[PARAM_TYPE_COUNT] = { 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+
+    signalSw bypass_;
+    compGain comp_;
+    float gain_ = 1.0f; // 前ブロック末尾のゲイン
+
+public:
+    compressor() : base(PARAMS) {}
+
+    char const* getFxName() const override { return "COMPRESSOR"; }
+
+    uint16_t getLedColor(bool on) const override { return on ? 0b1111101111100000 /*橙*/ : 0; }
+
+    void init() override {}
+
+    void deinit() override {}
+
+    void setParam() override {
+        const bool thresh = changed(THRESH);
+        const bool ratio = changed(RATIO);
+        if (changed(KNEE) || thresh || ratio) {
+            param_[THRESH] = real(THRESH);
+            param_[RATIO] = real(RATIO);
+            param_[KNEE] = real(KNEE);
+            comp_.set(param_[THRESH], param_[RATIO], param_[KNEE]);
+        }
+        const bool attack = changed(ATTACK);
+        if (changed(RELEASE) || attack) {
+            param_[ATTACK] = real(ATTACK);
+            param_[RELEASE] = real(RELEASE);
+            comp_.setTime(param_[ATTACK], param_[RELEASE], BLOCK_SIZE);
+        }
+        if (changed(MAKEUP))
+            param_[MAKEUP] = real(MAKEUP);
+        if (changed(DETECT))
+            param_[DETECT] = value(DETECT);
+    }
+
+    void process(float (&xL)[BLOCK_SIZE], float (&xR)[BLOCK_SIZE], bool on) override {
+        float fxL[BLOCK_SIZE] = {};
+
+        // レベル検出 dB変換はブロックごとに1回
+        float peak = 0.0f, sumSq = 0.0f;
+        for (uint32_t i = 0; i < BLOCK_SIZE; i++) {
+            peak = fmaxf(peak, fabsf(xL[i]));
+            sumSq += xL[i] * xL[i];
+        }
+        float levelDb;
+        if ((uint8_t)param_[DETECT] == 0)
+            levelDb = gainToDbFast(fmaxf(peak, 0.000001f));
+        else
+            levelDb = 0.5f * gainToDbFast(fmaxf(sumSq * (1.0f / BLOCK_SIZE), 1e-12f)); // 2乗平均のdB / 2
+        const float gain = dbToGainFast(comp_.process(levelDb) + param_[MAKEUP]);
+
+        // 前ブロックのゲインから直線補間する
+        const float step = (gain - gain_) * (1.0f / BLOCK_SIZE);
+        for (uint32_t i = 0; i < BLOCK_SIZE; i++) {
+            gain_ += step;
+            fxL[i] = gain_ * xL[i];
+            xL[i] = bypass_.process(xL[i], fxL[i], on);
+        }
+        gain_ = gain;
+    }
+};
+
+// 静的メンバの定義 C++11ではconstexprでも必要
+constexpr char const* fx::compressor::DETECT_STR[];
+constexpr fx::paramDef fx::compressor::PARAMS[];
@@ -0,0 +1,136 @@
+#pragma once
+
+#include "common.h"
+#include "fx_base.h"
+#include "lib_calc.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace fx {
+class modMatrix;
+}
+
+/// @brief モジュレーションマトリクス
+/// 変調元（LFO×2・エンベロープ・テンポ・エクスプレッション）をスロットごとに現在のエフェクトのパラメータへ加える
+/// パラメータは全エフェクト共通で、各エフェクトのパラメータの後ろに並べる 保存・プリセット・モーフィングも共通
+/// I2S割込みで1ブロックに1回、モーフィングの補間後・パラメータ反映前に呼ぶ
+/// 変調したパラメータは変わったパラメータとして各エフェクトの setParam で計算される
+class fx::modMatrix {
+public:
+    /// スロット数
+    static constexpr uint32_t SLOTS = 2;
+    enum PARAM_TYPE {
+        L1TIME = 0, // LFOの周期 秒
+        L2TIME,
+        M1SRC, // スロットごとに SRC, DST, DEPTH の順に並べる
+        M1DST,
+        M1DEPTH,
+        M2SRC,
+        M2DST,
+        M2DEPTH,
+        PARAM_TYPE_COUNT, // パラメータ種類総数
+    };
+    /// 変調元
+    enum SOURCE {
+        OFF = 0,
+        LFO1,       ///< 三角波 -1 ～ 1
+        LFO2,       ///< 三角波 -1 ～ 1
+        ENV,        ///< 入力のエンベロープ 0 ～ 1 (-48dB ～ 0dB)
+        BEAT,       ///< 拍のノコギリ波 0 ～ 1 テンポなしの場合0
+        EXPRESSION, ///< エクスプレッション 0 ～ 1
+        SOURCE_COUNT,
+    };
+    static constexpr char const* SOURCE_STR[] = { "OFF", "LFO1", "LFO2", "ENV", "BEAT", "EXP" };
+    /// M1DST, M2DST は現在のエフェクトのパラメータ名を選択肢とする 最大値・選択肢は fx.cpp で設定する
+    static constexpr paramDef PARAMS[] = {
+        { "L1 TIME", 0, 100, 50, EXP, 10.0f, 0.05f, SEC, 2, nullptr }, // LFO1の周期
+        { "L2 TIME", 0, 100, 30, EXP, 10.0f, 0.05f, SEC, 2, nullptr }, // LFO2の周期
+        { "M1 SRC", 0, 5, 0, LIST, 0.0f, 0.0f, NONE, 0, SOURCE_STR },
+        { "M1 DST", 0, 0, 0, LIST, 0.0f, 0.0f, NONE, 0, nullptr },
+        { "M1 DEP", -100, 100, 0, LINEAR, -100.0f, 100.0f, PERCENT, 0, nullptr }, // パラメータ範囲に対する変調量
+        { "M2 SRC", 0, 5, 0, LIST, 0.0f, 0.0f, NONE, 0, SOURCE_STR },
+        { "M2 DST", 0, 0, 0, LIST, 0.0f, 0.0f, NONE, 0, nullptr },
+        { "M2 DEP", -100, 100, 0, LINEAR, -100.0f, 100.0f, PERCENT, 0, nullptr },
+    };
+    static_assert(sizeof(PARAMS) / sizeof(PARAMS[0]) == PARAM_TYPE_COUNT, "PARAMS size");
+    static_assert(PARAM_TYPE_COUNT == MOD_PARAM_COUNT, "MOD_PARAM_COUNT");
+    static_assert(M1SRC + 3 * SLOTS == PARAM_TYPE_COUNT, "slot params");
+
+    /// 1ブロックあたりの処理サイクル数の上限 Cortex-M7の命令サイクル数からの見積り（実機での実測値ではない）
+    /// 変調元は使われていなくても毎ブロック計算し、設定によらず一定にする
+    /// LFO: 周期の指数変換（log2f・exp2f）と除算 ENV: 16サンプルのピークとgainToDb（sqrtf×5）
+    /// 1スロットは変調量の計算と変調先1つへの加算 変調先の係数計算（setParam）は含まない
+    /// 変調先は1ブロックに最大 SLOTS 個のパラメータが変わり、各エフェクトの setParam で係数を計算し直す
+    /// 係数の計算量は、全パラメータを1ブロックで計算し直すプリセット呼出・エフェクト切替時以下となる
+    /// 実機の値は fx::getModCycleMax（この処理のみ）・fx::getUpdateCycleMax（補間・変調・係数計算）で取得する
+    static constexpr uint32_t SOURCE_CYCLES[SOURCE_COUNT] = { 0, 180, 180, 150, 20, 5 };
+    static constexpr uint32_t SLOT_CYCLES = 80;
+    /// スロット数はモジュレーションパラメータ数を超えないため、MOD_PARAM_COUNT 個分を上限とする
+    static constexpr uint32_t TOTAL_CYCLES = SOURCE_CYCLES[LFO1] + SOURCE_CYCLES[LFO2] + SOURCE_CYCLES[ENV] +
+                                             SOURCE_CYCLES[BEAT] + SOURCE_CYCLES[EXPRESSION] +
+                                             SLOT_CYCLES * MOD_PARAM_COUNT;
+    /// 1ブロック（216MHz 16サンプル 約78000サイクル）の2%
+    static constexpr uint32_t BUDGET_CYCLES = (uint32_t)(216.0e6f * BLOCK_SIZE / SAMPLING_FREQ) / 50;
+    static_assert(SLOTS <= MOD_PARAM_COUNT, "slots");
+    static_assert(TOTAL_CYCLES <= BUDGET_CYCLES, "modulation budget");
+
+private:
+    static constexpr float ENV_RELEASE = 0.99f; // エンベロープ 1ブロックあたりの減衰 約36ms
+    static constexpr float SMOOTH = 0.07f;      // 変調量の平滑化 約5ms MIDIの段差・ノコギリ波の戻りを滑らかにする
+
+    float lfoPhase_[2] = {};       // LFO位相 0 ～ 1
+    float env_ = 0.0f;             // エンベロープ 倍率
+    float src_[SOURCE_COUNT] = {}; // 変調元の値
+    float out_[SLOTS] = {};        // 平滑化した変調量 パラメータ範囲に対する割合
+
+public:
+    /// @brief 変調元を計算し、変調先のパラメータ値に加える
+    /// @param[inout] value パラメータ値 エフェクトのパラメータの後ろにモジュレーションパラメータが並ぶ
+    /// @param[in] fx 現在のエフェクト
+    /// @param[in] x 入力信号 エンベロープに使う
+    /// @param[in] clock テンポ
+    /// @param[in] expression エクスプレッション 0 ～ 1
+    void process(float* value, fx::base const& fx, float const (&x)[BLOCK_SIZE], beatClock const& clock,
+                 float expression) {
+        const uint8_t count = fx.getParamTypeCount();
+        float const* m = value + count;
+
+        // LFO 三角波
+        for (uint32_t k = 0; k < 2; k++) {
+            float& p = lfoPhase_[k];
+            p += (float)BLOCK_SIZE / (SAMPLING_FREQ * PARAMS[L1TIME + k].real(m[L1TIME + k]));
+            if (p >= 1.0f)
+                p -= floorf(p);
+            src_[LFO1 + k] = 4.0f * fabsf(p - 0.5f) - 1.0f;
+        }
+        // エンベロープ ブロックのピークで立ち上がり、ブロックごとに減衰する
+        float peak = 0.0f;
+        for (uint32_t i = 0; i < BLOCK_SIZE; i++)
+            peak = std::max(peak, fabsf(x[i]));
+        env_ = std::max(peak, env_ * ENV_RELEASE);
+        src_[ENV] = clip((gainToDb(std::max(env_, 0.00001f)) + 48.0f) * (1.0f / 48.0f), 0.0f, 1.0f);
+        // 拍位置の小数部
+        src_[BEAT] = (clock.msec > 0.0f) ? clock.pos - floorf(clock.pos) : 0.0f;
+        src_[EXPRESSION] = expression;
+
+        for (uint32_t k = 0; k < SLOTS; k++) {
+            float const* s = m + M1SRC + 3 * k; // SRC, DST, DEPTH
+            const uint8_t src = (uint8_t)s[0];
+            const uint8_t dst = (uint8_t)s[1];
+            const float target = (src < SOURCE_COUNT) ? src_[src] * PARAMS[M1DEPTH].real(s[2]) * 0.01f : 0.0f;
+            out_[k] += SMOOTH * (target - out_[k]);
+            if (src == OFF || dst >= count)
+                continue;
+            paramDef const& pd = fx.getParamDef(dst);
+            if (pd.curve == LIST)
+                continue; // 選択肢は変調しない
+            const float v = value[dst] + out_[k] * (float)(pd.max - pd.min);
+            value[dst] = clip(v, (float)pd.min, (float)pd.max);
+        }
+    }
+};
+
+// 静的メンバの定義 C++11ではconstexprでも必要
+constexpr char const* fx::modMatrix::SOURCE_STR[];
+constexpr fx::paramDef fx::modMatrix::PARAMS[];
+constexpr uint32_t fx::modMatrix::SOURCE_CYCLES[];
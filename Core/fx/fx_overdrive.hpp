@@ -4,7 +4,6 @@
 #include "fx_base.h"
 #include "lib_calc.hpp"
 #include "lib_filter.hpp"
-#include <string.h>
 
 namespace fx {
 class overdrive;
@@ -20,10 +19,14 @@ private:
         BASS,
         PARAM_TYPE_COUNT, // パラメータ種類総数
     };
-    float param_[PARAM_COUNT] = { 0.0f, 0.0f, 0.0f, 0.0f };
-    const int16_t PARAM_MAX[PARAM_COUNT] = { 100, 100, 100, 100 };
-    const int16_t PARAM_MIN[PARAM_COUNT] = { 0, 0, 0, 0 };
-    char const* const PARAM_NAME[PARAM_COUNT] = { "LEVEL", "GAIN", "TREBLE", "BASS" };
+    static constexpr paramDef PARAMS[] = {
+        { "LEVEL", 0, 100, 50, LINEAR, -40.0f, 10.0f, DB, 1, nullptr },
+        { "GAIN", 0, 100, 50, LINEAR, -6.0f, 40.0f, DB, 1, nullptr },
+        { "TREBLE", 0, 100, 50, EXP, 400.0f, 10000.0f, HZ, 0, nullptr }, // LPF
+        { "BASS", 0, 100, 50, EXP, 1000.0f, 100.0f, HZ, 0, nullptr },    // HPF 大きいほど低域を残す
+    };
+    static_assert(sizeof(PARAMS) / sizeof(PARAMS[0]) == PARAM_TYPE_COUNT, "PARAMS size");
+    float param_[PARAM_TYPE_COUNT] = { 0.0f, 0.0f, 0.0f, 0.0f };
 
     signalSw bypass_;
     hpf hpfFixed_;
@@ -32,72 +35,37 @@ private:
     lpf lpfTreble_;
 
 public:
+    overdrive() : base(PARAMS) {}
+
     char const* getFxName() const override { return "OVERDRIVE"; }
 
     uint16_t getLedColor(bool on) const override { return on ? 0b1111111111100000 /*赤緑*/ : 0; }
 
-    uint8_t getParamTypeCount() const override { return PARAM_TYPE_COUNT; }
-
-    void init(int16_t const* loadData) override {
-        for (uint32_t i = 0; i < PARAM_COUNT; i++) {
-            g_fxParam[i].nameTxt = PARAM_NAME[i] ? PARAM_NAME[i] : "";
-            g_fxParam[i].max = PARAM_MAX[i];
-            g_fxParam[i].min = PARAM_MIN[i];
-            if (PARAM_MIN[i] <= loadData[i] && loadData[i] <= PARAM_MAX[i]) {
-                g_fxParam[i].value = loadData[i];
-            }
-            else {
-                g_fxParam[i].value = (PARAM_MIN[i] + PARAM_MAX[i]) / 2;
-            }
-        }
+    void init() override {
         hpfFixed_.set(10.0f);
         lpfFixed_.set(5000.0f);
     }
 
     void deinit() override {}
 
-    void setParamStr(uint8_t paramIdx) override {
-        FxParam& fp = g_fxParam[paramIdx];
-        if (paramIdx < PARAM_TYPE_COUNT) {
-            snprintf(fp.valueTxt, sizeof(fp.valueTxt), "%d", fp.value);
-        }
-        else {
-            memset(fp.valueTxt, 0, sizeof(fp.valueTxt));
-        }
-    }
-
     void setParam() override {
-        static uint8_t count = 0;
-        count = (count + 1) % 10; // 負荷軽減のためパラメータ計算を分散させる
-        switch (count) {
-        case 0:
-            param_[LEVEL] = logPot(g_fxParam[LEVEL].value, -40.0f, 10.0f); // LEVEL -40...10 dB
-            break;
-        case 1:
-            param_[GAIN] = logPot(g_fxParam[GAIN].value, -6.0f, 40.0f); // GAIN -6...+40 dB
-            break;
-        case 2:
-            param_[TREBLE] = 10000.0f * logPot(g_fxParam[TREBLE].value, -28.0f, 0.0f); // TREBLE LPF 400 ~ 10k Hz
-            break;
-        case 3:
-            param_[BASS] = 1000.0f * logPot(g_fxParam[BASS].value, 0.0f, -20.0f); // BASS HPF 100 ~ 1000 Hz
-            break;
-        case 4:
+        if (changed(LEVEL))
+            param_[LEVEL] = dbToGain(real(LEVEL));
+        if (changed(GAIN))
+            param_[GAIN] = dbToGain(real(GAIN));
+        if (changed(TREBLE)) {
+            param_[TREBLE] = real(TREBLE);
             lpfTreble_.set(param_[TREBLE]);
-            break;
-        case 5:
+        }
+        if (changed(BASS)) {
+            param_[BASS] = real(BASS);
             hpfBass_.set(param_[BASS]);
-            break;
-        default:
-            break;
         }
     }
 
     void process(float (&xL)[BLOCK_SIZE], float (&xR)[BLOCK_SIZE], bool on) override {
         float fxL[BLOCK_SIZE] = {};
 
-        setParam();
-
         for (uint32_t i = 0; i < BLOCK_SIZE; i++) {
             fxL[i] = hpfBass_.process(xL[i]);   // BASS
             fxL[i] = lpfFixed_.process(fxL[i]); // 高域カット
@@ -125,3 +93,6 @@ public:
         }
     }
 };
+
+// 静的メンバの定義 C++11ではconstexprでも必要
+constexpr fx::paramDef fx::overdrive::PARAMS[];
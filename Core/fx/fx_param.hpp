@@ -0,0 +1,78 @@
+#pragma once
+
+#include "lib_format.hpp"
+#include <cmath>
+#include <cstdint>
+
+namespace fx {
+/// パラメータ値から実際の値への割当方法
+enum CURVE : uint8_t {
+    LINEAR, ///< lo ～ hi へ直線で割り当てる
+    EXP,    ///< lo ～ hi へ指数で割り当てる（周波数等） lo, hi は0より大きいこと
+    LIST,   ///< 選択肢 実際の値はパラメータ値のまま
+};
+/// 実際の値の単位
+enum UNIT : uint8_t {
+    NONE,
+    DB,      ///< dB
+    HZ,      ///< Hz 1000以上はk表記
+    MS,      ///< ms
+    SEC,     ///< s
+    PERCENT, ///< %
+};
+struct paramDef;
+} // namespace fx
+
+/// @brief パラメータ定義 各エフェクトでconstexprの配列として定義し、フラッシュに置く
+/// 保存・操作はパラメータ値（min ～ max の整数）で行い、信号処理・表示は実際の値を使う
+struct fx::paramDef {
+    char const* name;        ///< パラメータ名
+    int16_t min;             ///< パラメータ最小値
+    int16_t max;             ///< パラメータ最大値
+    int16_t def;             ///< 初期値 保存データが範囲外の場合にも使う
+    CURVE curve;             ///< 割当方法
+    float lo;                ///< パラメータ最小値の時の実際の値
+    float hi;                ///< パラメータ最大値の時の実際の値
+    UNIT unit;               ///< 単位
+    uint8_t decimals;        ///< 表示 小数点以下の桁数
+    char const* const* list; ///< LIST: 選択肢の文字列 min から順に並べる
+
+    bool valid(int32_t v) const { return min <= v && v <= max; }
+
+    float real(float v) const // パラメータ値 → 実際の値 小数も可
+    {
+        if (curve == LIST || max == min)
+            return (float)v;
+        const float t = (float)(v - min) / (float)(max - min);
+        if (curve == EXP)
+            return lo * exp2f(log2f(hi / lo) * t);
+        return lo + (hi - lo) * t;
+    }
+
+    char const* unitStr() const {
+        static char const* const str[] = { "", "dB", "Hz", "ms", "s", "%" };
+        return str[unit];
+    }
+
+    // 数値部分の表示文字列 単位は含まない
+    // width: 最大文字数 超える場合は小数点以下の桁数を減らす 選択肢は切り捨てる 0: 制限なし
+    void format(strFormat& s, int16_t v, uint32_t width = 0) const {
+        char str[12];
+        if (curve == LIST) {
+            strFormat(str, (width && width < sizeof(str)) ? width + 1 : sizeof(str)).str(list[v - min]); // 表示幅で切る
+            s.str(str);
+            return;
+        }
+        float x = real(v);
+        char const* kilo = "";
+        uint8_t d = decimals;
+        if (unit == HZ && fabsf(x) >= 999.5f) {
+            x *= 0.001f;
+            kilo = "k";
+            d = 1;
+        }
+        while (strFormat(str).fixed(x, d).str(kilo).length() > width && width && d)
+            d--;
+        s.str(str);
+    }
+};
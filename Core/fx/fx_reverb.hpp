@@ -5,7 +5,6 @@
 #include "lib_calc.hpp"
 #include "lib_delayPrimeNum.hpp"
 #include "lib_filter.hpp"
-#include <string.h>
 
 namespace fx {
 class reverb;
@@ -24,10 +23,16 @@ private:
         HIDUMP,
         PARAM_TYPE_COUNT, // パラメータ種類総数
     };
-    float param_[PARAM_COUNT] = { 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f };
-    const int16_t PARAM_MAX[PARAM_COUNT] = { 100, 100, 99, 100, 100, 100, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1 };
-    const int16_t PARAM_MIN[PARAM_COUNT] = { 0, 0, 0, 0, 0, 0 };
-    char const* const PARAM_NAME[PARAM_COUNT] = { "LEVEL", "MIX", "F.BACK", "HiCUT", "LoCUT", "HiDUMP" };
+    static constexpr paramDef PARAMS[] = {
+        { "LEVEL", 0, 100, 50, LINEAR, -20.0f, 20.0f, DB, 1, nullptr },
+        { "MIX", 0, 100, 50, LINEAR, 0.0f, 100.0f, PERCENT, 0, nullptr },
+        { "F.BACK", 0, 99, 49, LINEAR, 0.0f, 49.5f, PERCENT, 1, nullptr },
+        { "HiCUT", 0, 100, 50, EXP, 6000.0f, 600.0f, HZ, 0, nullptr },
+        { "LoCUT", 0, 100, 50, EXP, 100.0f, 1000.0f, HZ, 0, nullptr },
+        { "HiDUMP", 0, 100, 50, EXP, 6000.0f, 600.0f, HZ, 0, nullptr }, // フィードバックのハイカット
+    };
+    static_assert(sizeof(PARAMS) / sizeof(PARAMS[0]) == PARAM_TYPE_COUNT, "PARAMS size");
+    float param_[PARAM_TYPE_COUNT] = { 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f };
     const uint8_t dt[10] = { 44, 26, 19, 16, 8, 4, 59, 69, 75, 86 }; // ディレイタイム配列
 
     signalSw bypassIn_;
@@ -40,24 +45,13 @@ private:
     hpf hpfOutR_;
 
 public:
+    reverb() : base(PARAMS) {}
+
     char const* getFxName() const override { return "REVERB"; }
 
     uint16_t getLedColor(bool on) const override { return on ? 0b1111111111111111 /*白*/ : 0; }
 
-    uint8_t getParamTypeCount() const override { return PARAM_TYPE_COUNT; }
-
-    void init(int16_t const* loadData) override {
-        for (uint32_t i = 0; i < PARAM_COUNT; i++) {
-            g_fxParam[i].nameTxt = PARAM_NAME[i] ? PARAM_NAME[i] : "";
-            g_fxParam[i].max = PARAM_MAX[i];
-            g_fxParam[i].min = PARAM_MIN[i];
-            if (PARAM_MIN[i] <= loadData[i] && loadData[i] <= PARAM_MAX[i]) {
-                g_fxParam[i].value = loadData[i];
-            }
-            else {
-                g_fxParam[i].value = (PARAM_MIN[i] + PARAM_MAX[i]) / 2;
-            }
-        }
+    void init() override {
         for (int i = 0; i < 10; i++) {
             del_[i].set(dt[i]); // 最大ディレイタイム設定
         }
@@ -68,62 +62,26 @@ public:
             del_[i].erase();
     }
 
-    void setParamStr(uint8_t paramIdx) override {
-        FxParam& fp = g_fxParam[paramIdx];
-        if (paramIdx < PARAM_TYPE_COUNT) {
-            snprintf(fp.valueTxt, sizeof(fp.valueTxt), "%d", fp.value);
-        }
-        else {
-            memset(fp.valueTxt, 0, sizeof(fp.valueTxt));
-        }
-    }
-
     void setParam() override {
-        static uint8_t count = 0;
-        count = (count + 1) % 13; // 負荷軽減のためパラメータ計算を分散させる
-        switch (count) {
-        case 0:
-            param_[LEVEL] = logPot(g_fxParam[LEVEL].value, -20.0f, 20.0f); // LEVEL -20 ～ +20dB
-            break;
-        case 1:
-            param_[MIX] = mixPot(g_fxParam[MIX].value, -20.0f); // MIX
-            break;
-        case 2:
-            param_[FBACK] = (float)g_fxParam[FBACK].value / 200.0f; // Feedback 0～0.495
-            break;
-        case 3:
-            param_[HICUT] = 600.0f * logPot(g_fxParam[HICUT].value, 20.0f, 0.0f); // HI CUT FREQ 600 ~ 6000 Hz
-            break;
-        case 4:
-            param_[LOCUT] = 100.0f * logPot(g_fxParam[LOCUT].value, 0.0f, 20.0f); // LOW CUT FREQ 100 ~ 1000 Hz
-            break;
-        case 5:
-            param_[HIDUMP] =
-                600.0f * logPot(g_fxParam[HIDUMP].value, 20.0f, 0.0f); // Feedback HI CUT FREQ 600 ~ 6000 Hz
-            break;
-        case 6:
+        if (changed(LEVEL))
+            param_[LEVEL] = dbToGain(real(LEVEL));
+        if (changed(MIX))
+            param_[MIX] = mixPot(value(MIX), -20.0f); // MIX
+        if (changed(FBACK))
+            param_[FBACK] = 0.01f * real(FBACK);
+        if (changed(HICUT)) {
+            param_[HICUT] = real(HICUT);
             lpfIn_.set(param_[HICUT]);
-            break;
-        case 7:
+        }
+        if (changed(LOCUT)) {
+            param_[LOCUT] = real(LOCUT);
             hpfOutL_.set(param_[LOCUT]);
-            break;
-        case 8:
             hpfOutR_.set(param_[LOCUT]);
-            break;
-        case 9:
-            lpfFB_[0].set(param_[HIDUMP]);
-            break;
-        case 10:
-            lpfFB_[1].set(param_[HIDUMP]);
-            break;
-        case 11:
-            lpfFB_[2].set(param_[HIDUMP]);
-            break;
-        case 12:
-            lpfFB_[3].set(param_[HIDUMP]);
-            break;
-        default:
-            break;
+        }
+        if (changed(HIDUMP)) {
+            param_[HIDUMP] = real(HIDUMP);
+            for (int i = 0; i < 4; i++)
+                lpfFB_[i].set(param_[HIDUMP]);
         }
     }
 
@@ -133,8 +91,6 @@ public:
 
         float ap, am, bp, bm, cp, cm, dp, dm, ep, em, fp, fm, gp, gm, hd, id, jd, kd, out_l, out_r;
 
-        setParam();
-
         for (uint32_t i = 0; i < BLOCK_SIZE; i++) {
             fxL[i] = bypassIn_.process(0.0f, xL[i], on);
             fxL[i] = 0.25f * lpfIn_.process(fxL[i]);
@@ -192,3 +148,6 @@ public:
         }
     }
 };
+
+// 静的メンバの定義 C++11ではconstexprでも必要
+constexpr fx::paramDef fx::reverb::PARAMS[];
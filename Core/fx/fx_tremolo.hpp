@@ -4,7 +4,6 @@
 #include "fx_base.h"
 #include "lib_calc.hpp"
 #include "lib_osc.hpp"
-#include <string.h>
 
 namespace fx {
 class tremolo;
@@ -18,77 +17,55 @@ private:
         RATE,
         DEPTH,
         WAVE,
+        SYNC,
         PARAM_TYPE_COUNT, // パラメータ種類総数
     };
-    float param_[PARAM_COUNT] = { 0.0f, 1.0f, 1.0f, 1.0f };
-    const int16_t PARAM_MAX[PARAM_COUNT] = { 100, 100, 100, 100 };
-    const int16_t PARAM_MIN[PARAM_COUNT] = { 0, 0, 0, 0 };
-    char const* const PARAM_NAME[PARAM_COUNT] = { "LEVEL", "RATE", "DEPTH", "WAVE" };
+    static constexpr paramDef PARAMS[] = {
+        { "LEVEL", 0, 100, 50, LINEAR, -20.0f, 20.0f, DB, 1, nullptr },
+        { "RATE", 0, 100, 50, LINEAR, 1.05f, 0.05f, SEC, 2, nullptr }, // 揺れの周期
+        { "DEPTH", 0, 100, 50, LINEAR, 0.0f, 10.0f, DB, 1, nullptr },  // 音量変化 ±dB
+        { "WAVE", 0, 100, 50, LINEAR, 0.0f, 50.0f, DB, 0, nullptr },   // 三角波～矩形波変形 増幅量
+        { "SYNC", 0, 7, 0, LIST, 0.0f, 0.0f, NONE, 0, SYNC_STR },      // タップテンポ同期 OFF: RATEを使う
+    };
+    static_assert(sizeof(PARAMS) / sizeof(PARAMS[0]) == PARAM_TYPE_COUNT, "PARAMS size");
+    float param_[PARAM_TYPE_COUNT] = { 0.0f, 1.0f, 1.0f, 1.0f, 0.0f };
 
     signalSw bypass_;
     triangleWave tri_;
 
 public:
+    tremolo() : base(PARAMS) {}
+
     char const* getFxName() const override { return "TREMOLO"; }
 
     uint16_t getLedColor(bool on) const override { return on ? 0b0000011111111111 /*青緑*/ : 0; }
 
-    uint8_t getParamTypeCount() const override { return PARAM_TYPE_COUNT; }
-
-    void init(int16_t const* loadData) override {
-        for (uint32_t i = 0; i < PARAM_COUNT; i++) {
-            g_fxParam[i].nameTxt = PARAM_NAME[i] ? PARAM_NAME[i] : "";
-            g_fxParam[i].max = PARAM_MAX[i];
-            g_fxParam[i].min = PARAM_MIN[i];
-            if (PARAM_MIN[i] <= loadData[i] && loadData[i] <= PARAM_MAX[i]) {
-                g_fxParam[i].value = loadData[i];
-            }
-            else {
-                g_fxParam[i].value = (PARAM_MIN[i] + PARAM_MAX[i]) / 2;
-            }
-        }
-    }
+    void init() override {}
 
     void deinit() override {}
 
-    void setParamStr(uint8_t paramIdx) override {
-        FxParam& fp = g_fxParam[paramIdx];
-        if (paramIdx < PARAM_TYPE_COUNT) {
-            snprintf(fp.valueTxt, sizeof(fp.valueTxt), "%d", fp.value);
-        }
-        else {
-            memset(fp.valueTxt, 0, sizeof(fp.valueTxt));
-        }
-    }
-
     void setParam() override {
-        static uint8_t count = 0;
-        count = (count + 1) % 10; // 負荷軽減のためパラメータ計算を分散させる
-        switch (count) {
-        case 0:
-            param_[LEVEL] = logPot(g_fxParam[LEVEL].value, -20.0f, 20.0f); // LEVEL -20 ～ 20dB
-            break;
-        case 1:
-            param_[RATE] = 0.01f * (105.0f - (float)g_fxParam[RATE].value); // Rate 0.05s ～ 1.05s
-            break;
-        case 2:
-            param_[DEPTH] = (float)g_fxParam[DEPTH].value * 0.1f; // Depth ±10dB
-            break;
-        case 3:
-            param_[WAVE] = logPot(g_fxParam[WAVE].value, 0.0f, 50.0f); // Wave 三角波～矩形波変形
-            break;
-        case 4:
+        if (changed(LEVEL))
+            param_[LEVEL] = dbToGain(real(LEVEL));
+        const bool sync = changed(SYNC);
+        if (sync)
+            param_[SYNC] = SYNC_BEATS[(uint8_t)value(SYNC)];
+        if (changed(RATE) || sync) {
+            param_[RATE] = real(RATE);
             tri_.set(param_[RATE]);
-            break;
-        default:
-            break;
         }
+        if (changed(DEPTH))
+            param_[DEPTH] = real(DEPTH);
+        if (changed(WAVE))
+            param_[WAVE] = dbToGain(real(WAVE));
     }
 
     void process(float (&xL)[BLOCK_SIZE], float (&xR)[BLOCK_SIZE], bool on) override {
         float fxL[BLOCK_SIZE] = {};
 
-        setParam();
+        float period, phase;
+        if (beatSync(param_[SYNC], period, phase))
+            tri_.set(period, phase); // タップテンポ同期
 
         for (uint32_t i = 0; i < BLOCK_SIZE; i++) {
             float gain = 2.0f * (tri_.output() - 0.5f);    // -1 ～ 1 dB LFO
@@ -100,3 +77,6 @@ public:
         }
     }
 };
+
+// 静的メンバの定義 C++11ではconstexprでも必要
+constexpr fx::paramDef fx::tremolo::PARAMS[];
@@ -3,6 +3,7 @@
 #include "common.h"
 #include "table_dbToGain.h"
 #include <cmath>
+#include <cstring> // memcpy
 
 inline float gainToDb(float x) // 使用範囲0.00001(-100dB)～1(0dB) 最大誤差0.016dB
 {
@@ -17,16 +18,44 @@ inline float dbToGain(float x) // 使用範囲±128dB 最大誤差0.015dB
                ((x + 128.0f) - (float)((uint8_t)(x + 128.0f)));
 }
 
+inline float log2Approx(float x) // 使用範囲 正の正規化数 最大誤差0.00021 (0.0013dB)
+{
+    uint32_t i;
+    memcpy(&i, &x, sizeof(i));
+    const float e = (float)((int32_t)(i >> 23) - 127); // 指数部
+    i = (i & 0x007FFFFF) | 0x3F800000;                 // 仮数部 1 ≦ m < 2
+    float m;
+    memcpy(&m, &i, sizeof(m));
+    return e - 2.4968058f + m * (4.0284505f + m * (-2.0811285f + m * (0.62884137f - 0.079153816f * m)));
+}
+
+inline float exp2Approx(float x) // 使用範囲±126 最大誤差0.019% (0.0017dB)
+{
+    const float n = floorf(x);
+    const float f = x - n; // 0 ≦ f < 1
+    const float p = 0.99981218f + f * (0.69683754f + f * (0.2241273f + f * 0.07902015f));
+    const uint32_t i = (uint32_t)((int32_t)n + 127) << 23; // 2^n
+    float s;
+    memcpy(&s, &i, sizeof(s));
+    return s * p;
+}
+
+// sqrtfを使わない 使用範囲 0より大きい値 最大誤差0.0013dB
+inline float gainToDbFast(float x) { return 6.0205999f * log2Approx(x); }
+
+// 表を使わない 使用範囲±750dB 最大誤差0.0017dB
+inline float dbToGainFast(float x) { return exp2Approx(0.16609640f * x); }
+
 inline float logPot(uint16_t pot, float dBmin, float dBmax) {
     // パラメータの値0～100を最小dB～最大dB倍率へ割り当てる
     float p = (dBmax - dBmin) * (float)pot * 0.01f + dBmin;
     return dbToGain(p); // dBから倍率へ変換
 }
 
-inline float mixPot(uint16_t pot, float dBmin) {
+inline float mixPot(float pot, float dBmin) {
     // パラメータの値0～100をMIX倍率へ割り当てる dBminは-6以下の負の値
     float a = (-6.0f - dBmin) * 0.02f; // dB増加の傾きを計算
-    if (pot == 0)
+    if (pot <= 0.0f)
         return 0.0f;
     else if (pot <= 50)
         return dbToGain((float)pot * a + dBmin); // dBmin ～ -6dB
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "common.h"
+#include "table_decimFir.h"
+
+/* ダウンサンプリング（間引き） FIRアンチエイリアスフィルタ付き ----------------------------*/
+// 出力するサンプル（FACTOR回に1回）のみFIRを計算するポリフェーズ構成
+// 44.1kHz → 1/4: 11.0kHz、1/8: 5.5kHz 係数はカットオフ3.5kHzのため1/4まで推奨
+template <uint32_t FACTOR>
+class decimator {
+private:
+    static constexpr uint32_t TAPS = sizeof(decimFirCoef) / sizeof(decimFirCoef[0]);
+
+    float hist[2 * TAPS] = {}; // 入力履歴 2周分保存し、積和を連続したメモリで行う
+    uint32_t wpos = 0;         // write position 書込位置
+    uint32_t phase = 0;        // 間引きカウント 0 ～ FACTOR-1
+
+public:
+    decimator() {}
+
+    bool process(float x, float& y) // 入力1サンプル 出力がある場合trueを返す
+    {
+        hist[wpos] = x;
+        hist[wpos + TAPS] = x;
+        wpos++;
+        if (wpos == TAPS)
+            wpos = 0;
+
+        phase++;
+        if (phase < FACTOR)
+            return false;
+        phase = 0;
+
+        // hist[wpos] ～ hist[wpos + TAPS - 1] が古い順に並んでいる
+        float const* h = &hist[wpos];
+        float acc = 0.0f;
+        for (uint32_t k = 0; k < TAPS; k++)
+            acc += decimFirCoef[k] * h[k]; // 係数は左右対称のため並び順の反転は不要
+        y = acc;
+        return true;
+    }
+
+    void reset() {
+        for (uint32_t i = 0; i < 2 * TAPS; i++)
+            hist[i] = 0.0f;
+        wpos = 0;
+        phase = 0;
+    }
+};
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "common.h"
+#include "lib_calc.hpp"
+#include <cmath>
+
+/* コンプレッサー ゲイン計算 ------------------------------------------------------*/
+// ブロックごとのレベル(dB)から静特性（スレッショルド・レシオ・ニー）で圧縮量を求め、アタック・リリースで平滑化する
+// dBの計算はブロックごとに1回のみ サンプルごとの処理は呼出側でのゲインの補間と乗算のみとする
+class compGain {
+private:
+    float threshold = 0.0f; // スレッショルド dB
+    float slope = 0.0f;     // 1 - 1 / レシオ
+    float knee = 0.0f;      // ニー幅 dB
+    float attack = 0.0f;    // 1ブロックあたりの係数
+    float release = 0.0f;   // 1ブロックあたりの係数
+    float reduction = 0.0f; // 平滑化した圧縮量 dB 0以上
+
+public:
+    compGain() {}
+
+    void set(float thresholdDb, float ratio, float kneeDb) // 静特性設定
+    {
+        threshold = thresholdDb;
+        slope = 1.0f - 1.0f / ratio;
+        knee = kneeDb;
+    }
+
+    void setTime(float attackMsec, float releaseMsec, uint32_t blockSize) // 時定数 ms
+    {
+        attack = expf(-1000.0f * (float)blockSize / (attackMsec * SAMPLING_FREQ));
+        release = expf(-1000.0f * (float)blockSize / (releaseMsec * SAMPLING_FREQ));
+    }
+
+    float process(float levelDb) // ブロックのレベル dB → ゲイン dB 0以下
+    {
+        const float over = levelDb - threshold;
+        float target;
+        if (2.0f * over <= -knee)
+            target = 0.0f;
+        else if (2.0f * over >= knee)
+            target = slope * over;
+        else {
+            const float t = over + 0.5f * knee; // ニーの範囲内は2次曲線でつなぐ
+            target = slope * t * t / (2.0f * knee);
+        }
+        const float a = (target > reduction) ? attack : release;
+        reduction = target + a * (reduction - target);
+        return -reduction;
+    }
+
+    float getReduction() const { return reduction; } // 圧縮量 dB
+};
+
+/* ブリックウォールリミッター ------------------------------------------------------*/
+// 先読みなし ブロックのピークが上限を超える場合は、そのブロックの先頭からゲインを下げる
+// 処理前に1ブロック分のサンプルが揃っているため、出力は必ず上限以下になる
+// ゲインを戻す（リリース）方向はブロック内で直線補間し、補間中も上限を超えない
+class brickwallLimiter {
+private:
+    const float ceiling; // 上限
+    float release;       // 1ブロックあたりの係数
+    float gain = 1.0f;   // 現在のゲイン
+
+public:
+    brickwallLimiter(float ceiling, float releaseMsec, uint32_t blockSize) : ceiling(ceiling) {
+        release = expf(-1000.0f * (float)blockSize / (releaseMsec * SAMPLING_FREQ));
+    }
+
+    template <uint32_t N>
+    bool process(float (&x)[N]) // 1ブロック処理 ゲインを下げている場合trueを返す
+    {
+        float peak = 0.0f;
+        for (uint32_t i = 0; i < N; i++)
+            peak = fmaxf(peak, fabsf(x[i]));
+        float target = 1.0f;
+        if (peak > ceiling) {
+            target = ceiling / peak;
+            if (peak * target > ceiling)
+                target = nextafterf(target, 0.0f); // 除算の丸めで上限をわずかに超えないようにする
+        }
+        if (target < gain) {
+            gain = target; // 即座に下げる
+            for (uint32_t i = 0; i < N; i++)
+                x[i] *= gain;
+            return true;
+        }
+        if (gain >= 1.0f)
+            return false; // 制限なし 乗算も省く
+        float g = target + release * (gain - target);
+        if (g > 0.9999f)
+            g = 1.0f;
+        g = fminf(g, target); // 1への切上げ・丸めで目標を超えない
+        const float step = (g - gain) / (float)N;
+        for (uint32_t i = 0; i < N; i++) {
+            gain = fminf(gain + step, g); // 加算の誤差で g を超えない
+            x[i] *= gain;
+        }
+        gain = g;
+        return g < 1.0f;
+    }
+
+    float getGain() const { return gain; } // 現在のゲイン
+};
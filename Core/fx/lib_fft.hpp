@@ -0,0 +1,95 @@
+#pragma once
+
+#include "common.h"
+#include <algorithm>
+#include <cmath>
+
+/* 高速フーリエ変換 実数入力 基数2 ------------------------------------------------*/
+// N個の実数をN/2点の複素数（偶数番目を実部、奇数番目を虚部）として変換した後、
+// 実数入力のスペクトルに分離する 複素FFTをそのまま使う場合の約半分の計算量・メモリで済む
+// N は2のべき乗とすること
+template <uint32_t N>
+class fft {
+private:
+    static_assert(N >= 8 && (N & (N - 1)) == 0, "N must be a power of 2");
+    static constexpr uint32_t M = N / 2; // 複素FFT 点数
+
+    float sinTable[N / 4 + 1]; // sin(2πk/N) k: 0 ～ N/4 1/4周期分のみ保存
+
+    float sinN(uint32_t k) const // sin(2πk/N) k: 0 ～ N/2
+    {
+        return (k <= N / 4) ? sinTable[k] : sinTable[N / 2 - k];
+    }
+
+    float cosN(uint32_t k) const // cos(2πk/N) k: 0 ～ N/2
+    {
+        return (k <= N / 4) ? sinTable[N / 4 - k] : -sinTable[k - N / 4];
+    }
+
+public:
+    fft() {
+        for (uint32_t k = 0; k <= N / 4; k++)
+            sinTable[k] = sinf(2.0f * PI * (float)k / (float)N);
+    }
+
+    void complexProcess(float x[]) // 複素FFT M点 x: 実部・虚部を交互に並べた配列 結果で上書き
+    {
+        // ビット反転並べ替え
+        for (uint32_t i = 0, j = 0; i < M; i++) {
+            if (i < j) {
+                std::swap(x[2 * i], x[2 * j]);
+                std::swap(x[2 * i + 1], x[2 * j + 1]);
+            }
+            uint32_t bit = M >> 1;
+            while (j & bit) {
+                j ^= bit;
+                bit >>= 1;
+            }
+            j |= bit;
+        }
+
+        // バタフライ演算 回転因子 W = exp(-j2πk/len) をsinTableから読み出す
+        for (uint32_t len = 2; len <= M; len <<= 1) {
+            const uint32_t half = len / 2;
+            const uint32_t step = N / len; // sinTableの添字間隔
+            for (uint32_t k = 0; k < half; k++) {
+                const float wr = cosN(k * step);
+                const float wi = -sinN(k * step);
+                for (uint32_t i = k; i < M; i += len) {
+                    float* a = &x[2 * i];
+                    float* b = &x[2 * (i + half)];
+                    const float tr = b[0] * wr - b[1] * wi;
+                    const float ti = b[0] * wi + b[1] * wr;
+                    b[0] = a[0] - tr;
+                    b[1] = a[1] - ti;
+                    a[0] += tr;
+                    a[1] += ti;
+                }
+            }
+        }
+    }
+
+    void powerSpectrum(float x[], float p[]) // 実数N点 → パワースペクトル p[0] ～ p[N/2-1] xは作業用に上書き
+    {
+        complexProcess(x);
+
+        // Z[k]: 複素FFT結果 偶数番目 E[k] = (Z[k] + Z*[M-k]) / 2、奇数番目 O[k] = -j(Z[k] - Z*[M-k]) / 2
+        // X[k] = E[k] + exp(-j2πk/N)O[k]
+        p[0] = (x[0] + x[1]) * (x[0] + x[1]);
+        for (uint32_t k = 1; k < M; k++) {
+            const float zr = x[2 * k];
+            const float zi = x[2 * k + 1];
+            const float cr = x[2 * (M - k)];
+            const float ci = -x[2 * (M - k) + 1];
+            const float er = 0.5f * (zr + cr);
+            const float ei = 0.5f * (zi + ci);
+            const float or_ = 0.5f * (zi - ci);
+            const float oi = -0.5f * (zr - cr);
+            const float wr = cosN(k);
+            const float wi = -sinN(k);
+            const float xr = er + or_ * wr - oi * wi;
+            const float xi = ei + or_ * wi + oi * wr;
+            p[k] = xr * xr + xi * xi;
+        }
+    }
+};
@@ -6,6 +6,12 @@
 /* 2 * PI * fc / fs 計算 -----------------------------*/
 inline float omega(float fc) { return 2.0f * PI * fc / SAMPLING_FREQ; }
 
+/* tan近似 パデ近似 使用範囲0～1.2 (fc ≒ 0.38fs) 最大誤差0.0002% ---------------------*/
+inline float tanApprox(float x) {
+    const float x2 = x * x;
+    return x * (945.0f - 105.0f * x2 + x2 * x2) / (945.0f - 420.0f * x2 + 15.0f * x2 * x2);
+}
+
 /* 1次LPF、HPF、APF用の係数計算、50～10kHzでの近似曲線 -----------------------------*/
 inline float lpfCoef(float fc) {
     float w = omega(fc);
@@ -352,3 +358,69 @@ public:
         b2 = 1.0f;
     }
 };
+
+/* 状態変数フィルタ (TPT) -------------------------------------------------------*/
+// 台形積分による2次の状態変数フィルタ LPF・BPF・HPFを同時に出力する
+// サンプルごとに周波数を変えても発散しないため、エンベロープ等での周波数変調に使う
+// 周波数変更は tanApprox と除算1回で、biquadFilter の係数計算と同程度の処理量
+class svf {
+private:
+    float k = 1.0f; // 1 / Q
+    float a1 = 1.0f, a2 = 0.0f, a3 = 0.0f;
+    float ic1 = 0.0f, ic2 = 0.0f; // 積分器の状態
+
+public:
+    float lp = 0.0f, bp = 0.0f, hp = 0.0f; // 出力 processで更新
+
+    svf() { set(1000.0f, 0.707f); }
+
+    svf(float fc, float q) { set(fc, q); }
+
+    void set(float fc, float q) // 周波数、Q設定
+    {
+        k = 1.0f / q;
+        setFreq(fc);
+    }
+
+    void setFreq(float fc) // 周波数のみ設定 サンプルごとに呼んでよい fc < 0.38fs
+    {
+        const float g = tanApprox(PI * fc / SAMPLING_FREQ);
+        a1 = 1.0f / (1.0f + g * (g + k));
+        a2 = g * a1;
+        a3 = g * a2;
+    }
+
+    void process(float x) {
+        const float v3 = x - ic2;
+        const float v1 = a1 * ic1 + a2 * v3;
+        const float v2 = ic2 + a2 * ic1 + a3 * v3;
+        ic1 = 2.0f * v1 - ic1;
+        ic2 = 2.0f * v2 - ic2;
+        lp = v2;
+        bp = v1;
+        hp = x - k * v1 - v2;
+    }
+};
+
+/* エンベロープフォロワー ----------------------------------------------------------*/
+// 絶対値を立ち上がり・立ち下がりで異なる時定数の1次LPFで平滑化する
+class envFollower {
+private:
+    float attack = 0.0f, release = 0.0f, y1 = 0.0f;
+
+public:
+    envFollower() { set(5.0f, 100.0f); }
+
+    void set(float attackMsec, float releaseMsec) // 時定数 ms
+    {
+        attack = expf(-1000.0f / (attackMsec * SAMPLING_FREQ));
+        release = expf(-1000.0f / (releaseMsec * SAMPLING_FREQ));
+    }
+
+    float process(float x) {
+        x = fabsf(x);
+        const float a = (x > y1) ? attack : release;
+        y1 = x + a * (y1 - x);
+        return y1;
+    }
+};
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstdint>
+
+/* 文字列書式化 固定長バッファ ----------------------------------------------------*/
+// snprintf・std::string の代わりに画面表示用の文字列を作る ヒープ確保なし
+// 呼出側の配列へ追記していき、入りきらない文字は切り捨てる 常に'\0'で終わる
+// 例: strFormat(str).fixed(freq100, 2).str("Hz"); // 440.00Hz
+class strFormat {
+private:
+    char* buf;    // 書込先
+    uint32_t cap; // 書込可能な最大文字数 ('\0'を除く)
+    uint32_t len; // 書込済の文字数
+
+public:
+    template <uint32_t SIZE>
+    strFormat(char (&dst)[SIZE]) : strFormat(dst, SIZE) {}
+
+    strFormat(char* dst, uint32_t size) : buf(dst), cap(size - 1), len(0) { buf[0] = '\0'; }
+
+    char const* c_str() const { return buf; }
+
+    uint32_t length() const { return len; }
+
+    strFormat& ch(char c) // 1文字追記
+    {
+        if (len < cap) {
+            buf[len++] = c;
+            buf[len] = '\0';
+        }
+        return *this;
+    }
+
+    strFormat& str(char const* s) // 文字列追記 単位（ms, Hz, dB, bpm 等）にも使う
+    {
+        while (*s && len < cap)
+            buf[len++] = *s++;
+        buf[len] = '\0';
+        return *this;
+    }
+
+    strFormat& dec(int32_t v, uint8_t minDigits = 1, char pad = ' ') // 10進整数 minDigits桁までpadで埋める
+    {
+        char digits[11]; // 下の桁から格納 最大10桁
+        uint32_t n = 0;
+        uint32_t u = (v < 0) ? 0u - (uint32_t)v : (uint32_t)v;
+        do {
+            digits[n++] = '0' + u % 10;
+            u /= 10;
+        } while (u);
+        uint32_t width = n + (v < 0 ? 1 : 0);
+        if (pad == '0' && v < 0)
+            ch('-'); // 0埋めの場合、符号は先頭
+        for (; width < minDigits; width++)
+            ch(pad);
+        if (pad != '0' && v < 0)
+            ch('-');
+        while (n)
+            ch(digits[--n]);
+        return *this;
+    }
+
+    strFormat& fixed(int32_t v, uint8_t decimals) // 固定小数点 vは10^decimals倍した整数 例: (1234, 2) → 12.34
+    {
+        if (decimals == 0)
+            return dec(v);
+        uint32_t scale = 1;
+        for (uint8_t i = 0; i < decimals; i++)
+            scale *= 10;
+        uint32_t u = (v < 0) ? 0u - (uint32_t)v : (uint32_t)v;
+        if (v < 0)
+            ch('-');
+        dec(u / scale);
+        ch('.');
+        return dec(u % scale, decimals, '0');
+    }
+
+    strFormat& fixed(float v, uint8_t decimals) // 小数 decimals桁で四捨五入
+    {
+        float scale = 1.0f;
+        for (uint8_t i = 0; i < decimals; i++)
+            scale *= 10.0f;
+        v *= scale;
+        return fixed((int32_t)(v < 0.0f ? v - 0.5f : v + 0.5f), decimals);
+    }
+};
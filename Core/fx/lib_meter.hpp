@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+
+/* レベルメーター ピーク・RMS・クリップ回数 ------------------------------------------*/
+// 呼出側の既存のループで1ブロック分のピーク・2乗和を求めて add() に渡す（サンプルを再度走査しない）
+// WINDOWサンプルごとに結果を32ビット1語にまとめて公開するため、表示側は排他制御なしで読み出せる
+// 書込はI2S割込み、読出は表示タスクのように、それぞれ1つの場合のみ使える
+template <uint32_t WINDOW>
+class levelMeter {
+private:
+    float peak = 0.0f;  // 集計中 ピーク
+    float sumSq = 0.0f; // 集計中 2乗和
+    uint32_t count = 0; // 集計中 サンプル数
+
+    std::atomic<uint32_t> level{ 0 };     // 公開値 上位16ビット: ピーク 下位16ビット: RMS 1.0 = 65535
+    std::atomic<uint32_t> clipCount{ 0 }; // 公開値 クリップしたブロック数
+
+    static uint32_t toU16(float x) { return (x >= 1.0f) ? 65535 : (uint32_t)(x * 65535.0f); }
+
+public:
+    levelMeter() {}
+
+    void add(float blockPeak, float blockSumSq, uint32_t n, bool clipped) // 1ブロック分を集計 書込側
+    {
+        if (blockPeak > peak)
+            peak = blockPeak;
+        sumSq += blockSumSq;
+        count += n;
+        if (clipped)
+            clipCount.store(clipCount.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+        if (count >= WINDOW) {
+            level.store(toU16(peak) << 16 | toU16(sqrtf(sumSq / (float)count)), std::memory_order_relaxed);
+            peak = 0.0f;
+            sumSq = 0.0f;
+            count = 0;
+        }
+    }
+
+    void get(float& peakOut, float& rmsOut) const // 直近WINDOWサンプルのピーク・RMS 読出側
+    {
+        const uint32_t x = level.load(std::memory_order_relaxed);
+        peakOut = (float)(x >> 16) * (1.0f / 65535.0f);
+        rmsOut = (float)(x & 0xFFFF) * (1.0f / 65535.0f);
+    }
+
+    uint32_t getClipCount() const // 起動時からのクリップしたブロック数 読出側
+    {
+        return clipCount.load(std::memory_order_relaxed);
+    }
+};
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+/* ロックフリー リングバッファ 書込1つ・読出1つ (SPSC) 専用 ---------------------------*/
+// 書込側（I2S割込み等）と読出側（タスク）がそれぞれ1つの場合のみ排他制御なしで使える
+// SIZE は2のべき乗とすること
+template <typename T, uint32_t SIZE>
+class ringBuf {
+private:
+    static_assert((SIZE & (SIZE - 1)) == 0, "SIZE must be a power of 2");
+
+    T buf[SIZE];
+    std::atomic<uint32_t> wpos{ 0 }; // write position 書込位置 書込側のみ更新
+    std::atomic<uint32_t> rpos{ 0 }; // read position 読出位置 読出側のみ更新
+
+public:
+    ringBuf() {}
+
+    bool push(T const& x) // 書込 満杯の場合は書き込まずfalseを返す
+    {
+        uint32_t w = wpos.load(std::memory_order_relaxed);
+        if (w - rpos.load(std::memory_order_acquire) == SIZE)
+            return false;
+        buf[w & (SIZE - 1)] = x;
+        wpos.store(w + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T& x) // 読出 空の場合はfalseを返す
+    {
+        uint32_t r = rpos.load(std::memory_order_relaxed);
+        if (r == wpos.load(std::memory_order_acquire))
+            return false;
+        x = buf[r & (SIZE - 1)];
+        rpos.store(r + 1, std::memory_order_release);
+        return true;
+    }
+
+    uint32_t size() const // 読出可能なデータ数
+    {
+        return wpos.load(std::memory_order_acquire) - rpos.load(std::memory_order_acquire);
+    }
+
+    void clear() // 読出側から呼ぶこと
+    {
+        rpos.store(wpos.load(std::memory_order_acquire), std::memory_order_release);
+    }
+};
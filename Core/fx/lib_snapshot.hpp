@@ -0,0 +1,44 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+/* ロックフリー 値の受渡し 書込1つ・読出1つ (SPSC) 専用 ------------------------------*/
+// 書込側（画面表示タスク等）が更新した構造体全体を、読出側（I2S割込み等）が一貫した状態で受け取る
+// 2つのバッファを交互に書き換え、書込回数（seq）で書込中・書込完了を示す
+// 書込側は待たない 読出側は読出中に同じバッファへ書き込まれた場合のみ読み直す
+// 割込みが書込側を中断して読み出す場合、読み直しは発生しない
+template <typename T>
+class snapshot {
+private:
+    T buf[2];
+    // 書込状態 偶数: 書込完了 奇数: 書込中
+    // 最新の値は buf[(seq / 2) % 2]、書込中は buf[(seq / 2 + 1) % 2] へ書き込む
+    std::atomic<uint32_t> seq{ 0 };
+
+public:
+    snapshot() : buf() {}
+
+    void write(T const& x) // 書込
+    {
+        const uint32_t s = seq.load(std::memory_order_relaxed);
+        seq.store(s + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release); // 書込中を示してからバッファを書き換える
+        buf[(s / 2 + 1) % 2] = x;
+        seq.store(s + 2, std::memory_order_release);
+    }
+
+    void read(T& x) const // 読出 最新の値をコピーする
+    {
+        for (;;) {
+            const uint32_t s = seq.load(std::memory_order_acquire);
+            x = buf[(s / 2) % 2];
+            std::atomic_thread_fence(std::memory_order_acquire);
+            // 読み出したバッファへの書込は seq が (s & ~1) + 3 以上になった時点で始まる
+            if (seq.load(std::memory_order_relaxed) - (s & ~1u) < 3)
+                return;
+        }
+    }
+
+    uint32_t count() const { return seq.load(std::memory_order_acquire) / 2; } // 書込完了回数
+};
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+/* タップテンポ クロック -------------------------------------------------------------*/
+// タップ間隔を最大HISTORY回分記録し、中央値から外れた間隔を除いて平均する
+// 前回の平均から大きく外れた間隔はテンポを変えたとみなし、記録を消して数え直す
+// 時刻は呼出側の単位（ms）で与える RTOSに依存しないため、ホスト（PC）でもテストできる
+// 書込（tap）と読出は同じタスクから行うこと
+class tempoClock {
+private:
+    static constexpr uint32_t HISTORY = 4; // 平均するタップ間隔の数
+    static constexpr float OUTLIER = 0.2f; // 中央値からこの割合以上外れた間隔は平均しない
+    static constexpr float RESTART = 0.3f; // 平均からこの割合以上外れた間隔で数え直す
+
+    const float minMsec;     // 有効なタップ間隔 最小
+    const float maxMsec;     // 有効なタップ間隔 最大 超えた場合は次のタップから数え直す
+    float interval[HISTORY]; // タップ間隔 リングバッファ
+    uint32_t count = 0;      // 記録したタップ間隔の数
+    bool tapped = false;     // 前回のタップ時刻あり
+    uint32_t lastTap = 0;    // 前回のタップ時刻
+    float beat = 0.0f;       // 1拍の時間 0: テンポなし
+    uint32_t beatStart = 0;  // 拍の先頭の時刻 最後に有効だったタップ時刻
+    uint32_t tapSeq = 0;     // テンポを更新した回数
+
+public:
+    tempoClock(float minMsec, float maxMsec) : minMsec(minMsec), maxMsec(maxMsec), interval() {}
+
+    bool tap(uint32_t time) // タップ テンポを更新した場合trueを返す
+    {
+        const float t = (float)(time - lastTap);
+        const bool first = !tapped;
+        tapped = true;
+        lastTap = time;
+        if (first || t < minMsec || maxMsec < t) {
+            count = 0; // 間隔が範囲外 次のタップから数え直す
+            return false;
+        }
+        if (count > 0 && fabsf(t - beat) > RESTART * beat)
+            count = 0; // テンポを変えた
+
+        interval[count % HISTORY] = t;
+        count++;
+        uint32_t n = count;
+        if (n > HISTORY)
+            n = HISTORY;
+
+        // 中央値 挿入ソート
+        float sorted[HISTORY];
+        for (uint32_t i = 0; i < n; i++) {
+            uint32_t j = i;
+            for (; j > 0 && sorted[j - 1] > interval[i]; j--)
+                sorted[j] = sorted[j - 1];
+            sorted[j] = interval[i];
+        }
+        const float median = (n % 2) ? sorted[n / 2] : 0.5f * (sorted[n / 2 - 1] + sorted[n / 2]);
+
+        // 中央値に近い間隔のみ平均する
+        float sum = 0.0f;
+        uint32_t m = 0;
+        for (uint32_t i = 0; i < n; i++) {
+            if (fabsf(sorted[i] - median) <= OUTLIER * median) {
+                sum += sorted[i];
+                m++;
+            }
+        }
+        beat = (m > 0) ? sum / (float)m : median;
+        beatStart = time;
+        tapSeq++;
+        return true;
+    }
+
+    void restart() // 次のタップから数え直す テンポは保持する
+    {
+        count = 0;
+        tapped = false;
+    }
+
+    void clear() // テンポなしに戻す
+    {
+        count = 0;
+        tapped = false;
+        beat = 0.0f;
+    }
+
+    float beatMsec() const { return beat; }         // 1拍の時間 0: テンポなし
+    uint32_t beatTime() const { return beatStart; } // 拍の先頭の時刻
+    uint32_t seq() const { return tapSeq; }         // テンポを更新した回数
+    uint32_t taps() const { return count; }         // 記録したタップ間隔の数
+
+    float beatPos(uint32_t now) const // 拍の先頭からの拍数
+    {
+        return (beat > 0.0f) ? (float)(now - beatStart) / beat : 0.0f;
+    }
+};
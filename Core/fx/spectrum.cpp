@@ -0,0 +1,104 @@
+#include "spectrum.h"
+#include "cmsis_os.h"
+#include "lib_fft.hpp"
+#include "lib_ringBuf.hpp"
+#include <cmath>
+
+/*
+ * スペクトラムアナライザー
+ *
+ * I2S割込みでは出力音を2サンプルずつ平均して1/2に間引き、リングバッファへ渡すのみとする
+ * FFTは画面表示タスクで、一定間隔（SPECTRUM_INTERVAL_MSEC）ごとに最新specFftSize個に対して行う
+ * 各帯域は対数間隔とし、帯域内のビンの最大値をその帯域のレベルとする
+ */
+
+// 各設定
+const float specSamplingFreq = SAMPLING_FREQ / 2;         // 解析のサンプリング周波数 22kHz
+const uint16_t specFftSize = 1024;                        // FFTサイズ 約46ms
+const float specBinFreq = specSamplingFreq / specFftSize; // FFT 1ビンの周波数 約21.5Hz
+const float specMinFreq = 50.0f;                          // 最低帯域 下端周波数
+const float specMaxFreq = 10000.0f;                       // 最高帯域 上端周波数
+const float specFullScale = 0.25f * specFftSize;          // フルスケール正弦波の振幅 ハン窓の利得1/2 × N/2
+const float specMinPower = 1.0e-12f;                      // log計算用 最小パワー
+
+// 各変数
+ringBuf<float, 1024> specRing;               // I2S割込みから受け取る間引き済出力音
+float specHist[specFftSize] = {};            // 出力音 循環バッファ
+uint16_t specHistPos = 0;                    // 循環バッファ 書込位置（最も古いデータの位置）
+float specWork[specFftSize];                 // FFT作業用
+float specPower[specFftSize / 2];            // パワースペクトル
+fft<specFftSize> specFft;                    // FFT
+uint16_t specBandFirst[SPECTRUM_BANDS] = {}; // 各帯域 最初のビン
+uint16_t specBandLast[SPECTRUM_BANDS] = {};  // 各帯域 最後のビン
+uint32_t specLastTick = 0;                   // 前回解析した時刻 ms
+
+// 初期化 ------------------------------------------------------------------------
+void spectrumInit() {
+    const float ratio = powf(specMaxFreq / specMinFreq, 1.0f / SPECTRUM_BANDS); // 帯域ごとの周波数比
+    float lo = specMinFreq;
+    for (uint32_t b = 0; b < SPECTRUM_BANDS; b++) {
+        const float hi = lo * ratio;
+        uint16_t first = (uint16_t)ceilf(lo / specBinFreq);
+        uint16_t last = (uint16_t)ceilf(hi / specBinFreq) - 1;
+        if (first > last) {
+            // 低域でビン間隔より狭い帯域は中心に最も近いビンを使う
+            first = last = (uint16_t)(sqrtf(lo * hi) / specBinFreq + 0.5f);
+        }
+        specBandFirst[b] = first;
+        specBandLast[b] = std::min<uint16_t>(last, specFftSize / 2 - 1);
+        lo = hi;
+    }
+}
+
+// 入力リセット 表示タスクから呼ぶ -------------------------------------------------
+void spectrumClear() {
+    specRing.clear();
+    for (uint16_t i = 0; i < specFftSize; i++)
+        specHist[i] = 0.0f;
+    specHistPos = 0;
+}
+
+// 出力音受け渡し I2S割込みから呼ぶ -------------------------------------------------
+void spectrumInput(float const (&xL)[fx::BLOCK_SIZE]) {
+    static_assert(fx::BLOCK_SIZE % 2 == 0, "BLOCK_SIZE must be even");
+    for (uint32_t i = 0; i < fx::BLOCK_SIZE; i += 2) {
+        specRing.push(0.5f * (xL[i] + xL[i + 1])); // 2サンプル平均で間引き 満杯の場合は捨てる
+    }
+}
+
+// 解析 表示タスクから呼ぶ ---------------------------------------------------------
+bool spectrumUpdate(float (&bandDb)[SPECTRUM_BANDS]) {
+    float x;
+    while (specRing.pop(x)) {
+        specHist[specHistPos] = x;
+        specHistPos = (specHistPos + 1) % specFftSize;
+    }
+
+    // 解析頻度の上限
+    const uint32_t tick = osKernelSysTick();
+    if (tick - specLastTick < SPECTRUM_INTERVAL_MSEC)
+        return false;
+    specLastTick = tick;
+
+    // ハン窓 w[i] = 0.5 - 0.5cos(2πi/N) cosは回転の漸化式で求める
+    const float c = cosf(2.0f * PI / specFftSize);
+    const float s = sinf(2.0f * PI / specFftSize);
+    float wc = 1.0f, ws = 0.0f;
+    for (uint16_t i = 0; i < specFftSize; i++) {
+        specWork[i] = (0.5f - 0.5f * wc) * specHist[(specHistPos + i) % specFftSize];
+        const float t = wc * c - ws * s;
+        ws = ws * c + wc * s;
+        wc = t;
+    }
+    specFft.powerSpectrum(specWork, specPower);
+
+    // 帯域内の最大値をdBへ
+    const float norm = 1.0f / (specFullScale * specFullScale);
+    for (uint32_t b = 0; b < SPECTRUM_BANDS; b++) {
+        float p = specPower[specBandFirst[b]];
+        for (uint16_t k = specBandFirst[b] + 1; k <= specBandLast[b]; k++)
+            p = std::max(p, specPower[k]);
+        bandDb[b] = std::max(10.0f * log10f(p * norm + specMinPower), -SPECTRUM_RANGE_DB);
+    }
+    return true;
+}
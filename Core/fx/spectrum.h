@@ -0,0 +1,24 @@
+#pragma once
+
+#include "common.h"
+#include "fx_base.h"
+
+/// スペクトラム表示 帯域数
+constexpr uint32_t SPECTRUM_BANDS = 42;
+
+/// @brief 初期化 各帯域のFFTビン範囲を計算
+void spectrumInit();
+
+/// @brief 解析用の入力をリセット 表示開始時に呼ぶ
+void spectrumClear();
+
+/// @brief 出力音受け渡し I2S受信割込み（ハーフ/フル）から呼ぶ
+/// 1/2に間引いてリングバッファへ渡すのみ行う
+/// @param[in] xL L音声信号
+void spectrumInput(float const (&xL)[fx::BLOCK_SIZE]);
+
+/// @brief 解析 画面表示タスクから呼ぶ
+/// リングバッファの内容を取り込み、前回の解析からSPECTRUM_INTERVAL_MSEC以上経過していればFFTを行う
+/// @param[out] bandDb 各帯域のレベル dB 0: フルスケールの正弦波 最小 -SPECTRUM_RANGE_DB
+/// @return 解析を行った場合true
+bool spectrumUpdate(float (&bandDb)[SPECTRUM_BANDS]);
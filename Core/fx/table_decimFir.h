@@ -0,0 +1,10 @@
+#pragma once
+
+/* ダウンサンプリング用 アンチエイリアスFIR係数 32タップ */
+
+// SAMPLING_FREQ 44.1kHz カットオフ3.5kHz ハミング窓 -0.6dB@2kHz -36dB@5.5kHz -57dB@6kHz以上
+const float decimFirCoef[32] = { 0.00162458352f, 0.00158709288f, 0.00119287141f, -0.000210229051f, -0.00321472179f,
+    -0.007768001f, -0.0126955848f, -0.015616919f, -0.0134103841f, -0.00316598787f, 0.0166594573f, 0.0453034693f,
+    0.0793722002f, 0.113341607f, 0.140814962f, 0.156185584f, 0.156185584f, 0.140814962f, 0.113341607f, 0.0793722002f,
+    0.0453034693f, 0.0166594573f, -0.00316598787f, -0.0134103841f, -0.015616919f, -0.0126955848f, -0.007768001f,
+    -0.00321472179f, -0.000210229051f, 0.00119287141f, 0.00158709288f, 0.00162458352f };
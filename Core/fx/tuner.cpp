@@ -1,43 +1,116 @@
 #include "tuner.h"
 #include "cmsis_os.h"
 #include "fx_base.h"
+#include "lib_decimator.hpp"
+#include "lib_fft.hpp"
 #include "lib_filter.hpp"
+#include "lib_format.hpp"
+#include "lib_ringBuf.hpp"
+#include "main.h" // DWT
 #include "ssd1306.hpp"
 #include <cmath>
-#include <string>
 
 /*
  * ギター チューナー(ベースでの動作未確認)
  * ブロックサイズ 16, 32, 64 サンプリング周波数 44.1kHz 48kHz を想定
  *
+ * I2S割込みでは入力音を1/TUNER_DECIMATIONに間引いてリングバッファへ渡すのみとし、
+ * 周波数の解析は優先度の低い専用タスクで行う（エフェクト処理と並行して動作）
+ *
+ * 周波数の推定方法は下記から選択する
+ * ・BIT: ビットストリーム自己相関 + ゼロクロス補間 軽量 70Hz以上
+ * ・YIN: 累積平均正規化差分関数 + 放物線補間 高精度 30Hz以上
+ * ・MPM: McLeod Pitch Method (NSDF) + 放物線補間 高精度 30Hz以上
+ * ・POLY: 窓付きFFT + 倍音和 開放弦6本を同時に判定（ストローク1回で全弦のズレを表示）
+ *
  * 下記ページのコードを改変して使用
  * https://www.cycfi.com/2018/03/fast-and-efficient-pitch-detection-bitstream-autocorrelation/
  */
 
 // 各設定
-const float muteOff = 0.0f;                                   // 0:出力ミュート 1:ミュートしない
-const float freqA = 440.0f;                                   // 基準A音周波数 Hz
-const float minFreq = 70.0f;                                  // 最低周波数 ギター 6弦ドロップD音 73Hz
-const float maxFreq = 400.0f;                                 // 最高周波数 ギター 1弦5フレットA音 440Hz
-const float tunerSamplingFreq = SAMPLING_FREQ;                // チューナーでのサンプリング周波数
-const uint16_t minPeriod = tunerSamplingFreq / maxFreq;       // 最小周期サンプル区間
-const uint16_t maxPeriod = tunerSamplingFreq / minFreq;       // 最大周期サンプル区間
-const uint16_t inDataSize = 64 * ((maxPeriod * 2) / 64) + 64; // 入力音配列 データ数 64の倍数にする
-const uint16_t bitStreamSize = inDataSize / 32;               // ビットストリーム配列 データ数
-const float noiseThrethold = 0.02f;                           // ノイズ除去用閾値
+const float minFreq = 70.0f;                                      // 最低周波数 ギター 6弦ドロップD音 73Hz
+const float minFreqFine = 30.0f;                                  // 最低周波数 YIN/MPM ベース 5弦B音 31Hz
+const float maxFreq = 400.0f;                                     // 最高周波数 ギター 1弦5フレットA音 440Hz
+const float tunerSamplingFreq = SAMPLING_FREQ / TUNER_DECIMATION; // チューナーでのサンプリング周波数
+const uint16_t minPeriod = tunerSamplingFreq / maxFreq;           // 最小周期サンプル区間
+const uint16_t maxPeriod = tunerSamplingFreq / minFreq;           // 最大周期サンプル区間
+const uint16_t inDataSize = 128 * ((maxPeriod * 2 + 127) / 128);  // 入力音配列 データ数 128の倍数にする
+const uint16_t bitStreamSize = inDataSize / 64;                   // ビットストリーム配列 データ数
+const uint16_t maxLag = inDataSize / 2;                           // 相関を計算する最大のズレ
+const float noiseThrethold = 0.02f;                               // ノイズ除去用閾値
+
+const uint16_t maxPeriodFine = tunerSamplingFreq / minFreqFine;                     // 最大周期サンプル区間 YIN/MPM
+const uint16_t inDataSizeFine = 128 * ((maxPeriodFine * 2 + 127) / 128);            // 入力音配列 データ数 YIN/MPM
+const uint16_t windowSizeFine = inDataSizeFine - maxPeriodFine - 1;                 // 差分関数の積算区間 YIN/MPM
+const float yinThreshold = 0.15f;                                                   // YIN 谷の判定閾値
+const float mpmThreshold = 0.93f;                                                   // MPM 山の判定閾値（最大値との比）
+const char* const methodName[TUNER_METHOD_COUNT] = { "BIT", "YIN", "MPM", "POLY" }; // 推定方法 表示名
+
+const uint32_t polyDecimation = 2;                                      // POLY 解析タスク内での追加の間引き率
+const float polySamplingFreq = tunerSamplingFreq / polyDecimation;      // POLY サンプリング周波数 5.5kHz
+const uint16_t polyFftSize = 2048;                                      // POLY FFTサイズ 約0.37秒
+const float polyBinFreq = polySamplingFreq / polyFftSize;               // POLY FFT 1ビンの周波数 約2.7Hz
+const uint16_t polyHopMin = polyFftSize / 8;                            // POLY 解析間隔 最小サンプル数 約46ms
+const float polyLoadTarget = 0.2f;                                      // POLY 解析に使うCPU時間の割合 目標値
+const float polyMaxFreq = 800.0f;                                       // POLY 倍音を調べる上限周波数
+const uint8_t polyHarmonics = 4;                                        // POLY 倍音和に使う倍音数（基音を含む）
+const float polySearchCent = 60.0f;                                     // POLY 各弦の探索範囲 ±セント
+const float polyPresence = 3.0f;                                        // POLY 弦が鳴っている判定 平均振幅との比
+const float polyMinPower = 1.0e-6f;                                     // POLY 無音判定 平均パワー
+const uint8_t polyHoldCount = 4;                                        // POLY 未検出時に表示を保持する解析回数
+const int8_t polyStringNote[6] = { -29, -24, -19, -14, -10, -5 };       // POLY 6弦～1弦 A音からの半音数
+const char* const polyStringName[6] = { "E", "A", "D", "G", "B", "E" }; // POLY 6弦～1弦 表示名
+
+// 音名 D～C# 13個目は該当なしの場合
+const char* const noteName[13] = { "D", "D", "E", "F", "F", "G", "G", "A", "A", "B", "C", "C", "" };
+const bool noteSharp[13] = { false, true, false, false, true, false, true, false, true, false, false, true, false };
+// 周波数のズレ 5段階 セント
+const float errorCent[5] = { 2.0f, 14.0f, 21.0f, 30.0f, 50.0f };
 
 // 各変数
-float inData[2][inDataSize] = {};          // 入力音の配列 2つ準備し交互に利用
-uint32_t bitStream[2][bitStreamSize] = {}; // ビットストリーム配列 2つ準備し交互に利用
-
-uint32_t corrArray[inDataSize / 2]; // correlation(相間) 配列
-uint32_t maxCorr = 0;               // correlation(相間) 最大値
-uint32_t minCorr = UINT32_MAX;      // correlation(相間) 最小値
+float freqA = 440.0f;                         // 基準A音周波数 Hz
+volatile TunerMethod tunerMethod = TUNER_BIT; // 周波数の推定方法
+float inData[inDataSizeFine] = {};            // 入力音の配列 1フレーム分 BITは先頭inDataSize個のみ使う
+float diffArray[maxPeriodFine + 2] = {};      // YIN: 累積平均正規化差分関数 MPM: NSDF
+uint64_t bitStream[bitStreamSize] = {};       // ビットストリーム配列
+
+uint32_t corrArray[maxLag];    // correlation(相間) 配列
+uint32_t maxCorr = 0;          // correlation(相間) 最大値
+uint32_t minCorr = UINT32_MAX; // correlation(相間) 最小値
+
+uint16_t estimatedIdx = minPeriod;     // 推定周期 サンプル数
+volatile float estimatedFreq = 999.0f; // 推定周波数 解析タスクで書込、画面表示で読出
+
+ringBuf<float, 256> tunerRing;          // 間引き済入力音 I2S割込み→解析タスク
+decimator<TUNER_DECIMATION> tunerDecim; // 入力音 間引き
+osThreadId tunerTaskHandle = NULL;      // 解析タスク
+volatile uint32_t tunerCycles = 0;      // 1フレームの解析にかかったCPUサイクル数
+
+decimator<polyDecimation> polyDecim;                            // POLY 追加の間引き 通過域は約900Hzまで
+fft<polyFftSize> polyFft;                                       // POLY FFT
+float polyHist[polyFftSize] = {};                               // POLY 入力音 循環バッファ 最新polyFftSize個
+uint16_t polyHistPos = 0;                                       // POLY 入力音 書込位置（最も古いデータの位置）
+float polyWork[polyFftSize] = {};                               // POLY 窓掛け後の入力音 FFT作業用
+float polySpec[polyFftSize / 2] = {};                           // POLY 振幅スペクトル
+volatile uint16_t polyHop = polyHopMin;                         // POLY 解析間隔 サンプル数 CPU負荷に応じて変更
+volatile float polyCent[6] = {};                                // POLY 各弦のズレ セント
+volatile uint8_t polyAge[6] = { 255, 255, 255, 255, 255, 255 }; // POLY 各弦 未検出の連続回数
+
+// 周波数確定 --------------------------------------------------------
+void confirmFreq(float freq) {
+    // 推定周波数が3回連続で近い値となった時に周波数確定
+    static float tmpFreq[3] = {}; // 推定周波数 一時保管用
+    static uint8_t n = 0;         // 上記tmpFreqの添字 0→1→2→0で循環させる
+    tmpFreq[n] = freq;
 
-uint16_t estimatedIdx = minPeriod; // 推定周期 サンプル数
-float estimatedFreq = 999.0f;      // 推定周波数
+    if (tmpFreq[n] * 0.97f < tmpFreq[(n + 1) % 3] && tmpFreq[(n + 1) % 3] < 1.03f * tmpFreq[n] &&
+        tmpFreq[n] * 0.97f < tmpFreq[(n + 2) % 3] && tmpFreq[(n + 2) % 3] < 1.03f * tmpFreq[n]) {
+        estimatedFreq = (tmpFreq[n] + tmpFreq[(n + 1) % 3] + tmpFreq[(n + 2) % 3]) / 3.0f;
+    }
+    n = (n + 1) % 3;
+}
 
-// 周波数算出 --------------------------------------------------------
+// 周波数算出 ビットストリーム -------------------------------------------------------
 void estimateFreq(float inData[]) {
     /*
      * <実際より低い音として判定される問題を解決＞
@@ -89,255 +162,513 @@ void estimateFreq(float inData[]) {
     float estimatedPeriod = (nextIdx - startIdx) + (dx2 - dx1); // 推定周期
     estimatedPeriod = estimatedPeriod / (float)estimatedDiv;    // 予め計算した除数で割る
 
-    // 推定周波数が3回連続で近い値となった時に周波数確定
-    static float tmpFreq[3] = {}; // 推定周波数 一時保管用
-    static uint8_t n = 0;         // 上記tmpFreqの添字 0→1→2→0で循環させる
     if (estimatedPeriod > (float)minPeriod)
-        tmpFreq[n] = tunerSamplingFreq / estimatedPeriod;
+        confirmFreq(tunerSamplingFreq / estimatedPeriod);
+}
 
-    if (tmpFreq[n] * 0.97f < tmpFreq[(n + 1) % 3] && tmpFreq[(n + 1) % 3] < 1.03f * tmpFreq[n] &&
-        tmpFreq[n] * 0.97f < tmpFreq[(n + 2) % 3] && tmpFreq[(n + 2) % 3] < 1.03f * tmpFreq[n]) {
-        estimatedFreq = (tmpFreq[n] + tmpFreq[(n + 1) % 3] + tmpFreq[(n + 2) % 3]) / 3.0f;
+// 放物線補間 ----------------------------------------------------------------------
+float parabolicPeak(float const y[], uint16_t i) {
+    // y[i-1], y[i], y[i+1] の3点を通る放物線の頂点のx座標を返す
+    float den = y[i - 1] - 2.0f * y[i] + y[i + 1];
+    if (den == 0.0f)
+        return (float)i;
+    return (float)i + 0.5f * (y[i - 1] - y[i + 1]) / den;
+}
+
+// 周波数算出 YIN -----------------------------------------------------------------
+void estimateFreqYin() {
+    // 差分関数 d(τ) = Σ(x[j] - x[j+τ])^2 を累積平均で正規化する
+    float runningSum = 0.0f;
+    diffArray[0] = 1.0f;
+    for (uint16_t tau = 1; tau <= maxPeriodFine + 1; tau++) {
+        float d = 0.0f;
+        for (uint16_t j = 0; j < windowSizeFine; j++) {
+            float delta = inData[j] - inData[j + tau];
+            d += delta * delta;
+        }
+        runningSum += d;
+        diffArray[tau] = (runningSum > 0.0f) ? d * (float)tau / runningSum : 1.0f;
     }
-    n = (n + 1) % 3;
+
+    // 閾値を下回った最初の谷を採用 下回らない場合は最小値
+    uint16_t tauEst = 0;
+    uint16_t tauMin = minPeriod;
+    for (uint16_t tau = minPeriod; tau <= maxPeriodFine; tau++) {
+        if (diffArray[tau] < diffArray[tauMin])
+            tauMin = tau;
+        if (diffArray[tau] < yinThreshold) {
+            while (tau + 1 <= maxPeriodFine && diffArray[tau + 1] < diffArray[tau])
+                tau++; // 谷の底まで進む
+            tauEst = tau;
+            break;
+        }
+    }
+    if (tauEst == 0) {
+        if (diffArray[tauMin] > 0.5f)
+            return; // 周期性なし
+        tauEst = tauMin;
+    }
+
+    confirmFreq(tunerSamplingFreq / parabolicPeak(diffArray, tauEst));
 }
 
-// 自己相関計算 ------------------------------------------------------------------
-void bitstreamAutocorrelation(uint16_t startCnt, uint32_t bitData[]) {
-    // pos：position ビットストリーム配列をズラした位置
-    // pos → minPeriod ～ inDataSize/2 まで相間を計算するが、計算負荷軽減のため分割する
-    for (uint16_t pos = startCnt; (pos >= minPeriod) && (pos < startCnt + fx::BLOCK_SIZE / 2); pos++) {
-        uint16_t midBitStreamSize = (bitStreamSize / 2) - 1; // ビットストリーム配列データ数の半分
-        uint16_t index = startCnt / 32;                      // ビットストリーム配列の何番目の整数か
-        uint16_t shift = startCnt % 32;                      // ビットストリーム配列内の整数 シフト数
-        uint32_t corr = 0;                                   // correlation(相間)
-
-        if (shift == 0) {
-            for (uint16_t i = 0; i < midBitStreamSize; i++) { // ^(XOR)、ビットが1になっている所を数え相間を算出
-                corr += __builtin_popcount(bitData[i] ^ bitData[i + index]);
-            }
+// 周波数算出 MPM -----------------------------------------------------------------
+void estimateFreqMpm() {
+    // NSDF n(τ) = 2Σx[j]x[j+τ] / Σ(x[j]^2 + x[j+τ]^2)
+    float m1 = 0.0f; // Σx[j]^2
+    float m2 = 0.0f; // Σx[j+τ]^2 τを増やしながら差分で更新
+    for (uint16_t j = 0; j < windowSizeFine; j++) {
+        m1 += inData[j] * inData[j];
+    }
+    m2 = m1;
+    for (uint16_t tau = 0; tau <= maxPeriodFine + 1; tau++) {
+        if (tau > 0)
+            m2 += inData[tau + windowSizeFine - 1] * inData[tau + windowSizeFine - 1] -
+                  inData[tau - 1] * inData[tau - 1];
+        float r = 0.0f;
+        for (uint16_t j = 0; j < windowSizeFine; j++) {
+            r += inData[j] * inData[j + tau];
+        }
+        diffArray[tau] = (m1 + m2 > 0.0f) ? 2.0f * r / (m1 + m2) : 0.0f;
+    }
+
+    // 正の区間ごとの最大値(キー最大値)を探し、全体最大値×閾値を超える最初のものを採用
+    uint16_t keyMax[16] = {}; // キー最大値の位置
+    uint8_t keyCount = 0;
+    float overallMax = 0.0f;
+    uint16_t tau = 1;
+    while (tau <= maxPeriodFine && diffArray[tau] > 0.0f)
+        tau++; // τ=0の山を飛ばす
+    for (; tau <= maxPeriodFine && keyCount < 16; tau++) {
+        if (diffArray[tau - 1] <= 0.0f && diffArray[tau] > 0.0f) {
+            keyMax[keyCount] = tau; // 正の区間開始
+            keyCount++;
+        }
+        if (keyCount > 0 && diffArray[tau] > 0.0f && diffArray[tau] > diffArray[keyMax[keyCount - 1]]) {
+            keyMax[keyCount - 1] = tau;
+        }
+    }
+    for (uint8_t i = 0; i < keyCount; i++) {
+        overallMax = std::max(overallMax, diffArray[keyMax[i]]);
+    }
+    if (overallMax < 0.5f)
+        return; // 周期性なし
+
+    for (uint8_t i = 0; i < keyCount; i++) {
+        if (keyMax[i] >= minPeriod && diffArray[keyMax[i]] >= mpmThreshold * overallMax) {
+            confirmFreq(tunerSamplingFreq / parabolicPeak(diffArray, keyMax[i]));
+            break;
+        }
+    }
+}
+
+// POLY 指定周波数の振幅 隣接ビンを線形補間 -----------------------------------------
+float polySpecAt(float freq) {
+    const float bin = freq / polyBinFreq;
+    const uint16_t i = (uint16_t)bin;
+    if (i + 1 >= polyFftSize / 2)
+        return 0.0f;
+    return polySpec[i] + (bin - (float)i) * (polySpec[i + 1] - polySpec[i]);
+}
+
+// POLY 指定周波数付近のピーク 対数振幅の放物線補間 --------------------------------------
+float polyPeakFreq(float freq, float& mag) {
+    uint16_t i = (uint16_t)(freq / polyBinFreq + 0.5f);
+    mag = 0.0f;
+    if (i < 2 || i + 2 >= polyFftSize / 2)
+        return freq;
+    if (polySpec[i - 1] > polySpec[i] && polySpec[i - 1] > polySpec[i + 1])
+        i--; // 隣のビンがピーク
+    else if (polySpec[i + 1] > polySpec[i])
+        i++;
+    if (polySpec[i - 1] > polySpec[i] || polySpec[i + 1] > polySpec[i])
+        return freq; // ±1ビン以内にピークなし
+
+    // ハン窓のメインローブは対数振幅で放物線に近い形となる
+    const float y[3] = { logf(polySpec[i - 1] + 1.0e-12f), logf(polySpec[i] + 1.0e-12f),
+        logf(polySpec[i + 1] + 1.0e-12f) };
+    mag = polySpec[i];
+    return ((float)i - 1.0f + parabolicPeak(y, 1)) * polyBinFreq;
+}
+
+// POLY 第h倍音が他の弦の倍音と重なるか ---------------------------------------------------
+bool polyShared(float const (&nominals)[6], uint8_t k, uint8_t h) {
+    for (uint8_t j = 0; j < 6; j++) {
+        if (j == k)
+            continue;
+        for (uint8_t m = 1; m <= polyHarmonics; m++) {
+            if (fabsf(h * nominals[k] - m * nominals[j]) < 3.0f * polyBinFreq)
+                return true; // ハン窓のメインローブ(±2ビン)が重なる
         }
-        else {
-            for (uint16_t i = 0; i < midBitStreamSize; i++) {
-                uint32_t tmp = bitData[i + index] >> shift; // ビットストリーム配列をズラしたもの
-                tmp |= bitData[i + 1 + index] << (32 - shift); // 右シフトしたものと左シフトしたものを合わせる
-                corr += __builtin_popcount(bitData[i] ^ tmp);
+    }
+    return false;
+}
+
+// 周波数算出 POLY 開放弦6本 ------------------------------------------------------------
+void estimateFreqPoly() {
+    // ハン窓 cosは回転の漸化式で求める
+    const float dc = cosf(2.0f * PI / (float)polyFftSize);
+    const float ds = sinf(2.0f * PI / (float)polyFftSize);
+    float c = 1.0f;
+    float s = 0.0f;
+    float power = 0.0f;
+    for (uint16_t n = 0; n < polyFftSize; n++) {
+        const float x = polyHist[(polyHistPos + n) % polyFftSize]; // 古い順
+        power += x * x;
+        polyWork[n] = x * (0.5f - 0.5f * c);
+        const float tmp = c * dc - s * ds;
+        s = s * dc + c * ds;
+        c = tmp;
+    }
+    if (power < polyMinPower * (float)polyFftSize) {
+        for (uint8_t k = 0; k < 6; k++)
+            polyAge[k] = std::min(polyAge[k] + 1, 255);
+        return; // 無音
+    }
+
+    polyFft.powerSpectrum(polyWork, polySpec);
+    const uint16_t lowBin = 60.0f / polyBinFreq;        // 平均振幅を求める範囲 下限
+    const uint16_t highBin = polyMaxFreq / polyBinFreq; // 平均振幅を求める範囲 上限
+    float noise = 0.0f;                                 // 平均振幅 弦が鳴っているかの判定基準
+    for (uint16_t k = 0; k < polyFftSize / 2; k++) {
+        polySpec[k] = sqrtf(polySpec[k]);
+        if (lowBin <= k && k < highBin)
+            noise += polySpec[k];
+    }
+    noise /= (float)(highBin - lowBin);
+
+    float nominals[6]; // 開放弦の基準周波数
+    for (uint8_t k = 0; k < 6; k++)
+        nominals[k] = freqA * exp2f((float)polyStringNote[k] / 12.0f);
+
+    const float stepRatio = exp2f(2.0f / 1200.0f); // 探索間隔 2セント
+    for (uint8_t k = 0; k < 6; k++) {
+        // 倍音和（第h倍音の振幅を1/hで重み付け）が最大となる周波数を探索範囲内で探す
+        const float nominal = nominals[k];
+        float freq = nominal * exp2f(-polySearchCent / 1200.0f);
+        float bestFreq = nominal;
+        float bestScore = 0.0f;
+        for (int16_t cent = -(int16_t)polySearchCent; cent <= (int16_t)polySearchCent; cent += 2) {
+            float score = 0.0f;
+            for (uint8_t h = 1; h <= polyHarmonics && h * freq < polyMaxFreq; h++)
+                score += polySpecAt(h * freq) / (float)h;
+            if (score > bestScore) {
+                bestScore = score;
+                bestFreq = freq;
             }
+            freq *= stepRatio;
         }
 
-        shift++;
-        if (shift == 32) // shiftが32まで来たらindexを増やす
-        {
-            shift = 0;
-            index++;
+        // 鳴っているかの判定は他の弦と重ならない倍音のみで行う（他の弦の倍音による誤検出防止）
+        float cleanScore = 0.0f;
+        float weightSum = 0.0f;
+        for (uint8_t h = 1; h <= polyHarmonics && h * bestFreq < polyMaxFreq; h++) {
+            if (polyShared(nominals, k, h))
+                continue;
+            cleanScore += polySpecAt(h * bestFreq) / (float)h;
+            weightSum += 1.0f / (float)h;
+        }
+        if (weightSum == 0.0f || cleanScore < polyPresence * noise * weightSum) {
+            polyAge[k] = std::min(polyAge[k] + 1, 255);
+            continue; // この弦は鳴っていない
         }
 
-        corrArray[pos] = corr;             // correlation(相間) 配列
-        maxCorr = std::max(maxCorr, corr); // 最大値を記録
-        if (corr < minCorr) {
-            minCorr = corr;     // 最小値を記録
-            estimatedIdx = pos; // 相間が最小となる時の位置→周期計算に利用
+        // 各倍音のピーク周波数を補間し、振幅で重み付け平均して基音周波数とする
+        // 他の弦の倍音と重なる倍音（例: 6弦の第3倍音と2弦の基音）はズレの原因となるため除く
+        // 重ならない倍音が見つからない場合は全ての倍音を使う
+        float sum = 0.0f;
+        float magSum = 0.0f;
+        for (uint8_t pass = 0; pass < 2 && magSum == 0.0f; pass++) {
+            for (uint8_t h = 1; h <= polyHarmonics && h * bestFreq < polyMaxFreq; h++) {
+                if (pass == 0 && polyShared(nominals, k, h))
+                    continue;
+                float mag;
+                const float peak = polyPeakFreq(h * bestFreq, mag) / (float)h;
+                sum += mag * peak;
+                magSum += mag;
+            }
         }
+        const float cent = (magSum > 0.0f) ? 1200.0f * log2f(sum / magSum / nominal) : 999.0f;
+        if (fabsf(cent) > 50.0f) {
+            polyAge[k] = std::min(polyAge[k] + 1, 255);
+            continue; // 隣の半音に近い
+        }
+        polyCent[k] = cent;
+        polyAge[k] = 0;
     }
 }
 
-// 入力音配列をビットストリームへ変換 --------------------------------------------
-void bitStreamSet(uint16_t cnt, float x, float inData[], uint32_t bitData[]) {
-    uint32_t val = 0;  // 入力音がゼロ以上か判定 0または1
-    uint32_t mask = 0; // マスクビット
-
-    // 入力音配列にデータを保存
-    inData[cnt] = x;
-
-    // 入力音配列をビットストリーム配列へ変換
-    if (inData[cnt] < -noiseThrethold)
-        val = 0;
-    else if (inData[cnt] > 0.0f)
-        val = 1;
-    mask = 1 << (cnt % 32);
-    bitData[cnt / 32] ^= (-val ^ bitData[cnt / 32]) & mask; // -val は 111...111 または 000...000（解説省略）
+// 自己相関計算 ------------------------------------------------------------------
+void bitstreamAutocorrelation() {
+    // 1フレーム分の全てのズレ(lag) 0 ～ maxLag-1 について相関を一度に計算する
+    // lag = index * 64 + shift とし、同じshiftのlagをまとめて計算することで
+    // ビットストリームのシフトはshiftごとに1回のみとする
+    const uint16_t midBitStreamSize = bitStreamSize / 2; // ビットストリーム配列データ数の半分
+
+    maxCorr = 0;
+    minCorr = UINT32_MAX;
+
+    for (uint16_t shift = 0; shift < 64; shift++) {
+        uint64_t shifted[bitStreamSize]; // shiftビットずらしたビットストリーム
+        for (uint16_t j = 0; j < bitStreamSize - 1; j++) {
+            shifted[j] = shift ? (bitStream[j] >> shift) | (bitStream[j + 1] << (64 - shift)) : bitStream[j];
+        }
+        shifted[bitStreamSize - 1] = bitStream[bitStreamSize - 1] >> shift;
+
+        for (uint16_t index = 0; index < midBitStreamSize; index++) {
+            uint16_t lag = index * 64 + shift;
+            uint32_t corr = 0; // correlation(相間)
+            for (uint16_t i = 0; i < midBitStreamSize; i++) { // ^(XOR)、ビットが1になっている所を数え相間を算出
+                corr += __builtin_popcountll(bitStream[i] ^ shifted[i + index]);
+            }
+
+            corrArray[lag] = corr;             // correlation(相間) 配列
+            maxCorr = std::max(maxCorr, corr); // 最大値を記録
+            if (lag >= minPeriod && corr < minCorr) {
+                minCorr = corr;     // 最小値を記録
+                estimatedIdx = lag; // 相間が最小となる時の位置→周期計算に利用
+            }
+        }
+    }
 }
 
-// 信号処理 ----------------------------------------------------------------------
-void tunerProcess(float (&xL)[fx::BLOCK_SIZE], float (&xR)[fx::BLOCK_SIZE]) {
-    float fxL[fx::BLOCK_SIZE] = {}; // 入力フィルタ後の配列
-    static lpf2nd lpf(maxFreq);     // 入力2次LPF
-    static uint16_t inDataCnt = 0;  // 入力音配列の添字カウント
-    static bool arraySel = false;   // 2つの配列 入れ替え用
-
-    // 配列準備と自己相間の計算が終了したデータを使い周波数を算出、変数初期化 //////////
-    if (inDataCnt == 0) {
-        estimateFreq(inData[arraySel]);
-
-        maxCorr = 0;
-        minCorr = UINT32_MAX;
-        for (uint16_t i = 0; i < inDataSize / 2; i++)
-            corrArray[i] = 0;
+// 入力音配列をビットストリームへ変換 --------------------------------------------
+void bitStreamSet() {
+    uint64_t val = 0; // 入力音がゼロ以上か判定 0または1 閾値の間は直前の値を維持する
+    for (uint16_t i = 0; i < bitStreamSize; i++) {
+        uint64_t bits = 0;
+        for (uint16_t j = 0; j < 64; j++) {
+            float x = inData[i * 64 + j];
+            if (x < -noiseThrethold)
+                val = 0;
+            else if (x > 0.0f)
+                val = 1;
+            bits |= val << j;
+        }
+        bitStream[i] = bits;
     }
+}
 
-    // 自己相関計算 ////////////////////////////////////////////////////////////////
-    bitstreamAutocorrelation(inDataCnt / 2, bitStream[!arraySel]);
+// 解析タスク --------------------------------------------------------------------
+void tunerTask(void const* argument) {
+    static lpf2nd lpf(maxFreq * TUNER_DECIMATION); // 入力2次LPF 係数はSAMPLING_FREQ基準のため間引き率を掛ける
+    uint16_t inDataCnt = 0;                        // 入力音配列の添字カウント
+    TunerMethod method = tunerMethod;              // 解析中フレームの推定方法
+
+    for (;;) {
+        osSignalWait(1, osWaitForever); // I2S割込みからの通知を待つ
+
+        float x;
+        while (tunerRing.pop(x)) {
+            if (inDataCnt == 0)
+                method = tunerMethod; // 推定方法の変更はフレームの先頭で反映
+
+            if (method == TUNER_POLY) {
+                // 倍音も使うためLPFは通さず、さらに1/2に間引いて循環バッファへ
+                float y;
+                if (!polyDecim.process(x, y))
+                    continue;
+                polyHist[polyHistPos] = y;
+                polyHistPos = (polyHistPos + 1) % polyFftSize;
+                inDataCnt++;
+                if (inDataCnt < polyHop)
+                    continue;
+
+                // 解析間隔ごとに最新polyFftSize個を解析 //////////////////////////////////
+                inDataCnt = 0;
+                const uint32_t start = DWT->CYCCNT;
+                estimateFreqPoly();
+                const uint32_t cycles = DWT->CYCCNT - start;
+                tunerCycles = cycles;
+
+                // 解析時間（割込みで中断された時間を含む）が解析間隔のpolyLoadTarget以下になるよう
+                // 解析間隔を調整する エフェクトの処理が重い場合は自動的に解析回数が減る
+                const float hop = (float)cycles / SystemCoreClock / polyLoadTarget * polySamplingFreq;
+                polyHop = clip(hop, (float)polyHopMin, (float)polyFftSize);
+                continue;
+            }
 
-    // 入力音配列とビットストリーム配列を準備 //////////////////////////////////////
-    for (uint32_t i = 0; i < fx::BLOCK_SIZE; i++) {
-        fxL[i] = lpf.process(xL[i]);
+            inData[inDataCnt] = lpf.process(x);
+            inDataCnt++;
+            if (inDataCnt < (method == TUNER_BIT ? inDataSize : inDataSizeFine))
+                continue;
 
-        bitStreamSet(inDataCnt, fxL[i], inData[arraySel], bitStream[arraySel]);
-        inDataCnt++;
-        if (inDataCnt == inDataSize) // 配列 準備完了
-        {
+            // 1フレーム分たまったら解析 ////////////////////////////////////////////
             inDataCnt = 0;
-            arraySel = !arraySel;
+            const uint32_t start = DWT->CYCCNT;
+            switch (method) {
+            case TUNER_BIT:
+                bitStreamSet();
+                bitstreamAutocorrelation();
+                estimateFreq(inData);
+                break;
+            case TUNER_YIN:
+                estimateFreqYin();
+                break;
+            case TUNER_MPM:
+                estimateFreqMpm();
+                break;
+            default:
+                break;
+            }
+            tunerCycles = DWT->CYCCNT - start;
         }
+    }
+}
+
+// 初期化 ------------------------------------------------------------------------
+void tunerInit() {
+    // 解析は1回に1ms以上かかる場合がある（YIN・POLY）ため、画面表示(通常)・スイッチ読取(通常未満)より低くし、
+    // 操作・表示の応答を優先する 画面表示・スイッチ読取は毎回待つため、その間に解析できる
+    // 解析の遅れはリングバッファ（256サンプル 約23ms）で吸収する あふれた場合は途切れたフレームの推定が外れるが、
+    // 3回連続で近い値となるまで確定しないため表示には出ない
+    osThreadDef(tunerTask, tunerTask, osPriorityLow, 0, 256);
+    tunerTaskHandle = osThreadCreate(osThread(tunerTask), NULL);
+}
 
-        xL[i] = muteOff * xL[i]; // 出力ミュート
+// 推定方法切替 --------------------------------------------------------------------
+void tunerChangeMethod(int shiftCount) {
+    tunerMethod = (TunerMethod)((TUNER_METHOD_COUNT + tunerMethod + shiftCount) % TUNER_METHOD_COUNT);
+}
+
+// 基準A音周波数変更 ----------------------------------------------------------------
+void tunerChangeFreqA(int shiftCount) { freqA = clip(freqA + (float)shiftCount, 430.0f, 450.0f); }
+
+// 入力音受け渡し I2S割込みから呼ぶ -------------------------------------------------
+void tunerInput(float const (&xL)[fx::BLOCK_SIZE]) {
+    for (uint32_t i = 0; i < fx::BLOCK_SIZE; i++) {
+        float y;
+        if (tunerDecim.process(xL[i], y))
+            tunerRing.push(y); // 満杯の場合は捨てる
     }
+    if (tunerTaskHandle && tunerRing.size() >= fx::BLOCK_SIZE)
+        osSignalSet(tunerTaskHandle, 1); // 解析タスクへ通知
 }
 
-// 画面表示 ----------------------------------------------------------------------
-void tunerDisp() {
+// 画面表示 POLY 6弦～1弦のズレを縦のバーで表示 -------------------------------------
+void tunerDispPoly() {
+    const float pixelPerCent = 18.0f / 50.0f; // バーの長さ ±50セントで18ピクセル
+    const uint8_t centerY = 32;               // バーの中心 y座標
 
-    const float cent1 = powf(2.0f, 1.0f / 1200.0f); // 1セント(半音の100分の1)
-    const float st = powf(2.0f, 1.0f / 12.0f);      // semitone(半音)
+    for (uint8_t k = 0; k < 6; k++) {
+        const uint8_t x = 2 + k * 21; // 1弦分の表示の左端 x座標
 
-    // 周波数のズレ 5段階
-    const float freqError[5] = { powf(cent1, 2), powf(cent1, 14), powf(cent1, 21), powf(cent1, 30), powf(cent1, 50) };
+        // 中心線
+        ssd1306_DrawHLine(x + 1, centerY, 15, White);
 
-    // D～C#の基準周波数 13個目は該当なしの場合
-    const float noteFreq[13] = { freqA / powf(st, 43), freqA / powf(st, 42), freqA / powf(st, 41), freqA / powf(st, 40),
-        freqA / powf(st, 39), freqA / powf(st, 38), freqA / powf(st, 37), freqA / powf(st, 36), freqA / powf(st, 35),
-        freqA / powf(st, 34), freqA / powf(st, 33), freqA / powf(st, 32), 9999 };
+        // 弦名 未検出の場合は反転しない
+        ssd1306_xyWriteStrWT(x + 5, 52, polyStringName[k], Font_7x10);
+        if (polyAge[k] >= polyHoldCount)
+            continue;
+        ssd1306_InvertRect(x + 4, 51, 9, 11);
 
-    // 計算済周波数を一時保存(表示用計算の途中で値が変更されるのを防ぐ)
-    float dispFreq = estimatedFreq; // 表示用周波数
-
-    // 周波数表示
-    if (estimatedFreq < 1000.0f && estimatedFreq > 10.0f) {
-        std::string freqStr = std::to_string((uint16_t)(100.0f * estimatedFreq)); // 周波数文字列
-        if (estimatedFreq < 100.0f)
-            freqStr.insert(2, "."); // 小数点を挿入
-        else
-            freqStr.insert(3, ".");
-        ssd1306_R_xyWriteStrWT(121, 0, (freqStr + "Hz").c_str(), Font_7x10);
-    }
+        const float cent = polyCent[k];
+        if (fabsf(cent) < errorCent[0]) {
+            // 合っている場合は中心に四角形
+            ssd1306_FillRect(x + 2, centerY - 3, 13, 7, White);
+            continue;
+        }
 
+        // 高い場合は上、低い場合は下へバーを伸ばす
+        const uint8_t len = 1 + (uint8_t)std::min(fabsf(cent) * pixelPerCent, 17.0f);
+        ssd1306_FillRect(x + 4, (cent > 0.0f) ? centerY - len : centerY, 9, len + 1, White);
+    }
 
-    // 検出周波数の音名、ズレを判別 //////////////////////////////////////////////
+    ssd1306_xyWriteStrWT(0, 0, "TUNER", Font_7x10); // 左上の表示
+    ssd1306_xyWriteStrWT(42, 0, methodName[TUNER_POLY], Font_7x10); // 推定方法
+    char str[8];
+    ssd1306_R_xyWriteStrWT(121, 0, strFormat(str).ch('A').dec((int32_t)freqA).c_str(), Font_7x10); // 基準A音周波数
+}
 
-    uint8_t noteNum = 12;                             // 音名番号 0～11(D～C#) 該当なしの場合は12
-    int8_t errorNum = 5;                              // ズレがどのくらいか -4～4 該当なしの場合は5
-    const float pow2[4] = { 1.0f, 2.0f, 4.0f, 8.0f }; // 2の0乗～3乗
-    float freqOct = 1.0f;                             // オクターブ計算済の基準周波数
+// 画面表示 ----------------------------------------------------------------------
+void tunerDisp() {
+    if (tunerMethod == TUNER_POLY) {
+        tunerDispPoly();
+        return;
+    }
 
-    // 音名を判定
-    for (uint8_t octNum = 0; octNum <= 3; octNum++) // 3オクターブ上まで判定
-    {
-        for (uint8_t i = 0; i < 12; i++) // 12音のどれか判定
+    // 計算済周波数を一時保存(表示用計算の途中で値が変更されるのを防ぐ)
+    const float dispFreq = estimatedFreq; // 表示用周波数
+
+    uint8_t noteNum = 12; // 音名番号 0～11(D～C#) 該当なしの場合は12
+    int8_t errorNum = 5;  // ズレがどのくらいか -4～4 該当なしの場合は5
+
+    if (dispFreq < 1000.0f && dispFreq > 10.0f) {
+        // 周波数表示 小数点以下2桁
+        const uint32_t freq100 = (uint32_t)(100.0f * dispFreq + 0.5f);
+        char str[12];
+        ssd1306_R_xyWriteStrWT(121, 0, strFormat(str).fixed((int32_t)freq100, 2).str("Hz").c_str(), Font_7x10);
+
+        // 検出周波数の音名、ズレを判別 //////////////////////////////////////////
+        // 基準A音からの半音数を求め、最も近い音とのズレをセントで計算する
+        const float semitone = 12.0f * log2f(dispFreq / freqA);
+        const int32_t nearest = (int32_t)floorf(semitone + 0.5f);
+        const float cent = 100.0f * (semitone - (float)nearest);
+        noteNum = (uint8_t)(((nearest + 7) % 12 + 12) % 12); // A音は7番(D音から7半音上)
+
+        const float absCent = fabsf(cent);
+        for (int8_t k = 0; k <= 4; k++) // 基準周波数からのズレを判定
         {
-            freqOct = noteFreq[i] * pow2[octNum];
-            for (int8_t k = 0; k <= 4; k++) // 基準周波数からのズレを判定
-            {
-                if ((freqOct / freqError[k] < dispFreq) && (dispFreq < freqOct * freqError[k])) {
-                    errorNum = k; // ズレを記録
-                    if (dispFreq < freqOct)
-                        errorNum = -k; // マイナス側にズレていた場合 負の値にする
-                    noteNum = i;       // 判定された音名番号を記録
-                    break;
-                }
+            if (absCent < errorCent[k]) {
+                errorNum = (cent < 0.0f) ? -k : k; // マイナス側にズレていた場合 負の値にする
+                break;
             }
-            if (errorNum != 5)
-                break; // ズレ判定済の場合、ループを抜ける
         }
-        if (noteNum != 12)
-            break; // 音名判定済の場合、ループを抜ける
     }
 
-
     // 四角枠 描画 ///////////////////////////////////////////////////////////////
 
-    uint8_t x = 58; // x座標
-    uint8_t y = 12; // y座標
-
     // 中央の四角枠
-    for (uint8_t i = 0; i < 12; i++) {
-        ssd1306_DrawPixel(x + i, y, White);
-        ssd1306_DrawPixel(x + i, y + 26, White);
-    }
-    for (uint8_t j = 0; j < 27; j++) {
-        ssd1306_DrawPixel(x, y + j, White);
-        ssd1306_DrawPixel(x + 11, y + j, White);
-    }
+    ssd1306_DrawRect(58, 12, 12, 27, White);
 
     // 左側の四角枠×4 右側の四角枠×4
     for (uint8_t m = 2; m < 76; m += 73) {
-        for (uint8_t k = 0; k < 4; k++) {
-            x = m + k * 14;
-            y = 16;
-            for (uint8_t i = 0; i < 9; i++) {
-                ssd1306_DrawPixel(x + i, y, White);
-                ssd1306_DrawPixel(x + i, y + 18, White);
-            }
-            for (uint8_t j = 0; j < 19; j++) {
-                ssd1306_DrawPixel(x, y + j, White);
-                ssd1306_DrawPixel(x + 8, y + j, White);
-            }
-        }
+        for (uint8_t k = 0; k < 4; k++)
+            ssd1306_DrawRect(m + k * 14, 16, 9, 19, White);
     }
 
-
     // 四角形・三角形・音名 描画 /////////////////////////////////////////////////////////
 
     // 中央の四角形描画
     if (errorNum == 0) {
-        x = 58;
-        y = 12;
-        for (uint8_t i = 0; i < 12; i++) {
-            for (uint8_t j = 0; j < 27; j++)
-                ssd1306_DrawPixel(x + i, y + j, White);
-        }
+        ssd1306_FillRect(58, 12, 12, 27, White);
     }
 
     // 左側の四角形・三角形描画
     if (-5 < errorNum && errorNum <= 0) {
-        x = 15 + (3 + errorNum) * 14;
-        y = 16;
-        for (uint8_t i = 0; i < 9; i++) {
-            if (errorNum != 0)
-                for (uint8_t j = 0; j < 19; j++)
-                    ssd1306_DrawPixel(x + i, y + j, White);
-        }
+        if (errorNum != 0)
+            ssd1306_FillRect(15 + (3 + errorNum) * 14, 16, 9, 19, White);
 
-        for (uint8_t i = 0; i < 9; i++) {
-            for (int8_t j = i; j < 17 - i; j++)
-                ssd1306_DrawPixel(32 + i, 43 + j, White);
-        }
+        for (uint8_t i = 0; i < 9; i++)
+            ssd1306_DrawVLine(32 + i, 43 + i, 17 - 2 * i, White);
     }
 
     // 右側の四角形・三角形描画
     if (0 <= errorNum && errorNum < 5) {
-        x = 62 + errorNum * 14;
-        y = 16;
-        for (uint8_t i = 0; i < 9; i++) {
-            if (errorNum != 0)
-                for (uint8_t j = 0; j < 19; j++)
-                    ssd1306_DrawPixel(x + i, y + j, White);
-        }
+        if (errorNum != 0)
+            ssd1306_FillRect(62 + errorNum * 14, 16, 9, 19, White);
 
-        for (uint8_t i = 0; i < 9; i++) {
-            for (int8_t j = i; j < 17 - i; j++)
-                ssd1306_DrawPixel(95 - i, 43 + j, White);
-        }
+        for (uint8_t i = 0; i < 9; i++)
+            ssd1306_DrawVLine(95 - i, 43 + i, 17 - 2 * i, White);
     }
 
     // 音名を描画
-    constexpr char const* note[13] = { "D", "D", "E", "F", "F", "G", "G", "A", "A", "B", "C", "C", "" };
-    ssd1306_xyWriteStrWT(55, 40, note[noteNum], Font_16x26);
+    ssd1306_xyWriteStrWT(55, 40, noteName[noteNum], Font_16x26);
 
     // シャープを描画
-    if (noteNum == 1 || noteNum == 4 || noteNum == 6 || noteNum == 8 || noteNum == 11) {
+    if (noteSharp[noteNum]) {
         ssd1306_xyWriteStrWT(72, 40, "#", Font_11x18);
     }
 
     ssd1306_xyWriteStrWT(0, 0, "TUNER", Font_7x10); // 左上の表示
-    osDelay(100);
+    ssd1306_xyWriteStrWT(42, 0, methodName[tunerMethod], Font_7x10); // 推定方法
+
+    // 基準A音周波数、解析の処理負荷（1フレームの時間に対する解析時間の割合 0.1%単位）
+    {
+        const float frameSec = (tunerMethod == TUNER_BIT ? inDataSize : inDataSizeFine) / tunerSamplingFreq;
+        const uint32_t load = 1000.0f * tunerCycles / SystemCoreClock / frameSec;
+        char str[8];
+        ssd1306_xyWriteStrWT(0, 43, strFormat(str).fixed((int32_t)load, 1).ch('%').c_str(), Font_7x10);
+        ssd1306_xyWriteStrWT(0, 54, strFormat(str).ch('A').dec((int32_t)freqA).c_str(), Font_7x10);
+    }
 }
@@ -3,6 +3,31 @@
 #include "common.h"
 #include "fx_base.h"
 
+/// 周波数の推定方法
+enum TunerMethod {
+    TUNER_BIT,          ///< ビットストリーム自己相関 軽量
+    TUNER_YIN,          ///< YIN 高精度
+    TUNER_MPM,          ///< McLeod Pitch Method 高精度
+    TUNER_POLY,         ///< FFT 開放弦6本を一括表示
+    TUNER_METHOD_COUNT, ///< 推定方法の総数
+};
+
+/// @brief 初期化 解析タスク生成
+void tunerInit();
+
+/// @brief 周波数の推定方法切替
+/// @param shiftCount 切替方向
+void tunerChangeMethod(int shiftCount);
+
+/// @brief 基準A音周波数変更 430 ～ 450Hz
+/// @param shiftCount 変更量 Hz
+void tunerChangeFreqA(int shiftCount);
+
+/// @brief 画面表示
+/// メインループから画面更新間隔ごとに呼ぶ 描画のみ行い、待たずに戻る
 void tunerDisp();
 
-void tunerProcess(float (&xL)[fx::BLOCK_SIZE], float (&xR)[fx::BLOCK_SIZE]);
+/// @brief 入力音受け渡し I2S受信割込み（ハーフ/フル）から呼ぶ
+/// 間引きのみ行い、周波数解析は解析タスクで行う
+/// @param[in] xL L音声信号
+void tunerInput(float const (&xL)[fx::BLOCK_SIZE]);
@@ -0,0 +1,42 @@
+#pragma once
+
+/* CMSIS-RTOS ホスト（PC）でのテスト用 -------------------------------------------*/
+// テスト対象のソースをそのままビルドするための最小限の定義 タスクは生成しない
+
+#include <stdint.h>
+
+typedef void* osThreadId;
+typedef enum {
+    osPriorityIdle = -3,
+    osPriorityLow = -2,
+    osPriorityBelowNormal = -1,
+    osPriorityNormal = 0,
+    osPriorityAboveNormal = +1,
+    osPriorityHigh = +2,
+    osPriorityRealtime = +3,
+} osPriority;
+typedef void (*os_pthread)(void const* argument);
+typedef struct {
+    char const* name;
+    os_pthread pthread;
+    osPriority tpriority;
+    uint32_t instances;
+    uint32_t stacksize;
+} osThreadDef_t;
+typedef struct {
+    int32_t status;
+    union {
+        uint32_t v;
+        int32_t signals;
+    } value;
+} osEvent;
+
+#define osWaitForever 0xFFFFFFFF
+#define osThreadDef(name, thread, priority, instances, stacksz) \
+    const osThreadDef_t os_thread_def_##name = { #name, (thread), (priority), (instances), (stacksz) }
+#define osThread(name) &os_thread_def_##name
+
+inline osThreadId osThreadCreate(osThreadDef_t const*, void*) { return nullptr; }
+inline int32_t osSignalSet(osThreadId, int32_t) { return 0; }
+inline osEvent osSignalWait(int32_t, uint32_t) { return osEvent(); }
+inline int32_t osDelay(uint32_t) { return 0; }
@@ -0,0 +1,14 @@
+#pragma once
+
+/* main.h ホスト（PC）でのテスト用 ---------------------------------------------*/
+// CPUサイクル数の計測（DWT）はホストでは常に0とする 処理時間はテスト側で計る
+
+#include <stdint.h>
+
+struct DWT_Stub {
+    uint32_t CYCCNT;
+};
+static DWT_Stub s_dwtStub = {};
+#define DWT (&s_dwtStub)
+
+static const uint32_t SystemCoreClock = 216000000;
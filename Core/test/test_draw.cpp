@@ -0,0 +1,248 @@
+// SSD1306 描画 文字・四角形のページ単位の描画
+// 同じ描画を1ピクセルずつの描画（ssd1306_DrawPixel・ssd1306_InvertPixel による従来の方法）でも行い、結果を比べる
+// ・全フォント・全文字を、白黒・ページ内の縦位置（0～7）・画面端ではみ出す位置で描画
+// ・乱数で文字列・塗りつぶし・反転・線・枠を重ねて描画 色反転（ssd1306_InvertColors）も含む
+// ・背景を送った後に描画して画面更新し、ホスト用の画面（SSD1306_HOST）が描画バッファと一致すること
+//   描画範囲の記録に漏れがあると、変化した部分が送られず一致しない
+// ・エフェクト画面相当の1画面の描画時間（ホスト）を両方の方法で表示する 判定はしない
+
+#include "ssd1306.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+const uint32_t BUFFER_SIZE = SSD1306_WIDTH * SSD1306_HEIGHT / 8;
+FontDef const* const FONTS[] = { &Font_7x10, &Font_11x18, &Font_16x26 };
+
+// 1ピクセルずつの描画 ページ単位の描画を入れる前の ssd1306_WriteChar と同じ
+// 座標は ssd1306_DrawPixel の引数（uint8_t）に切り詰める
+struct perPixel {
+    uint16_t x = 0, y = 0; // カーソル位置
+
+    void writeString(char const* str, FontDef const& font, SSD1306_COLOR color) {
+        for (; *str; str++) {
+            for (uint32_t i = 0; i < font.FontHeight; i++) {
+                const uint32_t b = font.data[(*str - 32) * font.FontHeight + i];
+                for (uint32_t j = 0; j < font.FontWidth; j++) {
+                    const SSD1306_COLOR c = ((b << j) & 0x8000) ? color : (SSD1306_COLOR)!color;
+                    ssd1306_DrawPixel(x + j, y + i, c);
+                }
+            }
+            x += font.FontWidth;
+        }
+    }
+
+    // op: 0 消去, 1 描画, 2 反転 画面外のピクセルは描かない
+    static void rect(int16_t x, int16_t y, int16_t w, int16_t h, uint8_t op) {
+        for (int16_t i = x; i < x + w; i++) {
+            for (int16_t j = y; j < y + h; j++) {
+                if (i < 0 || j < 0 || i >= SSD1306_WIDTH || j >= SSD1306_HEIGHT)
+                    continue;
+                if (op == 2)
+                    ssd1306_InvertPixel(i, j);
+                else
+                    ssd1306_DrawPixel(i, j, (op == 1) ? White : Black);
+            }
+        }
+    }
+};
+
+std::vector<uint8_t> buffer() { return std::vector<uint8_t>(ssd1306_GetBuffer(), ssd1306_GetBuffer() + BUFFER_SIZE); }
+
+// 画面更新し、転送完了を待ってホスト用の画面が描画バッファと一致するか確かめる
+bool mirrored(SSD1306_Backend const* backend) {
+    ssd1306_UpdateScreen();
+    while (backend->Wait(backend->Context) == 0) {
+    }
+    return memcmp(ssd1306_HostRam(), ssd1306_GetBuffer(), BUFFER_SIZE) == 0;
+}
+
+// 全フォント・全文字 背景は描画色の反対で埋め、描かない範囲が変わらないことも確かめる
+bool testGlyphs(SSD1306_Backend const* backend) {
+    const uint8_t positions[][2] = { { 0, 0 }, { 3, 1 }, { 10, 2 }, { 20, 3 }, { 30, 4 }, { 40, 5 }, { 50, 6 },
+                                     { 60, 7 }, { 120, 20 }, { 5, 50 }, { 125, 60 } }; // 右端・下端ではみ出す
+    uint32_t glyphs = 0, errors = 0;
+    bool screen = true;
+    for (FontDef const* font : FONTS) {
+        for (uint8_t color = 0; color < 2; color++) {
+            for (auto const& p : positions) {
+                for (char ch = 32; ch < 127; ch++) {
+                    const char str[2] = { ch, 0 };
+                    ssd1306_Fill((SSD1306_COLOR)!color);
+                    mirrored(backend);
+                    ssd1306_SetCursor(p[0], p[1]);
+                    ssd1306_WriteString(str, *font, (SSD1306_COLOR)color);
+                    const std::vector<uint8_t> blit = buffer();
+                    screen = mirrored(backend) && screen;
+
+                    ssd1306_Fill((SSD1306_COLOR)!color);
+                    perPixel ref;
+                    ref.x = p[0];
+                    ref.y = p[1];
+                    ref.writeString(str, *font, (SSD1306_COLOR)color);
+                    if (blit != buffer() && errors++ < 5)
+                        printf("  font %ux%u '%c' color %u at (%u, %u) differs\n", font->FontWidth, font->FontHeight,
+                               ch, color, p[0], p[1]);
+                    glyphs++;
+                }
+            }
+        }
+    }
+    const bool ok = errors == 0 && screen;
+    printf("%-10s %u glyphs, %u differ %s\n", "glyphs", glyphs, errors, ok ? "OK" : "NG");
+    return ok;
+}
+
+// 乱数で重ねて描画 同じ乱数列から、描画方法を変えて2回描く
+template <class DRAW>
+void drawScene(uint32_t seed, DRAW&& draw) {
+    std::mt19937 rng(seed);
+    for (uint8_t n = 0; n < 6; n++)
+        draw(rng);
+}
+
+bool testRandom(SSD1306_Backend const* backend) {
+    const uint32_t SCENES = 3000;
+    std::mt19937 rng(1);
+    bool inverted = false;
+    uint32_t errors = 0;
+    bool screen = true;
+    for (uint32_t n = 0; n < SCENES; n++) {
+        const SSD1306_COLOR fill = (rng() % 4) ? Black : White;
+        if (rng() % 3 == 0) {
+            ssd1306_InvertColors();
+            inverted = !inverted;
+        }
+        const uint32_t seed = rng();
+
+        // kind: 0 文字列 1 塗りつぶし 2 反転 3 水平線 4 垂直線 5 枠
+        auto blit = [](std::mt19937& r) {
+            const uint8_t kind = r() % 6;
+            const int16_t x = (int16_t)(r() % 150) - 10, y = (int16_t)(r() % 80) - 8;
+            const int16_t w = r() % 50, h = r() % 40;
+            const SSD1306_COLOR color = (SSD1306_COLOR)(r() % 2);
+            if (kind == 0) {
+                const char str[4] = { (char)(32 + r() % 95), (char)(32 + r() % 95), (char)(32 + r() % 95), 0 };
+                FontDef const& font = *FONTS[r() % 3];
+                ssd1306_SetCursor((uint8_t)(x + 10), (uint8_t)(y + 8));
+                ssd1306_WriteString(str, font, color);
+            }
+            else if (kind == 1)
+                ssd1306_FillRect(x, y, w, h, color);
+            else if (kind == 2)
+                ssd1306_InvertRect(x, y, w, h);
+            else if (kind == 3)
+                ssd1306_DrawHLine(x, y, w, color);
+            else if (kind == 4)
+                ssd1306_DrawVLine(x, y, h, color);
+            else
+                ssd1306_DrawRect(x, y, w, h, color);
+        };
+        auto pixel = [](std::mt19937& r) {
+            const uint8_t kind = r() % 6;
+            const int16_t x = (int16_t)(r() % 150) - 10, y = (int16_t)(r() % 80) - 8;
+            const int16_t w = r() % 50, h = r() % 40;
+            const SSD1306_COLOR color = (SSD1306_COLOR)(r() % 2);
+            // 色反転は ssd1306_DrawPixel で行う
+            if (kind == 0) {
+                const char str[4] = { (char)(32 + r() % 95), (char)(32 + r() % 95), (char)(32 + r() % 95), 0 };
+                FontDef const& font = *FONTS[r() % 3];
+                perPixel ref;
+                ref.x = (uint8_t)(x + 10);
+                ref.y = (uint8_t)(y + 8);
+                ref.writeString(str, font, color);
+                return;
+            }
+            if (kind == 1)
+                perPixel::rect(x, y, w, h, color);
+            else if (kind == 2)
+                perPixel::rect(x, y, w, h, 2);
+            else if (kind == 3)
+                perPixel::rect(x, y, w, 1, color);
+            else if (kind == 4)
+                perPixel::rect(x, y, 1, h, color);
+            else {
+                perPixel::rect(x, y, w, 1, color);
+                perPixel::rect(x, y + h - 1, w, 1, color);
+                perPixel::rect(x, y, 1, h, color);
+                perPixel::rect(x + w - 1, y, 1, h, color);
+            }
+        };
+
+        ssd1306_Fill(fill);
+        mirrored(backend);
+        drawScene(seed, blit);
+        const std::vector<uint8_t> result = buffer();
+        screen = mirrored(backend) && screen;
+
+        ssd1306_Fill(fill);
+        drawScene(seed, pixel);
+        if (result != buffer() && errors++ < 5)
+            printf("  scene %u (seed %u, inverted %d) differs\n", n, seed, (int)inverted);
+    }
+    if (inverted)
+        ssd1306_InvertColors();
+    const bool ok = errors == 0 && screen;
+    printf("%-10s %u scenes, %u differ %s\n", "random", SCENES, errors, ok ? "OK" : "NG");
+    return ok;
+}
+
+// エフェクト画面相当 ステータス・パラメータ名6個・数値6個・ページ・処理時間%・カーソル
+template <class TEXT, class INVERT>
+void fxFrame(TEXT&& text, INVERT&& invert) {
+    static char const* const names[6] = { "LEVEL", "GAIN", "TREBLE", "BASS", "MID", "FREQ" };
+    ssd1306_Fill(Black);
+    text(4, 0, "OVERDRIVE", Font_7x10);
+    for (uint8_t i = 0; i < 6; i++) {
+        text((i / 3) * 65, 17 + (i % 3) * 18, names[i], Font_7x10);
+        text((i / 3) * 65 + 30, 11 + (i % 3) * 18, "-12", Font_11x18);
+    }
+    text(88, 0, "P1", Font_7x10);
+    text(107, 0, "12%", Font_7x10);
+    invert(0, 29, 62, 16);
+}
+
+void benchmark() {
+    const uint32_t FRAMES = 20000;
+    auto blitText = [](uint8_t x, uint8_t y, char const* str, FontDef const& font) {
+        ssd1306_xyWriteStrWT(x, y, str, font);
+    };
+    auto blitInvert = [](int16_t x, int16_t y, int16_t w, int16_t h) { ssd1306_InvertRect(x, y, w, h); };
+    auto pixelText = [](uint8_t x, uint8_t y, char const* str, FontDef const& font) {
+        perPixel ref;
+        ref.x = x;
+        ref.y = y;
+        ref.writeString(str, font, White);
+    };
+    auto pixelInvert = [](int16_t x, int16_t y, int16_t w, int16_t h) { perPixel::rect(x, y, w, h, 2); };
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t k = 0; k < FRAMES; k++)
+        fxFrame(blitText, blitInvert);
+    const double blitUsec =
+        std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / FRAMES;
+    const std::vector<uint8_t> blit = buffer();
+
+    start = std::chrono::steady_clock::now();
+    for (uint32_t k = 0; k < FRAMES; k++)
+        fxFrame(pixelText, pixelInvert);
+    const double pixelUsec =
+        std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / FRAMES;
+
+    printf("benchmark fx screen: page %.2f us / frame, per pixel %.2f us / frame (x%.1f)%s\n", blitUsec, pixelUsec,
+           pixelUsec / blitUsec, (blit == buffer()) ? "" : " (images differ)");
+}
+} // namespace
+
+int main() {
+    SSD1306_Backend const* backend = ssd1306_HostBackend();
+    ssd1306_Init(backend);
+    bool ok = testGlyphs(backend);
+    ok = testRandom(backend) && ok;
+    benchmark();
+    puts(ok ? "OK" : "NG");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,254 @@
+// ダイナミクス brickwallLimiter・compGain と dB変換の近似 log2Approx・exp2Approx・gainToDbFast・dbToGainFast
+// ・brickwallLimiter の出力が上限（出力リミッターと同じ 0.98）を超えないこと
+//   バースト・1サンプルのスパイク・リリース中の急な増加・上限をわずかに超える振幅へのリリースを含む
+//   上限未満の入力はゲインが戻った後そのまま出力すること
+// ・compGain の静特性 入力レベルに対し出力レベルが単調増加、ゲインが単調減少で、ニーの両端でつながること
+//   アタック・リリースが指定の時定数どおりであること
+// ・近似関数の最大誤差（dB換算）が lib_calc.hpp の記載以下であること
+// ・1回の処理時間（ホスト）を表・sqrtf を使う従来の関数、標準ライブラリと比べて表示する 判定はしない
+
+#include "lib_dynamics.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+
+namespace {
+// fx::BLOCK_SIZE と同じ
+const uint32_t BLOCK = 16;
+// 出力リミッター common.h と同じ
+const float CEILING = 0.98f;
+
+bool check(bool ok, char const* name) {
+    printf("%-16s %s\n", name, ok ? "OK" : "NG");
+    return ok;
+}
+
+// 入力のブロック列を作る 種類ごとに振幅を変える
+void makeBlock(float (&x)[BLOCK], uint32_t n, std::mt19937& rng) {
+    std::uniform_real_distribution<float> noise(-1.0f, 1.0f);
+    const uint32_t kind = (n / 500) % 6;
+    for (uint32_t i = 0; i < BLOCK; i++) {
+        const float t = (float)(n * BLOCK + i);
+        switch (kind) {
+        case 0: // 上限未満と大振幅が交互に続く正弦波
+            x[i] = ((n / 50) % 2 ? 4.0f : 0.5f) * sinf(0.07f * t);
+            break;
+        case 1: // 乱数の振幅の雑音
+            x[i] = noise(rng) * (float)(rng() % 1000) * 0.01f;
+            break;
+        case 2: // 1サンプルのスパイク
+            x[i] = (rng() % 64 == 0) ? 20.0f * noise(rng) : 0.3f * noise(rng);
+            break;
+        case 3: // リリース中に少しずつ大きくなる 直線補間したゲインが上限を超えないか
+            x[i] = (0.9f + 0.002f * (float)(n % 100)) * sinf(0.3f * t);
+            break;
+        case 4: // 上限付近
+            x[i] = CEILING * (1.0f + 0.02f * noise(rng));
+            break;
+        default: // 大振幅の後、上限をわずかに超える一定の振幅 ゲインが目標（1に近い）へ戻る途中
+            x[i] = ((i % 2) ? 1.0f : -1.0f) * ((n % 500 < 10) ? 3.0f : CEILING * 1.00003f);
+            break;
+        }
+    }
+}
+
+bool testLimiter() {
+    const float releases[] = { 1.0f, 20.0f, 100.0f, 1000.0f };
+    bool ok = true;
+    float worst = 0.0f;
+    for (float release : releases) {
+        brickwallLimiter lim(CEILING, release, BLOCK);
+        std::mt19937 rng(1);
+        for (uint32_t n = 0; n < 100000; n++) {
+            float x[BLOCK];
+            makeBlock(x, n, rng);
+            lim.process(x);
+            for (float y : x)
+                worst = std::max(worst, fabsf(y));
+        }
+    }
+    printf("limiter max output %.7f (ceiling %.2f)\n", worst, CEILING);
+    ok = check(worst <= CEILING, "limiter ceiling") && ok;
+
+    // 上限未満の入力 ゲインが戻った後はそのまま出力する
+    brickwallLimiter lim(CEILING, 100.0f, BLOCK);
+    float x[BLOCK];
+    for (float& v : x)
+        v = 2.0f;
+    lim.process(x);
+    uint32_t blocks = 0;
+    bool limiting = true;
+    while (limiting && blocks < 10000) {
+        for (float& v : x)
+            v = 0.5f;
+        limiting = lim.process(x);
+        blocks++;
+    }
+    float y[BLOCK], in[BLOCK];
+    for (uint32_t i = 0; i < BLOCK; i++)
+        in[i] = y[i] = 0.97f * sinf((float)i);
+    const bool passed = !lim.process(y) && memcmp(in, y, sizeof(y)) == 0 && lim.getGain() == 1.0f;
+    printf("limiter released after %u blocks (%.0f ms)\n", blocks, 1000.0f * blocks * BLOCK / SAMPLING_FREQ);
+    ok = check(!limiting && passed, "limiter release") && ok;
+    return ok;
+}
+
+// 静特性 時定数を0として目標の圧縮量をそのまま返す
+bool testCompCurve() {
+    const float ratios[] = { 1.0f, 1.5f, 4.0f, 20.0f };
+    const float knees[] = { 0.0f, 1.0f, 6.0f, 24.0f };
+    const float thresholds[] = { -60.0f, -20.0f, 0.0f };
+    const float STEP = 0.01f;
+    bool ok = true;
+    for (float threshold : thresholds) {
+        for (float ratio : ratios) {
+            for (float knee : knees) {
+                compGain g;
+                g.set(threshold, ratio, knee);
+                g.setTime(1.0e-6f, 1.0e-6f, BLOCK);
+                float prevGain = 0.0f, prevOut = -1000.0f, maxJump = 0.0f;
+                bool shape = true;
+                for (float level = -100.0f; level <= 20.0f; level += STEP) {
+                    const float gain = g.process(level);
+                    const float out = level + gain;
+                    // ゲインは0以下で単調減少 出力レベルは単調増加 float の丸め分を許す
+                    shape = shape && gain <= 0.0f && gain <= prevGain + 1.0e-5f && out >= prevOut - 1.0e-5f;
+                    maxJump = std::max(maxJump, prevGain - gain);
+                    prevGain = gain;
+                    prevOut = out;
+                }
+                // ニーより上はレシオどおり ニーの中心は slope × knee / 8
+                const float slope = 1.0f - 1.0f / ratio;
+                const float above = g.process(threshold + knee / 2.0f + 10.0f);
+                const float center = g.process(threshold);
+                const bool value = fabsf(above + slope * (knee / 2.0f + 10.0f)) < 1.0e-4f &&
+                                   fabsf(center + slope * knee / 8.0f) < 1.0e-4f;
+                // 1ステップでのゲインの変化はレシオの傾き以下 ニーの両端で段差がない
+                const bool continuous = maxJump <= slope * STEP * 1.01f + 1.0e-5f;
+                if (!(shape && value && continuous)) {
+                    printf("  threshold %.0f ratio %.1f knee %.0f: monotonic %d value %d jump %.5f dB\n", threshold,
+                           ratio, knee, shape, value, maxJump);
+                    ok = false;
+                }
+            }
+        }
+    }
+    return check(ok, "comp curve");
+}
+
+// 時定数 圧縮量が目標の 1 - 1/e（アタック）、1/e（リリース）になるまでの時間
+bool testCompTime() {
+    const float ATTACK = 10.0f, RELEASE = 200.0f;
+    compGain g;
+    g.set(-20.0f, 4.0f, 0.0f);
+    g.setTime(ATTACK, RELEASE, BLOCK);
+    const float target = 0.75f * 20.0f; // 0dB入力 圧縮量15dB
+    const float blockMsec = 1000.0f * BLOCK / SAMPLING_FREQ;
+    uint32_t n = 0;
+    while (g.getReduction() < target * (1.0f - expf(-1.0f)) && n < 100000) {
+        g.process(0.0f);
+        n++;
+    }
+    const float attackMsec = n * blockMsec;
+    for (uint32_t i = 0; i < 10000; i++)
+        g.process(0.0f);
+    n = 0;
+    while (g.getReduction() > target * expf(-1.0f) && n < 100000) {
+        g.process(-100.0f);
+        n++;
+    }
+    const float releaseMsec = n * blockMsec;
+    printf("comp attack %.2f ms release %.2f ms (set %.0f %.0f, block %.2f ms)\n", attackMsec, releaseMsec, ATTACK,
+           RELEASE, blockMsec);
+    return check(fabsf(attackMsec - ATTACK) <= blockMsec && fabsf(releaseMsec - RELEASE) <= blockMsec, "comp time");
+}
+
+// 近似関数の最大誤差
+// x は仮数部を細かく、指数部は使用範囲全体を試す
+bool testApprox() {
+    double log2Err = 0.0, exp2Err = 0.0, toDbErr = 0.0, toGainErr = 0.0, oldToDbErr = 0.0, oldToGainErr = 0.0;
+    for (int32_t e = -126; e <= 127; e++) {
+        for (uint32_t k = 0; k < 4096; k++) {
+            const float x = ldexpf(1.0f + k / 4096.0f, e);
+            log2Err = std::max(log2Err, fabs(log2Approx(x) - log2((double)x)));
+            toDbErr = std::max(toDbErr, fabs(gainToDbFast(x) - 20.0 * log10((double)x)));
+            if (x >= 0.00001f && x <= 1.0f)
+                oldToDbErr = std::max(oldToDbErr, fabs(gainToDb(x) - 20.0 * log10((double)x)));
+        }
+    }
+    for (float x = -126.0f; x <= 126.0f; x += 0.001f) {
+        exp2Err = std::max(exp2Err, fabs(exp2Approx(x) / exp2((double)x) - 1.0));
+    }
+    for (float db = -750.0f; db <= 750.0f; db += 0.01f) {
+        toGainErr = std::max(toGainErr, fabs(20.0 * log10(dbToGainFast(db) / pow(10.0, db / 20.0))));
+        if (db >= -128.0f && db < 127.0f)
+            oldToGainErr = std::max(oldToGainErr, fabs(20.0 * log10(dbToGain(db) / pow(10.0, db / 20.0))));
+    }
+    const double exp2Db = 20.0 * log10(1.0 + exp2Err);
+    printf("log2Approx     max error %.6f (%.5f dB)\n", log2Err, 6.0206 * log2Err);
+    printf("exp2Approx     max error %.4f%% (%.5f dB)\n", 100.0 * exp2Err, exp2Db);
+    printf("gainToDbFast   max error %.5f dB (gainToDb %.4f dB, -100 - 0dB)\n", toDbErr, oldToDbErr);
+    printf("dbToGainFast   max error %.5f dB (dbToGain %.4f dB, +-128dB)\n", toGainErr, oldToGainErr);
+    // lib_calc.hpp の記載 log2Approx 0.00021 exp2Approx 0.019% gainToDbFast 0.0013dB dbToGainFast 0.0017dB
+    bool ok = log2Err <= 0.00021 && exp2Err <= 0.00019 && toDbErr <= 0.0013 && toGainErr <= 0.0017;
+    // 従来の関数の記載 gainToDb 0.016dB dbToGain 0.015dB 近似の方が誤差が小さいこと
+    ok = ok && oldToDbErr <= 0.016 && oldToGainErr <= 0.015 && toDbErr < oldToDbErr && toGainErr < oldToGainErr;
+    return check(ok, "approx error");
+}
+
+template <class F>
+double nsPerCall(F&& f) {
+    const uint32_t N = 4000000;
+    volatile float sink = 0.0f;
+    float s = 0.0f;
+    const auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < N; i++)
+        s += f(i);
+    sink = sink + s;
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / N;
+}
+
+void benchmark() {
+    auto gain = [](uint32_t i) { return 0.00001f + (float)(i & 0xFFFF) * (1.0f / 65536.0f); };
+    auto db = [](uint32_t i) { return -100.0f + (float)(i & 0xFFFF) * (100.0f / 65536.0f); };
+    const double toDbFast = nsPerCall([&](uint32_t i) { return gainToDbFast(gain(i)); });
+    const double toDb = nsPerCall([&](uint32_t i) { return gainToDb(gain(i)); });
+    const double toDbStd = nsPerCall([&](uint32_t i) { return 20.0f * log10f(gain(i)); });
+    const double toGainFast = nsPerCall([&](uint32_t i) { return dbToGainFast(db(i)); });
+    const double toGain = nsPerCall([&](uint32_t i) { return dbToGain(db(i)); });
+    const double toGainStd = nsPerCall([&](uint32_t i) { return powf(10.0f, db(i) * 0.05f); });
+    printf("benchmark gain -> dB: gainToDbFast %.2f ns, gainToDb %.2f ns, 20 log10f %.2f ns\n", toDbFast, toDb,
+           toDbStd);
+    printf("benchmark dB -> gain: dbToGainFast %.2f ns, dbToGain %.2f ns, powf %.2f ns\n", toGainFast, toGain,
+           toGainStd);
+
+    // リミッター 1ブロックの処理 制限なし・制限中
+    std::mt19937 rng(1);
+    brickwallLimiter lim(CEILING, 100.0f, BLOCK);
+    float x[BLOCK];
+    const double quiet = nsPerCall([&](uint32_t i) {
+        for (uint32_t k = 0; k < BLOCK; k++)
+            x[k] = 0.5f * (float)(k & 3) * 0.3f;
+        lim.process(x);
+        return x[3];
+    });
+    const double loud = nsPerCall([&](uint32_t i) {
+        for (uint32_t k = 0; k < BLOCK; k++)
+            x[k] = ((i & 7) == 0 && k == 5) ? 3.0f : 0.9f;
+        lim.process(x);
+        return x[3];
+    });
+    printf("benchmark limiter: %.2f ns / sample (pass), %.2f ns / sample (limiting)\n", quiet / BLOCK, loud / BLOCK);
+}
+} // namespace
+
+int main() {
+    bool ok = testLimiter();
+    ok = testCompCurve() && ok;
+    ok = testCompTime() && ok;
+    ok = testApprox() && ok;
+    benchmark();
+    puts(ok ? "OK" : "NG");
+    return ok ? 0 : 1;
+}
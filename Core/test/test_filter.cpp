@@ -0,0 +1,196 @@
+// フィルタ tanApprox・状態変数フィルタ svf・エンベロープフォロワー envFollower
+// ・tanApprox の相対誤差が使用範囲（0～1.2）で 0.0002% 程度であること
+// ・svf がナイキスト周波数付近（オートワウの上限 0.35fs、使用範囲の上限 0.38fs）でも発散しないこと
+//   インパルス応答が減衰すること サンプルごとに周波数を乱数で変えても出力が有界であること
+// ・BPF出力 × 1/Q（オートワウの出力）の中心周波数での利得が 0dB であること 中心から離れると下がること
+// ・envFollower の立ち上がり・立ち下がりが指定の時定数どおりであること 入力の絶対値を超えないこと
+// ・周波数変更と1サンプル処理の時間（ホスト）を biquadFilter と比べて表示する 判定はしない
+
+#include "lib_filter.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+
+namespace {
+// オートワウの周波数上限 fx_autowah.hpp と同じ
+const float FREQ_MAX = 0.35f * SAMPLING_FREQ;
+
+bool check(bool ok, char const* name) {
+    printf("%-16s %s\n", name, ok ? "OK" : "NG");
+    return ok;
+}
+
+// 相対誤差の最大 0 ～ xMax
+double tanError(float xMax) {
+    double worst = 0.0;
+    for (float x = 0.0005f; x <= xMax; x += 0.0005f)
+        worst = std::max(worst, fabs(tanApprox(x) / tan((double)x) - 1.0));
+    return worst;
+}
+
+// 使用範囲全体は lib_filter.hpp の記載（0.0002%）を有効桁1桁として 0.00025% 未満
+// オートワウの上限（0.35fs）までは 0.0001% 以下
+bool testTan() {
+    const double all = tanError(1.2f), autowah = tanError(PI * FREQ_MAX / SAMPLING_FREQ);
+    printf("tanApprox max error %.6f%% (0 - 1.2), %.6f%% (0 - 0.35fs)\n", 100.0 * all, 100.0 * autowah);
+    return check(all < 2.5e-6 && autowah <= 1.0e-6, "tanApprox");
+}
+
+// 正弦波を入力し、定常状態の振幅比 dB 直交成分との相関で振幅を求める
+float gainDb(svf& f, float freq, float q) {
+    const uint32_t SETTLE = 20000, N = 40000;
+    double c = 0.0, s = 0.0;
+    double phase = 0.0;
+    const double step = 2.0 * M_PI * freq / SAMPLING_FREQ;
+    for (uint32_t i = 0; i < SETTLE + N; i++) {
+        f.process((float)sin(phase));
+        if (i >= SETTLE) {
+            const double y = f.bp * (1.0f / q); // オートワウのBPF出力
+            c += y * cos(phase);
+            s += y * sin(phase);
+        }
+        phase += step;
+    }
+    return (float)(20.0 * log10(2.0 * sqrt(c * c + s * s) / N));
+}
+
+bool testPeak() {
+    const float freqs[] = { 100.0f, 1000.0f, 5000.0f, FREQ_MAX };
+    const float qs[] = { 0.7f, 2.0f, 10.0f };
+    float worst = 0.0f;
+    bool ok = true;
+    for (float fc : freqs) {
+        for (float q : qs) {
+            svf f(fc, q);
+            const float peak = gainDb(f, fc, q);
+            svf lo(fc, q), hi(fc, q);
+            const float below = gainDb(lo, fc / 1.5f, q);
+            const float above = gainDb(hi, std::min(fc * 1.2f, 0.45f * SAMPLING_FREQ), q);
+            if (fabsf(peak) > fabsf(worst))
+                worst = peak;
+            if (fabsf(peak) > 0.05f || below >= peak - 0.5f || above >= peak - 0.2f) {
+                printf("  fc %.0f Hz Q %.1f: peak %+.3f dB, fc/1.5 %+.2f dB, above %+.2f dB\n", fc, q, peak, below,
+                       above);
+                ok = false;
+            }
+        }
+    }
+    printf("bpf x 1/Q worst gain at fc %+.4f dB\n", worst);
+    return check(ok, "bpf peak gain");
+}
+
+// 固定周波数のインパルス応答 十分時間が経った後の出力が減衰していること
+// 乱数で周波数を毎サンプル変え、白色雑音を入力しても出力が有界であること
+bool testStability() {
+    const float freqs[] = { FREQ_MAX, 0.38f * SAMPLING_FREQ };
+    const float qs[] = { 0.5f, 0.7f, 10.0f, 20.0f };
+    bool ok = true;
+    for (float fc : freqs) {
+        for (float q : qs) {
+            svf f(fc, q);
+            f.process(1.0f);
+            float tail = 0.0f;
+            for (uint32_t i = 0; i < 20000; i++) {
+                f.process(0.0f);
+                if (i >= 19000)
+                    tail = std::max(tail, std::max(fabsf(f.lp), std::max(fabsf(f.bp), fabsf(f.hp))));
+            }
+            if (!(tail < 1.0e-6f)) {
+                printf("  fc %.0f Hz Q %.1f: impulse tail %g\n", fc, q, tail);
+                ok = false;
+            }
+        }
+    }
+
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> freq(20.0f, FREQ_MAX), noise(-1.0f, 1.0f);
+    float worst = 0.0f;
+    for (float q : qs) {
+        svf f(1000.0f, q);
+        float peak = 0.0f;
+        for (uint32_t i = 0; i < 1000000; i++) {
+            f.setFreq((i % 2000 < 1000) ? freq(rng) : FREQ_MAX); // 半分は上限に張り付く
+            f.process(noise(rng));
+            peak = std::max(peak, fabsf(f.bp * (1.0f / q)));
+        }
+        worst = std::max(worst, peak);
+        // 入力1に対しBPF × 1/Q の利得は最大1 周波数の急変で一時的に超える分を見込む
+        if (!(peak < 4.0f)) {
+            printf("  random modulation Q %.1f: bp x 1/Q peak %g\n", q, peak);
+            ok = false;
+        }
+    }
+    printf("svf random modulation bp x 1/Q peak %.2f (input peak 1)\n", worst);
+    return check(ok, "svf stability");
+}
+
+bool testEnvelope() {
+    const float ATTACK = 5.0f, RELEASE = 100.0f;
+    envFollower env;
+    env.set(ATTACK, RELEASE);
+    // 0 → 1 のステップ 時定数の時点で 1 - 1/e
+    const uint32_t attackN = (uint32_t)(ATTACK * SAMPLING_FREQ / 1000.0f);
+    float y = 0.0f;
+    for (uint32_t i = 0; i < attackN; i++)
+        y = env.process((i % 2) ? 1.0f : -1.0f); // 絶対値で追従する
+    const float rise = y;
+    for (uint32_t i = 0; i < 20 * attackN; i++)
+        y = env.process(1.0f);
+    const float settled = y;
+    // 1 → 0 時定数の時点で 1/e
+    const uint32_t releaseN = (uint32_t)(RELEASE * SAMPLING_FREQ / 1000.0f);
+    for (uint32_t i = 0; i < releaseN; i++)
+        y = env.process(0.0f);
+    const float fall = y;
+    printf("envelope rise %.4f fall %.4f (expect %.4f %.4f)\n", rise, fall, 1.0f - expf(-1.0f), expf(-1.0f));
+    bool ok = fabsf(rise - (1.0f - expf(-1.0f))) < 0.005f && fabsf(fall - expf(-1.0f)) < 0.005f &&
+              fabsf(settled - 1.0f) < 1.0e-4f;
+
+    // 正弦波 出力は入力の絶対値の最大を超えない
+    envFollower sine;
+    float peak = 0.0f;
+    for (uint32_t i = 0; i < 100000; i++)
+        peak = std::max(peak, sine.process(0.8f * sinf(2.0f * PI * 82.4f * i / SAMPLING_FREQ)));
+    ok = ok && peak <= 0.8f && peak > 0.7f;
+    return check(ok, "envelope");
+}
+
+// 周波数を毎サンプル変える場合の1サンプルの処理時間
+void benchmark() {
+    const uint32_t N = 4000000;
+    volatile float sink = 0.0f;
+    svf f;
+    auto start = std::chrono::steady_clock::now();
+    float s = 0.0f;
+    for (uint32_t i = 0; i < N; i++) {
+        f.setFreq(500.0f + (i & 1023));
+        f.process((i & 64) ? 0.3f : -0.3f);
+        s += f.bp;
+    }
+    const double svfNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / N;
+    sink = sink + s;
+
+    biquadFilter bq;
+    start = std::chrono::steady_clock::now();
+    s = 0.0f;
+    for (uint32_t i = 0; i < N; i++) {
+        bq.setBPF(500.0f + (i & 1023), 5.0f);
+        s += bq.process((i & 64) ? 0.3f : -0.3f);
+    }
+    const double bqNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / N;
+    sink = sink + s;
+    printf("benchmark setFreq + process: svf %.2f ns, biquadFilter setBPF %.2f ns / sample\n", svfNs, bqNs);
+}
+} // namespace
+
+int main() {
+    bool ok = testTan();
+    ok = testPeak() && ok;
+    ok = testStability() && ok;
+    ok = testEnvelope() && ok;
+    benchmark();
+    puts(ok ? "OK" : "NG");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,202 @@
+// 文字列書式化 strFormat
+// 同じ値を snprintf でも書式化し、結果を比べる
+// ・整数 負の数・最小桁数・空白埋め・0埋め（符号は先頭）・int32_t の最小値と最大値
+// ・固定小数点 整数部が0の負の数（-0.5 等）
+// ・小数 四捨五入と桁上がり（0.996 → 1.00、9.9996 → 10.000）
+//   strFormat は float で10^decimals倍してから丸めるため、端数が0.5から float の分解能以内の値は
+//   snprintf（float の値そのものを丸める）と結果が分かれる場合があり、比べない 有効桁数が7桁を超える値も同様
+//   0に丸まる負の数は符号を付けない（snprintf は -0.00）
+// ・小さいバッファ 入りきらない文字は切り捨てて'\0'で終わる（snprintf と同じ）
+// ・1回の書式化の時間（ホスト）を snprintf・std::string と比べて表示する 判定はしない
+
+#include "lib_format.hpp"
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+uint32_t s_errors = 0;
+uint32_t s_checks = 0;
+
+void compare(char const* actual, char const* expected, char const* what) {
+    s_checks++;
+    if (strcmp(actual, expected) != 0 && s_errors++ < 10)
+        printf("  %s: \"%s\" expected \"%s\"\n", what, actual, expected);
+}
+
+bool check(char const* name, uint32_t errors, uint32_t checks) {
+    printf("%-10s %6u checks, %u differ %s\n", name, checks, errors, errors ? "NG" : "OK");
+    return errors == 0;
+}
+
+// 試す整数 桁の境目・符号・最小値と最大値、乱数
+std::vector<int32_t> integers(std::mt19937& rng) {
+    std::vector<int32_t> v = { 0, 1, -1, 5, -5, 9, -9, 10, -10, 99, -99, 100, -100, 12345, -12345, INT32_MAX,
+                               INT32_MIN, INT32_MAX - 1, INT32_MIN + 1, 999999999, -999999999, 1000000000 };
+    for (uint32_t i = 0; i < 2000; i++)
+        v.push_back((int32_t)rng() >> (rng() % 31));
+    return v;
+}
+
+bool testDec(std::mt19937& rng) {
+    const uint32_t errors = s_errors, checks = s_checks;
+    for (int32_t v : integers(rng)) {
+        for (uint8_t digits = 0; digits <= 12; digits++) {
+            char actual[32], expected[32];
+            strFormat(actual).dec(v, digits);
+            snprintf(expected, sizeof(expected), "%*d", digits, v);
+            compare(actual, expected, "dec");
+            strFormat(actual).dec(v, digits, '0');
+            snprintf(expected, sizeof(expected), "%0*d", digits, v);
+            compare(actual, expected, "dec 0");
+        }
+    }
+    return check("dec", s_errors - errors, s_checks - checks);
+}
+
+bool testFixedInt(std::mt19937& rng) {
+    const uint32_t errors = s_errors, checks = s_checks;
+    for (int32_t v : integers(rng)) {
+        for (uint8_t decimals = 0; decimals <= 4; decimals++) {
+            char actual[32], expected[32];
+            strFormat(actual).fixed(v, decimals);
+            const int64_t scale = (int64_t)pow(10, decimals);
+            const int64_t u = std::llabs((int64_t)v);
+            if (decimals == 0)
+                snprintf(expected, sizeof(expected), "%d", v);
+            else
+                snprintf(expected, sizeof(expected), "%s%lld.%0*lld", (v < 0) ? "-" : "", (long long)(u / scale),
+                         decimals, (long long)(u % scale));
+            compare(actual, expected, "fixed int");
+        }
+    }
+    return check("fixed int", s_errors - errors, s_checks - checks);
+}
+
+bool testFixedFloat(std::mt19937& rng) {
+    const uint32_t errors = s_errors, checks = s_checks;
+    std::vector<float> values = { 0.0f, 0.996f, -0.996f, 9.9996f, -9.9996f, 99.999f, 0.05f, -0.5f, 440.0f, -3.14159f,
+                                  1.0e-6f, -0.004f, 0.004f, 123456.7f, -40.0f };
+    std::uniform_real_distribution<float> wide(-100000.0f, 100000.0f), narrow(-2.0f, 2.0f);
+    for (uint32_t i = 0; i < 5000; i++)
+        values.push_back((i % 2) ? wide(rng) : narrow(rng));
+
+    uint32_t skipped = 0;
+    for (float v : values) {
+        for (uint8_t decimals = 0; decimals <= 3; decimals++) {
+            const double scaled = (double)v * pow(10, decimals);
+            const float f = fabsf((float)scaled);
+            const double resolution = 2.0 * (nextafterf(f, INFINITY) - f) + 1.0e-6; // 10^decimals倍した値の分解能
+            if (fabs(scaled - floor(scaled) - 0.5) < resolution) {
+                skipped++; // 0.5ちょうど付近
+                continue;
+            }
+            char actual[32], expected[32];
+            strFormat(actual).fixed(v, decimals);
+            snprintf(expected, sizeof(expected), "%.*f", decimals, v);
+            if (expected[0] == '-' && strspn(expected + 1, "0.") == strlen(expected + 1))
+                memmove(expected, expected + 1, strlen(expected)); // -0.00 → 0.00
+            compare(actual, expected, "fixed float");
+        }
+    }
+    // 桁上がり・丸め方向は明示して確かめる
+    const struct {
+        float v;
+        uint8_t decimals;
+        char const* expected;
+    } carries[] = { { 0.996f, 2, "1.00" },   { -0.996f, 2, "-1.00" }, { 9.9996f, 3, "10.000" },
+                    { 99.96f, 1, "100.0" },  { 0.96f, 0, "1" },       { -0.06f, 1, "-0.1" },
+                    { -0.04f, 1, "0.0" },    { 2.5f, 0, "3" },        { -2.5f, 0, "-3" } };
+    for (auto const& c : carries) {
+        char actual[32];
+        strFormat(actual).fixed(c.v, c.decimals);
+        compare(actual, c.expected, "carry");
+    }
+    printf("%-10s (%u values within float resolution of 0.5 skipped)\n", "", skipped);
+    return check("fixed flt", s_errors - errors, s_checks - checks);
+}
+
+// 小さいバッファ snprintf と同じく切り捨てて'\0'で終わる 連結も続けて切り捨てる
+bool testTruncate() {
+    const uint32_t errors = s_errors, checks = s_checks;
+    for (uint32_t size = 1; size <= 14; size++) {
+        char actual[16], expected[16];
+        memset(actual, 'x', sizeof(actual));
+        strFormat f(actual, size);
+        f.fixed((int32_t)-44012, 2).str("Hz").ch('!');
+        snprintf(expected, size, "%s", "-440.12Hz!");
+        compare(actual, expected, "truncate");
+        s_checks++;
+        if (f.length() != strlen(actual) || actual[size] != 'x') {
+            s_errors++;
+            printf("  truncate size %u: length %u, wrote past the buffer %d\n", size, f.length(), actual[size] != 'x');
+        }
+    }
+    return check("truncate", s_errors - errors, s_checks - checks);
+}
+
+// 1回の書式化 周波数表示 "440.12Hz"、dB表示 "-3.1dB"
+void benchmark() {
+    const int32_t N = 2000000;
+    volatile char sink = 0;
+    auto ns = [](std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / N;
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    for (int32_t i = 0; i < N; i++) {
+        char b[12];
+        snprintf(b, sizeof(b), "%d.%02dHz", i / 100, i % 100);
+        sink = sink + b[1];
+    }
+    const double snprintfHz = ns(start);
+    start = std::chrono::steady_clock::now();
+    for (int32_t i = 0; i < N; i++) {
+        char b[12];
+        strFormat(b).fixed(i, 2).str("Hz");
+        sink = sink + b[1];
+    }
+    const double formatHz = ns(start);
+    start = std::chrono::steady_clock::now();
+    for (int32_t i = 0; i < N; i++) {
+        std::string b = std::to_string(i / 100) + "." + std::to_string(i % 100) + "Hz";
+        sink = sink + b[1];
+    }
+    const double stringHz = ns(start);
+
+    start = std::chrono::steady_clock::now();
+    for (int32_t i = 0; i < N; i++) {
+        char b[12];
+        snprintf(b, sizeof(b), "%.1fdB", -0.001f * (i % 60000));
+        sink = sink + b[1];
+    }
+    const double snprintfDb = ns(start);
+    start = std::chrono::steady_clock::now();
+    for (int32_t i = 0; i < N; i++) {
+        char b[12];
+        strFormat(b).fixed(-0.001f * (i % 60000), 1).str("dB");
+        sink = sink + b[1];
+    }
+    const double formatDb = ns(start);
+
+    printf("benchmark Hz: strFormat %.1f ns, snprintf %.1f ns (x%.1f), std::string %.1f ns (x%.1f)\n", formatHz,
+           snprintfHz, snprintfHz / formatHz, stringHz, stringHz / formatHz);
+    printf("benchmark dB: strFormat %.1f ns, snprintf %.1f ns (x%.1f)\n", formatDb, snprintfDb, snprintfDb / formatDb);
+}
+} // namespace
+
+int main() {
+    std::mt19937 rng(1);
+    bool ok = testDec(rng);
+    ok = testFixedInt(rng) && ok;
+    ok = testFixedFloat(rng) && ok;
+    ok = testTruncate() && ok;
+    benchmark();
+    puts(ok ? "OK" : "NG");
+    return ok ? 0 : 1;
+}
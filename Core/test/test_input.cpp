@@ -0,0 +1,123 @@
+// スイッチ入力 イベント化
+// 時刻付きのスイッチ状態の列を1msごとに与え、出てきたイベントを期待値と比べる
+// チャタリング除去・短押し・長押し・繰り返し・組合せ操作（held）を確かめる
+
+#include "input.hpp"
+#include <cstdio>
+#include <vector>
+
+using namespace input;
+
+namespace {
+// user_main.cpp と同じ設定 短押し20ms 長押し1000ms 繰り返し500ms後から250ms間隔 右側のスイッチのみ繰り返す
+const uint32_t DEBOUNCE = 20, LONG_MSEC = 1000, REPEAT_DELAY = 500, REPEAT_INTERVAL = 250;
+const uint8_t REPEAT_MASK = 1 << UPPER_R | 1 << LOWER_R;
+
+/// スイッチ状態 msec の間 mask の状態を続ける
+struct step {
+    uint8_t mask;
+    uint32_t msec;
+};
+
+/// 期待するイベント at: イベントが出る時刻
+struct expected {
+    uint32_t at;
+    TYPE type;
+    uint8_t sw;
+    uint8_t held;
+    uint8_t count;
+    uint32_t time;
+};
+
+struct scenario {
+    char const* name;
+    std::vector<step> feed;
+    std::vector<expected> events;
+};
+
+const uint8_t UL = 1 << UPPER_L, LL = 1 << LOWER_L, UR = 1 << UPPER_R, FT = 1 << FOOT;
+
+// 各シナリオは時刻0から始める
+const scenario SCENARIOS[] = {
+    { "debounce", // 20ms未満のチャタリングはイベントを出さない
+      { { UL, 5 }, { 0, 5 }, { UL, 19 }, { 0, 3 }, { UL, 5 }, { 0, 100 } },
+      {} },
+    { "short press", // 押して20ms後にPRESS、離して20ms後にRELEASE 時刻は押し始め
+      { { 0, 10 }, { UL, 3 }, { 0, 2 }, { UL, 200 }, { 0, 100 } },
+      { { 35, PRESS, UPPER_L, 0, 0, 15 }, { 235, RELEASE, UPPER_L, 0, 0, 15 } } },
+    { "long press", // 長押し時間の整数倍ごとにLONG 離してもRELEASEは出さない
+      { { LL, 2100 }, { 0, 100 } },
+      { { 20, PRESS, LOWER_L, 0, 0, 0 }, { 1000, LONG, LOWER_L, 0, 1, 0 }, { 2000, LONG, LOWER_L, 0, 2, 0 } } },
+    { "repeat", // 繰り返しは押し始めから500ms後、以降250msごと 繰り返した場合もRELEASEは出さない
+      { { UR, 1300 }, { 0, 100 } },
+      { { 20, PRESS, UPPER_R, 0, 0, 0 },
+        { 500, REPEAT, UPPER_R, 0, 0, 0 },
+        { 750, REPEAT, UPPER_R, 0, 0, 0 },
+        { 1000, LONG, UPPER_R, 0, 1, 0 },
+        { 1000, REPEAT, UPPER_R, 0, 0, 0 },
+        { 1250, REPEAT, UPPER_R, 0, 0, 0 } } },
+    { "no repeat", // 繰り返し対象外のスイッチはREPEATを出さない
+      { { FT, 800 }, { 0, 100 } },
+      { { 20, PRESS, FOOT, 0, 0, 0 }, { 820, RELEASE, FOOT, 0, 0, 0 } } },
+    { "combo", // 押したままのスイッチはheldに入り、修飾となって自身のイベント（REPEAT・RELEASE）を出さない
+      { { UR, 200 }, { UR | UL, 100 }, { UR, 600 }, { 0, 100 } },
+      { { 20, PRESS, UPPER_R, 0, 0, 0 },
+        { 220, PRESS, UPPER_L, UR, 0, 200 },
+        { 320, RELEASE, UPPER_L, UR, 0, 200 } } },
+    { "combo long", // LONGでもheldのスイッチは修飾となり、自身のLONG・RELEASEを出さない
+      { { FT, 100 }, { FT | LL, 1100 }, { LL, 100 }, { 0, 100 } },
+      { { 20, PRESS, FOOT, 0, 0, 0 },
+        { 120, PRESS, LOWER_L, FT, 0, 100 },
+        { 1000, LONG, FOOT, LL, 1, 0 } } },
+};
+
+bool run(scenario const& s) {
+    scanner sc(DEBOUNCE, LONG_MSEC, REPEAT_DELAY, REPEAT_INTERVAL, REPEAT_MASK);
+    std::vector<expected> actual;
+    uint32_t now = 0;
+    for (auto const& st : s.feed) {
+        for (uint32_t i = 0; i < st.msec; i++, now++) {
+            sc.process(st.mask, now);
+            event e;
+            while (sc.pop(e))
+                actual.push_back({ now, e.type, e.sw, e.held, e.count, e.time });
+        }
+    }
+
+    bool ok = actual.size() == s.events.size();
+    for (size_t i = 0; ok && i < actual.size(); i++) {
+        expected const& a = actual[i];
+        expected const& x = s.events[i];
+        ok = a.at == x.at && a.type == x.type && a.sw == x.sw && a.held == x.held && a.count == x.count &&
+             a.time == x.time;
+    }
+    printf("%-12s %s\n", s.name, ok ? "OK" : "NG");
+    if (!ok) {
+        for (auto const& a : actual)
+            printf("  at=%u type=%u sw=%u held=0x%02x count=%u time=%u\n", a.at, a.type, a.sw, a.held, a.count,
+                   a.time);
+    }
+    return ok;
+}
+} // namespace
+
+int main() {
+    bool ok = true;
+    for (auto const& s : SCENARIOS)
+        ok = run(s) && ok;
+
+    // キューが満杯の場合は捨てる（処理が止まらない）
+    scanner sc(DEBOUNCE, LONG_MSEC, REPEAT_DELAY, REPEAT_INTERVAL, REPEAT_MASK);
+    for (uint32_t now = 0; now < 10000; now++)
+        sc.process(UR, now);
+    uint32_t count = 0;
+    event e;
+    while (sc.pop(e))
+        count++;
+    const bool full = count > 0 && count <= 16;
+    printf("%-12s %s (%u events)\n", "queue full", full ? "OK" : "NG", count);
+    ok = ok && full;
+
+    puts(ok ? "OK" : "NG");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,193 @@
+// MIDI入力 バイト列 → メッセージ
+// バイト列を1バイトずつ与え、出てきたメッセージと時刻（最後のバイトの位置）を期待値と比べる
+// ・ランニングステータス、リアルタイムメッセージの割込み、システムエクスクルーシブの読み飛ばし
+// ・システムコモンによるランニングステータスの解除、未定義のリアルタイム（0xF9・0xFD）、チューンリクエスト
+// ・ホスト用の受信元（MIDI_HOST midi_host.cpp）からパイプ経由で読む
+// ・1バイトあたりの処理時間（ホスト）を表示する 判定はしない
+
+#include "midi.hpp"
+#include <chrono>
+#include <cstdio>
+#include <unistd.h> // pipe
+#include <vector>
+
+using namespace midi;
+
+namespace {
+/// 期待するメッセージ at: 最後のバイトの位置（時刻として与える）
+struct expected {
+    uint32_t at;
+    uint8_t status;
+    uint8_t data1;
+    uint8_t data2;
+};
+
+struct scenario {
+    char const* name;
+    std::vector<uint8_t> bytes;
+    std::vector<expected> messages;
+};
+
+const scenario SCENARIOS[] = {
+    { "channel", // データバイト数 CCは2 プログラムチェンジは1 チャンネルは下位4ビット
+      { 0xB0, 0x07, 0x64, 0xC3, 0x05, 0x9F, 0x3C, 0x7F, 0xE1, 0x00, 0x40 },
+      { { 2, 0xB0, 0x07, 0x64 }, { 4, 0xC3, 0x05, 0 }, { 7, 0x9F, 0x3C, 0x7F }, { 10, 0xE1, 0x00, 0x40 } } },
+    { "running", // ステータスを省略したデータは直前のステータスを繰り返す
+      { 0xB0, 0x07, 0x64, 0x0A, 0x20, 0x0B, 0x7F, 0xC0, 0x01, 0x02, 0x03 },
+      { { 2, 0xB0, 0x07, 0x64 },
+        { 4, 0xB0, 0x0A, 0x20 },
+        { 6, 0xB0, 0x0B, 0x7F },
+        { 8, 0xC0, 0x01, 0 },
+        { 9, 0xC0, 0x02, 0 },
+        { 10, 0xC0, 0x03, 0 } } },
+    { "no status", // ステータスを受け取る前のデータは無視する
+      { 0x07, 0x64, 0xB0, 0x07, 0x64 },
+      { { 4, 0xB0, 0x07, 0x64 } } },
+    { "realtime", // メッセージの途中のリアルタイムはそのまま返し、途中のメッセージは続ける
+      { 0xB0, 0xF8, 0x07, 0xFA, 0x64, 0x0A, 0xFC, 0x20, 0xFE, 0xFB, 0xFF },
+      { { 1, CLOCK, 0, 0 },
+        { 3, START, 0, 0 },
+        { 4, 0xB0, 0x07, 0x64 },
+        { 6, STOP, 0, 0 },
+        { 7, 0xB0, 0x0A, 0x20 },
+        { 8, ACTIVE_SENSING, 0, 0 },
+        { 9, CONTINUE, 0, 0 },
+        { 10, RESET, 0, 0 } } },
+    { "undefined rt", // 0xF9・0xFD は返さず、途中のメッセージ・ランニングステータスも続ける
+      { 0xB0, 0xF9, 0x07, 0xFD, 0x64, 0xF9, 0x0A, 0x20 },
+      { { 4, 0xB0, 0x07, 0x64 }, { 7, 0xB0, 0x0A, 0x20 } } },
+    { "sysex", // システムエクスクルーシブのデータは読み飛ばす 途中のリアルタイムは返す
+      { 0xB0, 0x07, 0x64, 0xF0, 0x43, 0x10, 0xF8, 0x4C, 0x00, 0xF7, 0x0A, 0x20, 0xB0, 0x0A, 0x20 },
+      { { 2, 0xB0, 0x07, 0x64 }, { 6, CLOCK, 0, 0 }, { 14, 0xB0, 0x0A, 0x20 } } },
+    { "sysex no end", // 終了（0xF7）がなくても次のステータスで読み飛ばしを終える
+      { 0xF0, 0x7E, 0x01, 0xC2, 0x05 },
+      { { 4, 0xC2, 0x05, 0 } } },
+    { "common", // システムコモンはランニングステータスを解除し、自身も繰り返さない
+      { 0xB0, 0x07, 0x64, 0xF3, 0x02, 0x0A, 0x20, 0xF1, 0x35, 0x36, 0xF2, 0x10, 0x20, 0x30 },
+      { { 2, 0xB0, 0x07, 0x64 },
+        { 4, SONG_SELECT, 0x02, 0 },
+        { 8, TIME_CODE, 0x35, 0 },
+        { 12, SONG_POSITION, 0x10, 0x20 } } },
+    { "undefined sc", // 未定義のシステムコモン（0xF4・0xF5）もランニングステータスを解除する
+      { 0xB0, 0x07, 0x64, 0xF4, 0x0A, 0x20, 0xC0, 0x01, 0xF5, 0x02 },
+      { { 2, 0xB0, 0x07, 0x64 }, { 7, 0xC0, 0x01, 0 } } },
+    { "tune request", // データのないシステムコモンはすぐに返す 受信途中のメッセージは捨てる
+      { 0xB0, 0x07, 0xF6, 0x64, 0xF6, 0xB0, 0x07, 0x64 },
+      { { 2, TUNE_REQUEST, 0, 0 }, { 4, TUNE_REQUEST, 0, 0 }, { 7, 0xB0, 0x07, 0x64 } } },
+    { "status change", // 途中で別のステータスが来た場合、受信途中のメッセージは捨てる
+      { 0xB0, 0x07, 0x90, 0x3C, 0x7F, 0x3C, 0x00 },
+      { { 4, 0x90, 0x3C, 0x7F }, { 6, 0x90, 0x3C, 0x00 } } },
+};
+
+bool compare(char const* name, std::vector<expected> const& actual, std::vector<expected> const& messages) {
+    bool ok = actual.size() == messages.size();
+    for (size_t i = 0; ok && i < actual.size(); i++) {
+        expected const& a = actual[i];
+        expected const& x = messages[i];
+        ok = a.at == x.at && a.status == x.status && a.data1 == x.data1 && a.data2 == x.data2;
+    }
+    printf("%-14s %s\n", name, ok ? "OK" : "NG");
+    if (!ok) {
+        for (auto const& a : actual)
+            printf("  at=%u status=0x%02X data=0x%02X 0x%02X\n", a.at, a.status, a.data1, a.data2);
+    }
+    return ok;
+}
+
+bool run(scenario const& s) {
+    parser p;
+    std::vector<expected> actual;
+    for (uint32_t i = 0; i < s.bytes.size(); i++) {
+        message m;
+        if (p.feed(s.bytes[i], i, m))
+            actual.push_back({ m.time, m.status, m.data1, m.data2 });
+    }
+    return compare(s.name, actual, s.messages);
+}
+
+// reset() 受信途中のメッセージ・ランニングステータスを捨てる
+bool testReset() {
+    parser p;
+    message m;
+    std::vector<expected> actual;
+    const uint8_t before[] = { 0xB0, 0x07, 0x64, 0x0A };
+    const uint8_t after[] = { 0x20, 0x0B, 0x7F, 0xC1, 0x05 };
+    uint32_t at = 0;
+    for (uint8_t b : before) {
+        if (p.feed(b, at++, m))
+            actual.push_back({ m.time, m.status, m.data1, m.data2 });
+    }
+    p.reset();
+    for (uint8_t b : after) {
+        if (p.feed(b, at++, m))
+            actual.push_back({ m.time, m.status, m.data1, m.data2 });
+    }
+    return compare("reset", actual, { { 2, 0xB0, 0x07, 0x64 }, { 8, 0xC1, 0x05, 0 } });
+}
+
+// 受信元 パイプに書いたバイト列を少しずつ読み、1バイトずつ与える
+bool testHostSource() {
+    scenario const& s = SCENARIOS[3]; // realtime
+    int fd[2];
+    if (pipe(fd) != 0)
+        return false;
+    const bool written = write(fd[1], s.bytes.data(), s.bytes.size()) == (ssize_t)s.bytes.size();
+    close(fd[1]);
+    source const& in = hostSource(fd[0]);
+
+    parser p;
+    std::vector<expected> actual;
+    uint32_t at = 0;
+    uint8_t buf[3]; // 読出単位より長い列を、複数回に分けて読む
+    uint32_t n;
+    while ((n = in.read(in.context, buf, sizeof(buf))) > 0) {
+        for (uint32_t i = 0; i < n; i++, at++) {
+            message m;
+            if (p.feed(buf[i], at, m))
+                actual.push_back({ m.time, m.status, m.data1, m.data2 });
+        }
+    }
+    close(fd[0]);
+    return compare("host source", actual, s.messages) && written;
+}
+
+// 1バイトの処理時間 クロック・ランニングステータスのCC・システムエクスクルーシブの列
+void benchmark() {
+    const uint32_t BYTES = 3000000;
+    struct stream {
+        char const* name;
+        std::vector<uint8_t> bytes; // 繰り返す列
+    };
+    const stream streams[] = {
+        { "clock", { 0xF8 } },
+        { "cc running", { 0xB0, 0x07, 0x64, 0x0A, 0x20, 0xF8, 0x0B, 0x7F } },
+        { "sysex", { 0xF0, 0x43, 0x10, 0x4C, 0x00, 0x00, 0x7E, 0x00, 0xF7 } },
+    };
+    for (auto const& st : streams) {
+        std::vector<uint8_t> bytes;
+        while (bytes.size() < BYTES)
+            bytes.insert(bytes.end(), st.bytes.begin(), st.bytes.end());
+        parser p;
+        uint32_t count = 0;
+        const auto start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < bytes.size(); i++) {
+            message m;
+            count += p.feed(bytes[i], i, m);
+        }
+        const double nsec =
+            std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / bytes.size();
+        printf("benchmark %-10s %.1f ns / byte (%u messages)\n", st.name, nsec, count);
+    }
+}
+} // namespace
+
+int main() {
+    bool ok = true;
+    for (auto const& s : SCENARIOS)
+        ok = run(s) && ok;
+    ok = testReset() && ok;
+    ok = testHostSource() && ok;
+    benchmark();
+    puts(ok ? "OK" : "NG");
+    return ok ? 0 : 1;
+}
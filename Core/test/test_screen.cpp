@@ -0,0 +1,172 @@
+// 画面表示 ホスト用の画面（SSD1306_HOST）へ描画し、基準画像 golden/*.pbm と比べる
+// ・エフェクト画面: 各エフェクトの1ページ目、2ページ目へのカーソル移動、パラメータ値変更時のステータス表示
+// ・TAP画面: バーの点灯・消灯
+// ・チューナー画面: 合っている・高い・低い・起動直後、POLY
+// 画面切替時以外は変化したウィジェットのみ描き直すため、続けて描いた画面は部分更新の結果を比べることになる
+// 描画結果は実行したディレクトリへ screen_*.pbm として保存する
+// 表示を意図して変えた場合は test_screen <golden> --update で基準画像を書き直し、画像を確認してからコミットする
+
+#include "common.h"
+#include "ssd1306.hpp"
+#include "tuner.h"
+#include "ui_screen.hpp"
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// user_main.cpp で定義 このテストでは user_main.cpp を使わない
+FxParam g_fxParam[PARAM_COUNT];
+FxParamSet g_audioParam;
+uint8_t g_fxNum = 0;
+int16_t g_fxAllData[fx::COUNT][PARAM_COUNT] = {};
+float g_tapTime = 0.0f;
+
+// tuner.cpp 解析結果 解析タスクの代わりに設定する
+extern volatile float estimatedFreq;
+extern volatile float polyCent[6];
+extern volatile uint8_t polyAge[6];
+
+namespace {
+SSD1306_Backend const* s_backend = nullptr;
+std::string s_goldenDir;
+bool s_update = false;
+
+std::vector<char> readFile(std::string const& path) {
+    std::vector<char> data;
+    if (FILE* fp = fopen(path.c_str(), "rb")) {
+        char buf[1024];
+        size_t n;
+        while ((n = fread(buf, 1, sizeof(buf), fp)) > 0)
+            data.insert(data.end(), buf, buf + n);
+        fclose(fp);
+    }
+    return data;
+}
+
+// 画面更新し、転送完了を待って画面メモリ（送信結果）を基準画像と比べる
+// データはコマンドの転送完了後に送るため、完了通知を2回受ける
+bool snapshot(char const* name) {
+    ssd1306_UpdateScreen();
+    while (s_backend->Wait(s_backend->Context) == 0) {
+    }
+    const std::string actual = std::string("screen_") + name + ".pbm";
+    const std::string golden = s_goldenDir + "/" + name + ".pbm";
+    if (s_update) {
+        const bool ok = ssd1306_HostSavePbm(golden.c_str()) == 0;
+        printf("%-14s %s\n", name, ok ? "updated" : "NG (write)");
+        return ok;
+    }
+    ssd1306_HostSavePbm(actual.c_str());
+    const std::vector<char> a = readFile(actual);
+    const std::vector<char> g = readFile(golden);
+    uint32_t diff = 0; // 異なるバイト数
+    for (size_t i = 0; i < a.size() && i < g.size(); i++)
+        diff += (a[i] != g[i]);
+    const bool ok = !g.empty() && a.size() == g.size() && diff == 0;
+    if (g.empty())
+        printf("%-14s NG (no golden %s)\n", name, golden.c_str());
+    else
+        printf("%-14s %s", name, ok ? "OK\n" : "NG ");
+    if (!g.empty() && !ok)
+        printf("(%u bytes differ, see %s)\n", diff, actual.c_str());
+    return ok;
+}
+
+// 画面切替 mainLoop と同じく全消去してウィジェットを未描画に戻す
+void clearScreen() {
+    ssd1306_Fill(Black);
+    ui::screenInvalidate();
+}
+
+bool testFx() {
+    bool ok = true;
+    uint32_t now = 100000;
+    int16_t unset[PARAM_COUNT];
+    memset(unset, 0xFF, sizeof(unset)); // 未保存 初期値を使う
+    for (uint8_t n = 0; n < fx::COUNT; n++) {
+        g_fxNum = n;
+        fx::loadParam(unset);
+        clearScreen();
+        ui::fxScreen({ 0, 0, fx::getName(), 12, now += 20 });
+        char name[16];
+        snprintf(name, sizeof(name), "fx%u", n);
+        ok = snapshot(name) && ok;
+    }
+
+    // 2ページ目の5番目へカーソル移動 画面は消去しない
+    g_fxNum = 0;
+    fx::loadParam(unset);
+    clearScreen();
+    ui::fxScreen({ 0, 0, fx::getName(), 12, now });
+    ui::fxScreen({ 10, 4, fx::getName(), 12, now += 20 });
+    ok = snapshot("fx0_page2") && ok;
+
+    // 選択中のパラメータ値を変更 一定時間、名称と値を単位付きでステータスに表示する
+    g_fxParam[10].value = (g_fxParam[10].value < g_fxParam[10].max) ? g_fxParam[10].value + 1 : g_fxParam[10].min;
+    ui::fxScreen({ 10, 4, fx::getName(), 12, now += 20 });
+    ok = snapshot("fx0_edit") && ok;
+    ui::fxScreen({ 10, 4, fx::getName(), 12, now += STATUS_DISP_MSEC + 20 });
+    ok = snapshot("fx0_edited") && ok;
+    return ok;
+}
+
+bool testTap() {
+    clearScreen();
+    ui::tapScreen(500.0f, 1000); // 拍の直後 バー点灯
+    bool ok = snapshot("tap_on");
+    ui::tapScreen(500.0f, 1100);
+    ok = snapshot("tap_off") && ok;
+    return ok;
+}
+
+bool testTuner() {
+    struct target {
+        char const* name;
+        float freq;
+    };
+    const target targets[] = {
+        { "tuner_a4", 440.0f },              // 合っている
+        { "tuner_sharp", 196.0f * 1.0121f }, // G3 +21セント
+        { "tuner_flat", 82.41f * 0.9772f },  // E2 -40セント
+        { "tuner_init", 999.0f },            // 起動直後 解析前の初期値
+    };
+    bool ok = true;
+    for (auto const& t : targets) {
+        estimatedFreq = t.freq;
+        clearScreen(); // チューナー画面は毎回全消去して描き直す
+        tunerDisp();
+        ok = snapshot(t.name) && ok;
+    }
+
+    const float cent[6] = { 0.5f, -8.0f, 25.0f, 0.0f, -50.0f, 3.0f };
+    const uint8_t age[6] = { 0, 0, 1, 255, 3, 0 };
+    for (uint8_t k = 0; k < 6; k++) {
+        polyCent[k] = cent[k];
+        polyAge[k] = age[k];
+    }
+    tunerChangeMethod(-1); // BIT → POLY
+    clearScreen();
+    tunerDisp();
+    ok = snapshot("tuner_poly") && ok;
+    tunerChangeMethod(1);
+    return ok;
+}
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        puts("usage: test_screen <golden dir> [--update]");
+        return 1;
+    }
+    s_goldenDir = argv[1];
+    s_update = argc > 2 && strcmp(argv[2], "--update") == 0;
+
+    s_backend = ssd1306_HostBackend();
+    ssd1306_Init(s_backend);
+    bool ok = testFx();
+    ok = testTap() && ok;
+    ok = testTuner() && ok;
+    puts(ok ? "OK" : "NG");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,65 @@
+// lib_snapshot 書込・読出を別スレッドから繰り返し、読み出した値が一貫していることを確認する
+// 書込側: 全要素を同じ通し番号にした構造体を書き込む
+// 読出側: 要素が混在していない（書込途中を読んでいない）こと、通し番号が戻らないことを確認する
+
+#include "lib_snapshot.hpp"
+#include <atomic>
+#include <cstdio>
+#include <thread>
+
+namespace {
+struct param {
+    uint32_t v[64]; // FxParamSet 程度の大きさ
+};
+
+snapshot<param> s_snapshot;
+std::atomic<bool> s_done{ false };
+} // namespace
+
+int main() {
+    const uint32_t WRITES = 2000000;
+
+    std::thread writer([] {
+        param p;
+        for (uint32_t k = 1; k <= WRITES; k++) {
+            for (auto& x : p.v)
+                x = k;
+            s_snapshot.write(p);
+            for (volatile uint32_t i = 0; i < k % 64; i++) {
+                // 書込間隔を変え、読出と様々な位置で重なるようにする
+            }
+        }
+        s_done = true;
+    });
+
+    uint64_t reads = 0, torn = 0, backwards = 0, updates = 0;
+    uint32_t last = 0;
+    for (bool done = false; !done;) {
+        done = s_done; // 書込完了後に最後の値を1回読む
+        param p;
+        s_snapshot.read(p);
+        reads++;
+        for (auto x : p.v) {
+            if (x != p.v[0]) {
+                torn++;
+                break;
+            }
+        }
+        if (p.v[0] < last)
+            backwards++;
+        else if (p.v[0] > last)
+            updates++;
+        last = p.v[0];
+    }
+    writer.join();
+
+    printf("reads=%llu updates=%llu torn=%llu backwards=%llu last=%u count=%u\n", (unsigned long long)reads,
+           (unsigned long long)updates, (unsigned long long)torn, (unsigned long long)backwards, last,
+           s_snapshot.count());
+    if (torn != 0 || backwards != 0 || last != WRITES || s_snapshot.count() != WRITES || updates < 2) {
+        puts("NG");
+        return 1;
+    }
+    puts("OK");
+    return 0;
+}
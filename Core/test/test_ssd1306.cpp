@@ -0,0 +1,268 @@
+// SSD1306 画面更新の転送
+// 送信内容を記録する送信先で ssd1306_UpdateScreen の転送を確かめる
+// ・変化した範囲（ページ・列の矩形）のみ転送し、転送バイト数（ssd1306_GetFrameBytes）が範囲と一致すること
+//   起動時・転送エラー後は全体を転送すること 変化がなければ転送しないこと
+// ・範囲指定のコマンドを送り、その完了後にデータを送ること 転送中に次の転送を始めないこと
+// ・転送完了待ちのタイムアウト時 転送を中止できた場合のみ転送用バッファを再利用し、次回は全体を転送すること
+// 送信内容はホスト用の画面（SSD1306_HOST）へ送り、描画バッファと一致することも確かめる
+
+#include "ssd1306.hpp"
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace {
+// 画面全体の転送バイト数 コントロールバイト + 範囲指定コマンド6バイト、コントロールバイト + データ
+const uint32_t FULL_BYTES = (1 + 6) + (1 + SSD1306_WIDTH * SSD1306_HEIGHT / 8);
+
+/// 記録した送信
+struct record {
+    uint8_t control;           ///< 0x00:コマンド 0x40:データ
+    bool dma;                  ///< Transmit（完了を待たない）
+    std::vector<uint8_t> data; ///< 送信開始時の内容
+};
+
+// 記録する送信先 Transmit は Wait を呼ぶまで転送中とし、完了時に転送中のバッファをホスト用の画面へ送る
+// s_timeout の間は Wait がタイムアウトし、s_abortFails の間は Abort で転送を止められない
+// DMAと同じく完了時のバッファの内容を送るため、転送中に書き換えると画面が崩れる
+std::vector<record> s_records;
+uint8_t* s_txData = nullptr; // 転送中のバッファ
+uint16_t s_txSize = 0;
+uint8_t s_txControl = 0;
+std::vector<uint8_t> s_txCopy; // 送信開始時の内容
+uint32_t s_violations = 0;     // 転送中の送信開始・転送中のバッファの書換
+bool s_timeout = false;
+bool s_abortFails = false;
+uint32_t s_aborts = 0; // 転送を中止した回数
+
+void violation(char const* what) {
+    printf("  violation: %s\n", what);
+    s_violations++;
+}
+
+uint8_t rec_Init(void* context) { return 0; }
+
+uint8_t rec_Write(void* context, uint8_t control, uint8_t const* data, uint16_t size) {
+    if (s_txData)
+        violation("Write during transfer");
+    s_records.push_back({ control, false, std::vector<uint8_t>(data, data + size) });
+    return ssd1306_HostBackend()->Write(nullptr, control, data, size);
+}
+
+uint8_t rec_Transmit(void* context, uint8_t control, uint8_t* data, uint16_t size) {
+    if (s_txData)
+        violation("Transmit during transfer");
+    s_records.push_back({ control, true, std::vector<uint8_t>(data, data + size) });
+    s_txData = data;
+    s_txSize = size;
+    s_txControl = control;
+    s_txCopy.assign(data, data + size);
+    return 0;
+}
+
+// 転送完了 完了通知からは次の転送（データ）を始める場合がある
+uint8_t rec_Wait(void* context) {
+    if (!s_txData || s_timeout)
+        return 1; // 転送していない・タイムアウト
+    if (memcmp(s_txData, s_txCopy.data(), s_txSize) != 0)
+        violation("buffer modified during transfer");
+    ssd1306_HostBackend()->Write(nullptr, s_txControl, s_txData, s_txSize);
+    s_txData = nullptr;
+    ssd1306_TxCpltCallback();
+    return 0;
+}
+
+uint8_t rec_Abort(void* context) {
+    if (s_abortFails)
+        return 1; // 転送を続ける
+    s_txData = nullptr;
+    s_aborts++;
+    return 0;
+}
+
+const SSD1306_Backend s_backend = { nullptr, rec_Init, rec_Write, rec_Transmit, rec_Wait, rec_Abort };
+
+// 転送が終わるまで完了させる
+void flush() {
+    while (s_backend.Wait(s_backend.Context) == 0) {
+    }
+}
+
+// 画面更新して転送を完了させ、転送バイト数を返す 記録は画面更新の分のみ残す
+uint32_t update() {
+    s_records.clear();
+    ssd1306_HostReset();
+    ssd1306_UpdateScreen();
+    flush();
+    return ssd1306_GetFrameBytes();
+}
+
+// ホスト用の画面が描画バッファと一致するか
+bool mirrored() {
+    return memcmp(ssd1306_HostRam(), ssd1306_GetBuffer(), SSD1306_WIDTH * SSD1306_HEIGHT / 8) == 0;
+}
+
+// 1回の画面更新の記録が 範囲指定コマンド → データ の順で、範囲が期待値と一致するか
+bool sentRange(uint8_t colFirst, uint8_t colLast, uint8_t pageFirst, uint8_t pageLast) {
+    const std::vector<uint8_t> command = { 0x21, colFirst, colLast, 0x22, pageFirst, pageLast };
+    const uint32_t size = (colLast - colFirst + 1) * (pageLast - pageFirst + 1);
+    return s_records.size() == 2 && s_records[0].dma && s_records[0].control == 0x00 &&
+           s_records[0].data == command && s_records[1].dma && s_records[1].control == 0x40 &&
+           s_records[1].data.size() == size;
+}
+
+// bytes: 転送バイト数 負の場合は表示しない
+bool check(bool ok, char const* name, int32_t bytes = -1) {
+    if (bytes >= 0)
+        printf("%-16s %4d bytes %s\n", name, bytes, ok ? "OK" : "NG");
+    else
+        printf("%-16s %s\n", name, ok ? "OK" : "NG");
+    if (!ok) {
+        for (auto const& r : s_records) {
+            printf("  %s 0x%02X %3u bytes:", r.dma ? "Transmit" : "Write   ", r.control, (uint32_t)r.data.size());
+            for (size_t i = 0; i < r.data.size() && i < 8; i++)
+                printf(" %02X", r.data[i]);
+            puts("");
+        }
+    }
+    return ok;
+}
+
+void start() {
+    s_violations = 0;
+    s_timeout = false;
+    s_abortFails = false;
+    s_aborts = 0;
+    ssd1306_HostClearRam(0x55); // 電源投入時の画面の内容は不定
+    ssd1306_Init(&s_backend);
+    flush();
+}
+
+// 変化した範囲のみの転送と全体の転送
+bool testPartial() {
+    start();
+    bool ok = check(mirrored(), "init");
+
+    // 変化なし 描画範囲があっても内容が同じなら転送しない
+    ssd1306_Fill(Black);
+    uint32_t bytes = update();
+    ok = check(bytes == 0 && s_records.empty() && ssd1306_HostBytes() == 0, "unchanged", bytes) && ok;
+
+    // 1ピクセル ページ2 列10のみ
+    ssd1306_DrawPixel(10, 20, White);
+    bytes = update();
+    ok = check(bytes == 7 + 1 + 1 && sentRange(10, 10, 2, 2) && mirrored(), "pixel", bytes) && ok;
+    // I2C上のバイト数は、送信ごとのスレーブアドレスを加えたもの
+    ok = check(ssd1306_HostBytes() == bytes + 2, "host bytes", ssd1306_HostBytes()) && ok;
+
+    // 複数ページにまたがる四角形 ページ1～3 列5～20 の矩形
+    ssd1306_FillRect(5, 12, 16, 14, White);
+    bytes = update();
+    ok = check(bytes == 7 + 1 + 16 * 3 && sentRange(5, 20, 1, 3) && mirrored(), "rect", bytes) && ok;
+
+    // 離れた2か所 両方を含む矩形を1回で送る
+    ssd1306_DrawPixel(0, 0, White);
+    ssd1306_DrawPixel(127, 63, White);
+    bytes = update();
+    ok = check(bytes == FULL_BYTES && sentRange(0, 127, 0, 7) && mirrored(), "corners", bytes) && ok;
+
+    // 一度描いて元に戻した場合 転送済の内容と同じため転送しない
+    ssd1306_DrawPixel(64, 32, White);
+    ssd1306_DrawPixel(64, 32, Black);
+    bytes = update();
+    ok = check(bytes == 0 && s_records.empty(), "restored", bytes) && ok;
+
+    // 描画範囲の両端が転送済の内容と同じ場合 異なる列のみ送る
+    ssd1306_DrawPixel(20, 50, White);
+    ssd1306_DrawPixel(50, 50, White);
+    ssd1306_DrawPixel(90, 50, White);
+    ssd1306_DrawPixel(20, 50, Black);
+    ssd1306_DrawPixel(90, 50, Black);
+    bytes = update();
+    ok = check(bytes == 7 + 1 + 1 && sentRange(50, 50, 6, 6) && mirrored(), "trimmed", bytes) && ok;
+
+    // 送信エラー後は全体を転送する
+    ssd1306_DrawPixel(30, 40, White);
+    ssd1306_UpdateScreen();
+    ssd1306_TxErrorCallback();
+    s_txData = nullptr;
+    ssd1306_DrawPixel(31, 40, White);
+    bytes = update();
+    ok = check(bytes == FULL_BYTES && sentRange(0, 127, 0, 7) && mirrored(), "after error", bytes) && ok;
+    return check(s_violations == 0, "no violation") && ok;
+}
+
+// 範囲指定コマンド → データの順 コマンドの完了前にデータを送らない
+bool testOrder() {
+    start();
+    ssd1306_FillRect(40, 8, 8, 8, White);
+    s_records.clear();
+    ssd1306_UpdateScreen();
+    bool ok = s_records.size() == 1 && s_records[0].control == 0x00; // コマンドのみ
+    s_backend.Wait(s_backend.Context);
+    ok = ok && s_records.size() == 2 && s_records[1].control == 0x40; // コマンド完了後にデータ
+    ok = check(ok && sentRange(40, 47, 1, 1), "command first");
+
+    // データ転送中に描画して画面更新 前回の転送完了を待ってから転送用バッファを書き換える
+    ssd1306_FillRect(40, 8, 8, 8, Black);
+    ssd1306_UpdateScreen();
+    ssd1306_FillRect(100, 56, 4, 8, White);
+    ssd1306_UpdateScreen();
+    flush();
+    ok = ok && s_records.size() == 6;
+    for (size_t i = 0; ok && i < s_records.size(); i++)
+        ok = s_records[i].dma && s_records[i].control == ((i % 2) ? 0x40 : 0x00);
+    ok = check(ok && mirrored() && s_violations == 0, "back to back") && ok;
+    return ok;
+}
+
+// 転送完了待ちのタイムアウト データ転送中に応答がなくなった場合
+bool testTimeout() {
+    // 転送を中止できた場合 転送用バッファを再利用して次の画面を送る 画面の内容は不明のため全体を送る
+    start();
+    ssd1306_FillRect(0, 0, 20, 8, White);
+    ssd1306_UpdateScreen();
+    s_backend.Wait(s_backend.Context); // データ転送中
+    s_timeout = true;
+    ssd1306_FillRect(60, 30, 10, 10, White);
+    s_records.clear();
+    ssd1306_UpdateScreen();
+    bool ok = s_aborts == 1 && ssd1306_GetFrameBytes() == FULL_BYTES && s_records.size() == 1;
+    s_timeout = false;
+    flush();
+    ok = check(ok && sentRange(0, 127, 0, 7) && mirrored() && s_violations == 0, "abort", FULL_BYTES) && ok;
+
+    // 転送を中止できない場合 DMAが読んでいる転送用バッファを書き換えず、今回の画面更新を見送る
+    start();
+    ssd1306_FillRect(0, 0, 20, 8, White);
+    ssd1306_UpdateScreen();
+    s_backend.Wait(s_backend.Context); // データ転送中
+    s_timeout = true;
+    s_abortFails = true;
+    ssd1306_FillRect(0, 0, 20, 8, Black);
+    ssd1306_FillRect(60, 30, 10, 10, White);
+    s_records.clear();
+    ssd1306_UpdateScreen();
+    bool skipped = ssd1306_GetFrameBytes() == 0 && s_records.empty() && s_aborts == 0 &&
+                   memcmp(s_txData, s_txCopy.data(), s_txSize) == 0;
+    ssd1306_UpdateScreen(); // 応答がない間は何度呼んでも送らない
+    skipped = skipped && ssd1306_GetFrameBytes() == 0 && s_records.empty();
+    ok = check(skipped, "abort failed") && ok;
+
+    // 応答が戻った後 転送中だったデータを送り終えてから、描画範囲を持ち越した画面全体を送る
+    s_timeout = false;
+    s_abortFails = false;
+    const uint32_t bytes = update();
+    const bool recovered = bytes == FULL_BYTES && sentRange(0, 127, 0, 7) && mirrored() && s_violations == 0;
+    ok = check(recovered, "recovered", bytes) && ok;
+    return ok;
+}
+} // namespace
+
+int main() {
+    bool ok = testPartial();
+    ok = testOrder() && ok;
+    ok = testTimeout() && ok;
+    puts(ok ? "OK" : "NG");
+    return ok ? 0 : 1;
+}
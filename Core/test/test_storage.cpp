@@ -0,0 +1,171 @@
+// プリセット保存 フラッシュ追記型ログ
+// ホスト用の模擬フラッシュ（STORAGE_HOST storage_host.cpp）上で storage::log を動かす
+// ・N回の保存あたりのセクター消去回数が、空き領域から計算した上限以下であること
+// ・消去を伴わない保存1回の書込時間が、そのレコードの書込時間以下であること
+// ・書込途中で電源が切れたレコードは読込時に無視され、直前のデータが読めること 以降の保存もできること
+// ・コンパクション後も各キーの最新のデータが残ること
+// ・エフェクト切替のたびにセクターを消去する旧方式との比較を表示する
+
+#include "storage.hpp"
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+// 実機と同じ 128KBセクター
+const uint32_t SECTOR_SIZE = 128 * 1024;
+// 1キーのデータ パラメータ値 int16_t × (1 + PARAM_COUNT) 相当
+struct record {
+    int16_t value[20];
+};
+const uint32_t REC_BYTES = storage::log::recordBytes(sizeof(record));
+// 保存1回で書き込むキー エフェクトのパラメータ + エフェクト番号 程度
+const uint8_t KEYS = 16;
+// 32bit書込時間 storage_host.cpp と同じ標準値
+const uint32_t PROGRAM_USEC = 16;
+
+record makeRecord(uint32_t seed) {
+    record r;
+    for (uint32_t i = 0; i < 20; i++)
+        r.value[i] = (int16_t)(seed * 31 + i);
+    return r;
+}
+
+bool check(bool ok, char const* name) {
+    printf("%-16s %s\n", name, ok ? "OK" : "NG");
+    return ok;
+}
+
+// キーごとに最新のデータが読めるか model: 最後に書いたデータ
+bool matches(storage::log const& lg, std::vector<record> const& model, std::vector<bool> const& written) {
+    for (uint8_t k = 0; k < KEYS; k++) {
+        record r;
+        const bool found = lg.read(k, &r, sizeof(r));
+        if (found != written[k] || (found && memcmp(&r, &model[k], sizeof(r)) != 0)) {
+            printf("  key %u: found=%d expected=%d\n", k, found, (int)written[k]);
+            return false;
+        }
+    }
+    return true;
+}
+
+// N回の保存（毎回1キーだけ変更）で消去回数と保存1回の書込時間を確かめる
+bool testErase() {
+    const uint32_t SAVES = 10000;
+    storage::flash const& f = storage::hostFlash(SECTOR_SIZE);
+    f.erase(f.context);
+    storage::hostResetStats();
+    storage::log lg;
+    lg.init(f);
+
+    std::vector<record> model(KEYS);
+    for (uint8_t k = 0; k < KEYS; k++) {
+        model[k] = makeRecord(k);
+        lg.write(k, &model[k], sizeof(record));
+    }
+    storage::hostResetStats();
+
+    uint32_t maxSaveUsec = 0; // 消去を伴わない保存の最大時間
+    bool ok = true;
+    for (uint32_t n = 0; n < SAVES; n++) {
+        const uint8_t k = n % KEYS;
+        model[k] = makeRecord(KEYS + n);
+        const uint32_t erases = storage::hostGetStats().eraseCount;
+        const uint32_t busy = storage::hostGetStats().busyUsec;
+        for (uint8_t i = 0; i < KEYS; i++) // 変わっていないキーは書かない
+            ok = lg.write(i, &model[i], sizeof(record)) && ok;
+        if (storage::hostGetStats().eraseCount == erases)
+            maxSaveUsec = std::max(maxSaveUsec, storage::hostGetStats().busyUsec - busy);
+    }
+    ok = ok && matches(lg, model, std::vector<bool>(KEYS, true));
+
+    // コンパクション後に残る最新レコード分を除いた空きを、毎回1レコードずつ使う
+    const uint32_t perErase = (SECTOR_SIZE - KEYS * REC_BYTES) / REC_BYTES;
+    const uint32_t eraseLimit = (SAVES + perErase - 1) / perErase;
+    const uint32_t erases = storage::hostGetStats().eraseCount;
+    const uint32_t saveLimit = REC_BYTES / 4 * PROGRAM_USEC;
+    const double avgUsec = (double)storage::hostGetStats().busyUsec / SAVES;
+    printf("%u saves: %u erases (limit %u, old scheme %u), save %u us (limit %u), average %.0f us\n", SAVES, erases,
+           eraseLimit, SAVES, maxSaveUsec, saveLimit, avgUsec);
+    ok = check(ok && erases <= eraseLimit && erases == lg.eraseCount(), "erase count") && ok;
+    ok = check(maxSaveUsec <= saveLimit, "busy per save") && ok;
+    return ok;
+}
+
+// 1レコードの書込中、各ワードの位置で電源断を模擬する
+bool testTorn() {
+    const uint32_t words = REC_BYTES / 4;
+    bool ok = true;
+    for (uint32_t cut = 1; cut <= words; cut++) {
+        storage::flash const& f = storage::hostFlash(SECTOR_SIZE);
+        f.erase(f.context);
+        storage::log lg;
+        lg.init(f);
+        std::vector<record> model(KEYS);
+        std::vector<bool> written(KEYS, true);
+        for (uint8_t k = 0; k < KEYS; k++) {
+            model[k] = makeRecord(k);
+            lg.write(k, &model[k], sizeof(record));
+        }
+
+        // 書込途中で電源断 書込は失敗する
+        storage::hostCutAfter(cut);
+        const record torn = makeRecord(1000);
+        const bool failed = !lg.write(3, &torn, sizeof(record));
+        storage::hostCutAfter(0);
+
+        // 再起動 書きかけのレコードは無視し、直前のデータを読む
+        storage::log boot;
+        const bool status = boot.init(f) == storage::log::OK;
+        const bool before = matches(boot, model, written);
+
+        // 以降の保存 壊れたヘッダの後ろはコンパクションしてから書く
+        model[3] = makeRecord(2000);
+        model[5] = makeRecord(2001);
+        const bool saved = boot.write(3, &model[3], sizeof(record)) && boot.write(5, &model[5], sizeof(record));
+        storage::log reboot;
+        reboot.init(f);
+        const bool after = saved && matches(boot, model, written) && matches(reboot, model, written);
+
+        if (!(failed && status && before && after)) {
+            printf("  cut at word %u: failed=%d status=%d before=%d after=%d\n", cut, failed, status, before, after);
+            ok = false;
+        }
+    }
+    return check(ok, "torn record");
+}
+
+// 乱数で各キーを何度も書き換えた後、コンパクションして最新のデータが残るか確かめる
+bool testCompact() {
+    std::mt19937 rng(1);
+    storage::flash const& f = storage::hostFlash(SECTOR_SIZE);
+    f.erase(f.context);
+    storage::log lg;
+    lg.init(f);
+    std::vector<record> model(KEYS);
+    std::vector<bool> written(KEYS, false);
+    for (uint32_t n = 0; n < 1000; n++) {
+        const uint8_t k = rng() % (KEYS - 2); // 書かないキーも残す
+        model[k] = makeRecord(rng());
+        written[k] = true;
+        lg.write(k, &model[k], sizeof(record));
+    }
+    uint32_t live = 0;
+    for (uint8_t k = 0; k < KEYS; k++)
+        live += written[k] ? REC_BYTES : 0;
+
+    bool ok = lg.compact() && lg.used() == live && matches(lg, model, written);
+    storage::log boot;
+    ok = ok && boot.init(f) == storage::log::OK && boot.used() == live && matches(boot, model, written);
+    return check(ok, "compact");
+}
+} // namespace
+
+int main() {
+    bool ok = testErase();
+    ok = testTorn() && ok;
+    ok = testCompact() && ok;
+    puts(ok ? "OK" : "NG");
+    return ok ? 0 : 1;
+}
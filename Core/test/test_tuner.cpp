@@ -0,0 +1,223 @@
+// チューナー 周波数推定の精度・処理時間
+// ・ビットストリーム自己相関: 64ビット単位でまとめて計算した相関が、1ビットずつ計算した値と一致すること
+// ・合成したギター・ベースの音（倍音付き）について、推定周波数の誤差が推定方法ごとの許容範囲内であること
+// ・1フレームの解析時間（ホスト）を推定方法ごとに表示する 判定はしない
+//
+// 解析関数・変数は tuner.cpp 内のみで使うため、tuner.cpp をこのファイルに取り込んでテストする
+
+#include "tuner.cpp"
+#include <chrono>
+#include <cstdio>
+#include <random>
+
+namespace {
+// 許容誤差 セント 推定方法ごと
+// BIT: 周期をサンプル単位で求めて補間するため、画面表示の最小段階（2セント）程度
+// YIN/MPM: 高精度の推定方法として 0.5セント
+const float TOLERANCE_CENT[] = { 2.0f, 0.5f, 0.5f };
+
+// 合成音 基音と倍音 倍音は1/hで減衰、位相はランダム 基音に対し-40dBの雑音を加える
+class note {
+private:
+    float freq;
+    float phase[6] = {};
+    std::mt19937& rng;
+    std::uniform_real_distribution<float> noise{ -0.002f, 0.002f };
+
+public:
+    note(float freq, std::mt19937& rng) : freq(freq), rng(rng) {
+        std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+        for (auto& p : phase)
+            p = dist(rng);
+    }
+
+    float next() // 間引き後のサンプリング周波数で1サンプル
+    {
+        float y = noise(rng);
+        for (uint8_t h = 1; h <= 6; h++) {
+            y += 0.2f * sinf(2.0f * PI * phase[h - 1]) / (float)h;
+            phase[h - 1] += h * freq / tunerSamplingFreq;
+            phase[h - 1] -= floorf(phase[h - 1]);
+        }
+        return y;
+    }
+};
+
+// 解析1フレーム 解析タスクと同じく入力LPFを通して inData を埋めてから解析する
+void analyzeFrame(note& n, lpf2nd& lpf, TunerMethod method) {
+    const uint16_t size = (method == TUNER_BIT) ? inDataSize : inDataSizeFine;
+    for (uint16_t i = 0; i < size; i++)
+        inData[i] = lpf.process(n.next());
+    switch (method) {
+    case TUNER_BIT:
+        bitStreamSet();
+        bitstreamAutocorrelation();
+        estimateFreq(inData);
+        break;
+    case TUNER_YIN:
+        estimateFreqYin();
+        break;
+    default:
+        estimateFreqMpm();
+        break;
+    }
+}
+
+// 推定周波数の誤差 セント 確定しなかった場合は999
+float measureCent(float freq, TunerMethod method, std::mt19937& rng) {
+    note n(freq, rng);
+    lpf2nd lpf(maxFreq * TUNER_DECIMATION);
+    estimatedFreq = 999.0f;
+    for (uint8_t frame = 0; frame < 8; frame++) // LPFの立ち上がり後、3回連続で確定する
+        analyzeFrame(n, lpf, method);
+    if (estimatedFreq == 999.0f)
+        return 999.0f;
+    return 1200.0f * log2f(estimatedFreq / freq);
+}
+
+// 1ビットずつ計算した相関 lag = index * 64 + shift のまとめ方によらない基準値
+uint32_t referenceCorr(uint16_t lag) {
+    auto bit = [](uint32_t n) -> uint32_t {
+        return (n < bitStreamSize * 64u) ? (uint32_t)(bitStream[n / 64] >> (n % 64)) & 1 : 0;
+    };
+    uint32_t corr = 0;
+    for (uint32_t n = 0; n < bitStreamSize / 2 * 64u; n++)
+        corr += bit(n) ^ bit(n + lag);
+    return corr;
+}
+
+bool testCorrelation(std::mt19937& rng) {
+    // ランダムなビット列と、合成音から作ったビット列の両方で確かめる
+    bool ok = true;
+    for (uint8_t pattern = 0; pattern < 2; pattern++) {
+        if (pattern == 0) {
+            for (auto& b : bitStream)
+                b = ((uint64_t)rng() << 32) | rng();
+        }
+        else {
+            note n(110.0f, rng);
+            for (uint16_t i = 0; i < inDataSize; i++)
+                inData[i] = n.next();
+            bitStreamSet();
+        }
+        bitstreamAutocorrelation();
+
+        uint32_t refMin = UINT32_MAX, refMax = 0;
+        for (uint16_t lag = 0; lag < maxLag; lag++) {
+            const uint32_t ref = referenceCorr(lag);
+            if (corrArray[lag] != ref) {
+                printf("corr NG pattern=%u lag=%u corr=%u ref=%u\n", pattern, lag, corrArray[lag], ref);
+                ok = false;
+                break;
+            }
+            refMax = std::max(refMax, ref);
+            if (lag >= minPeriod)
+                refMin = std::min(refMin, ref);
+        }
+        if (maxCorr != refMax || minCorr != refMin || corrArray[estimatedIdx] != refMin) {
+            printf("corr NG pattern=%u max=%u/%u min=%u/%u\n", pattern, maxCorr, refMax, minCorr, refMin);
+            ok = false;
+        }
+    }
+    printf("correlation lags=%u %s\n", maxLag, ok ? "OK" : "NG");
+    return ok;
+}
+
+bool testAccuracy(std::mt19937& rng) {
+    struct target {
+        char const* name;
+        float freq;
+        TunerMethod method;
+    };
+    const target targets[] = {
+        // ギター 開放弦・ドロップD・12フレット
+        { "guitar E2", 82.41f, TUNER_BIT },
+        { "guitar A2", 110.00f, TUNER_BIT },
+        { "guitar D3", 146.83f, TUNER_BIT },
+        { "guitar G3", 196.00f, TUNER_BIT },
+        { "guitar B3", 246.94f, TUNER_BIT },
+        { "guitar E4", 329.63f, TUNER_BIT },
+        { "guitar D2", 73.42f, TUNER_BIT },
+        { "guitar E3", 164.81f, TUNER_BIT },
+        // ベース BITは70Hz以上のため3・4弦のみ 低音弦はYIN/MPM
+        { "bass D2", 73.42f, TUNER_BIT },
+        { "bass G2", 98.00f, TUNER_BIT },
+        { "bass B0", 30.87f, TUNER_YIN },
+        { "bass E1", 41.20f, TUNER_YIN },
+        { "bass A1", 55.00f, TUNER_YIN },
+        { "bass E1", 41.20f, TUNER_MPM },
+        { "bass A1", 55.00f, TUNER_MPM },
+        { "bass G2", 98.00f, TUNER_MPM },
+    };
+    bool ok = true;
+    for (auto const& t : targets) {
+        float worst = 0.0f;
+        for (float detune = -40.0f; detune <= 40.0f; detune += 10.0f) { // 基準からずらした音も確かめる
+            const float cent = measureCent(t.freq * exp2f(detune / 1200.0f), t.method, rng);
+            if (fabsf(cent) > fabsf(worst))
+                worst = cent;
+        }
+        const bool pass = fabsf(worst) <= TOLERANCE_CENT[t.method];
+        printf("%-10s %-3s %7.2fHz worst %+7.2f cent (limit %.1f) %s\n", t.name, methodName[t.method], t.freq, worst,
+               TOLERANCE_CENT[t.method], pass ? "OK" : "NG");
+        ok = ok && pass;
+    }
+    return ok;
+}
+
+// 1フレームの解析時間 us 入力は解析関数が書き換えないため、同じフレームを繰り返し解析する
+double frameUsec(TunerMethod method, uint32_t frames) {
+    const auto start = std::chrono::steady_clock::now();
+    for (uint32_t k = 0; k < frames; k++) {
+        switch (method) {
+        case TUNER_BIT:
+            bitStreamSet();
+            bitstreamAutocorrelation();
+            estimateFreq(inData);
+            break;
+        case TUNER_YIN:
+            estimateFreqYin();
+            break;
+        default:
+            estimateFreqMpm();
+            break;
+        }
+    }
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / frames;
+}
+
+void benchmark(std::mt19937& rng) {
+    const uint32_t FRAMES = 2000;
+    note n(110.0f, rng);
+    for (uint16_t i = 0; i < inDataSizeFine; i++)
+        inData[i] = n.next();
+
+    const double usec = frameUsec(TUNER_BIT, FRAMES);
+    const auto start = std::chrono::steady_clock::now();
+    volatile uint32_t sink = 0;
+    for (uint32_t k = 0; k < FRAMES / 20; k++) {
+        for (uint16_t lag = 0; lag < maxLag; lag++)
+            sink = sink + referenceCorr(lag);
+    }
+    const double refUsec =
+        std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / (FRAMES / 20);
+    printf("benchmark BIT frame %u samples (%.1f ms): %.1f us / frame, 1-bit reference %.1f us (x%.0f)\n",
+           inDataSize, 1000.0f * inDataSize / tunerSamplingFreq, usec, refUsec, refUsec / usec);
+
+    // YIN/MPM は BIT より長いフレームで差分関数・正規化自己相関を計算する
+    for (TunerMethod method : { TUNER_YIN, TUNER_MPM }) {
+        const double fineUsec = frameUsec(method, FRAMES / 20);
+        printf("benchmark %s frame %u samples (%.1f ms): %.1f us / frame (x%.0f BIT)\n", methodName[method],
+               inDataSizeFine, 1000.0f * inDataSizeFine / tunerSamplingFreq, fineUsec, fineUsec / usec);
+    }
+}
+} // namespace
+
+int main() {
+    std::mt19937 rng(1);
+    bool ok = testCorrelation(rng);
+    ok = testAccuracy(rng) && ok;
+    benchmark(rng);
+    puts(ok ? "OK" : "NG");
+    return ok ? 0 : 1;
+}
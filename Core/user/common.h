@@ -2,12 +2,21 @@
 
 #include "fx.h"
 #include <cstdint>
-#include <string>
 
 /// タップテンポ機能
 #define TAP_ENABLED
 /// チューナー機能
 #define TUNER_ENABLED
+/// レベルメーター画面
+#define METER_ENABLED
+/// スペクトラムアナライザー画面
+#define SPECTRUM_ENABLED
+/// プリセット機能
+#define PRESET_ENABLED
+/// MIDI入力
+#define MIDI_ENABLED
+/// 出力リミッター 出力段でクリップする前にゲインを下げる
+#define OUTPUT_LIMITER_ENABLED
 
 /* 各定数設定 --------------------------*/
 
@@ -23,18 +32,78 @@ constexpr uint32_t SHORT_PUSH_MSEC = 20;
 /// スイッチ長押し時間 ミリ秒
 constexpr uint32_t LONG_PUSH_MSEC = 1000;
 
+/// スイッチ読取間隔 ミリ秒
+constexpr uint32_t INPUT_SCAN_MSEC = 1;
+
 /// ステータス情報表示時間 ミリ秒
 constexpr uint32_t STATUS_DISP_MSEC = 1000;
 
+/// 画面更新間隔 ミリ秒
+constexpr uint32_t DISP_INTERVAL_MSEC = 20;
+
 /// 各エフェクトのパラメータ数
-constexpr uint32_t PARAM_COUNT = 20;
+constexpr uint32_t PARAM_COUNT = fx::PARAM_MAX;
+
+/// プリセット数
+constexpr uint32_t PRESET_COUNT = 32;
+
+/// プリセット モーフィング時間 ミリ秒
+constexpr float MORPH_MSEC = 2000.0f;
+
+/// MIDI 受信チャンネル 1 ～ 16 0: 全チャンネル
+constexpr uint8_t MIDI_CHANNEL = 0;
+
+/// MIDI プログラムチェンジ この番号からエフェクト切替 これより前はプリセット呼出
+constexpr uint8_t MIDI_PC_FX_BASE = PRESET_COUNT;
+
+/// MIDI コントロールチェンジ この番号からパラメータ 0 ～ 127 を最小値～最大値に割り当てる
+constexpr uint8_t MIDI_CC_PARAM_BASE = 20;
+
+/// MIDI コントロールチェンジ エフェクトオン・オフ 64以上でオン
+constexpr uint8_t MIDI_CC_ON = 80;
+
+/// MIDI コントロールチェンジ エクスプレッション モジュレーションの変調元
+constexpr uint8_t MIDI_CC_EXPRESSION = 11;
+
+/// 出力リミッター 上限 出力段のクリップ(0.99)より小さくする
+constexpr float OUTPUT_LIMIT_LEVEL = 0.98f;
+
+/// 出力リミッター リリース時間 ミリ秒
+constexpr float OUTPUT_LIMIT_RELEASE_MSEC = 100.0f;
+
+/// タップテンポ最小時間 ミリ秒
+constexpr float MIN_TAP_TIME = 100.0f;
 
 /// タップテンポ最大時間 ミリ秒
 constexpr float MAX_TAP_TIME = 3000.0f;
 
-/// データ保存先 セクターと開始アドレス
+/// チューナー 入力音の間引き率 4 ～ 8
+constexpr uint32_t TUNER_DECIMATION = 4;
+
+/// チューナー動作中の出力ミュート false: エフェクト音をそのまま出力
+constexpr bool TUNER_MUTE = false;
+
+/// レベルメーター 表示範囲 dB
+constexpr float METER_RANGE_DB = 48.0f;
+
+/// レベルメーター ピークホールド時間 ミリ秒
+constexpr uint32_t METER_PEAK_HOLD_MSEC = 1000;
+
+/// スペクトラムアナライザー 解析間隔 ミリ秒 画面更新ごとのFFTを間引く
+constexpr uint32_t SPECTRUM_INTERVAL_MSEC = 50;
+
+/// スペクトラムアナライザー 表示範囲 dB
+constexpr float SPECTRUM_RANGE_DB = 60.0f;
+
+/// データ保存先 セクター、開始アドレス、サイズ
+/// ※F722RCのフラッシュは1バンクのため、セクター消去中（128KB 標準1秒 最大2秒）はフラッシュを読めずCPUが止まる
+///   プログラムも同じフラッシュにあり、消去中はI2S割込みも動かないため、消去の前に出力をミュートする
+///   音を止めないには割込みベクタ・I2S/DMA割込み・fx::process と全エフェクト・数学関数・定数表をRAMへ置く必要があるが、
+///   ディレイのバッファ（最大約130KB）等でRAM 256KBに空きがなく、ITCM RAMは16KBのため行っていない
+///   消去は追記型ログ（storage.hpp）の空きがなくなった場合のみで、起動時に空きが少なければ先に行う
 #define DATA_SECTOR FLASH_SECTOR_5
 constexpr uint32_t DATA_ADDR = 0x08020000;
+constexpr uint32_t DATA_SIZE = 128 * 1024;
 
 /* 関数 -------------------------------------*/
 
@@ -55,8 +124,24 @@ struct FxParam {
     char valueTxt[8] = { 0 }; ///< パラメータ値文字列
 };
 
+/// エフェクトパラメータ値一式 画面表示タスクからI2S割込みへ受け渡す
+struct FxParamSet {
+    uint8_t fxNum = 0;               ///< エフェクト番号
+    bool on = false;                 ///< エフェクトオン・オフ
+    int16_t value[PARAM_COUNT] = {}; ///< パラメータ値
+    int16_t morph[PARAM_COUNT] = {}; ///< モーフィング移行先のパラメータ値 モーフィングしない場合は value と同じ
+    float morphStep = 1.0f;          ///< モーフィング 1ブロックあたりの移動量 0 ～ 1
+    bool morphToTarget = false;      ///< モーフィング方向 true: morph へ false: value へ
+    uint32_t morphSeq = 0;           ///< モーフィング起点の変更回数 変わった場合、I2S割込みで補間位置を0に戻す
+    float beatMsec = 0.0f;           ///< テンポ 1拍の時間 ms 0: テンポなし
+    float beatPos = 0.0f;            ///< 受け渡し時点の拍位置 拍数
+    uint32_t tapSeq = 0;             ///< テンポ更新回数 変わった場合、I2S割込みで拍位置を beatPos に合わせる
+    float expression = 0.0f;         ///< エクスプレッション 0 ～ 1 モジュレーションの変調元
+};
+
 // user_main.cpp で定義
 extern FxParam g_fxParam[PARAM_COUNT];
+extern FxParamSet g_audioParam;
 extern uint8_t g_fxNum;
 extern int16_t g_fxAllData[fx::COUNT][PARAM_COUNT];
 extern float g_tapTime;
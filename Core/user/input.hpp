@@ -0,0 +1,131 @@
+#pragma once
+
+#include "lib_ringBuf.hpp"
+#include <stdint.h>
+
+/* スイッチ入力 イベント化 -------------------------------------------------------*/
+// 一定間隔で読み取ったスイッチの状態からチャタリングを除去し、操作イベントをキューに積む
+// GPIO・RTOSに依存しないため、ホスト（PC）でも時刻と状態を与えてテストできる
+//
+// 他のスイッチを押したまま操作した場合（組合せ操作）、押したままのスイッチは held に入る
+// 組合せ操作に使われたスイッチは修飾扱いとなり、離すまで自身のイベントを出さない
+// 書込（process）と読出（pop）はそれぞれ1つのタスクから行うこと
+
+namespace input {
+/// スイッチ番号
+enum SW : uint8_t {
+    UPPER_L, ///< 左上
+    LOWER_L, ///< 左下
+    UPPER_R, ///< 右上
+    LOWER_R, ///< 右下
+    FOOT,    ///< フットスイッチ
+    SW_COUNT,
+};
+/// イベント種類
+enum TYPE : uint8_t {
+    PRESS,   ///< 押した
+    RELEASE, ///< 短押しで離した 長押し・繰り返し・修飾に使った場合は出さない
+    LONG,    ///< 長押し 押した時間が長押し時間のcount倍に達した
+    REPEAT,  ///< 長押し中の繰り返し
+};
+/// 操作イベント
+struct event {
+    TYPE type;
+    uint8_t sw;    ///< スイッチ番号
+    uint8_t held;  ///< 同時に押していた他のスイッチ ビット位置がスイッチ番号
+    uint8_t count; ///< LONG: 長押し時間の何倍か
+    uint32_t time; ///< 押し始めた時刻 ms
+};
+class scanner;
+} // namespace input
+
+/// @brief スイッチ状態 → 操作イベント
+class input::scanner {
+private:
+    struct state {
+        bool raw = false;        // 前回読み取った状態
+        bool pressed = false;    // チャタリング除去後の状態
+        bool modifier = false;   // 組合せ操作に使われた 離すまでイベントを出さない
+        bool repeated = false;   // REPEATイベントを出した
+        uint8_t longCount = 0;   // 出したLONGイベントの数
+        uint32_t changeTime = 0; // 読み取った状態が変化した時刻
+        uint32_t pressTime = 0;  // 押し始めた時刻
+        uint32_t repeatTime = 0; // 次のREPEATイベントの時刻
+    };
+
+    const uint32_t debounceMsec;       // この時間同じ状態が続いた場合に確定する
+    const uint32_t longMsec;           // 長押し時間
+    const uint32_t repeatDelayMsec;    // 押し始めから最初のREPEATまでの時間
+    const uint32_t repeatIntervalMsec; // REPEATの間隔
+    const uint8_t repeatMask;          // REPEATを出すスイッチ
+    state sw[SW_COUNT];
+    ringBuf<event, 16> queue;
+
+    uint8_t heldMask(uint8_t self) const // 押されている他のスイッチ
+    {
+        uint8_t mask = 0;
+        for (uint8_t i = 0; i < SW_COUNT; i++) {
+            if (i != self && sw[i].pressed)
+                mask |= 1 << i;
+        }
+        return mask;
+    }
+
+    void emit(TYPE type, uint8_t i, uint8_t count) {
+        const uint8_t held = heldMask(i);
+        queue.push({ type, i, held, count, sw[i].pressTime }); // 満杯の場合は捨てる
+        if (type == RELEASE || type == LONG) {
+            for (uint8_t k = 0; k < SW_COUNT; k++) {
+                if (held & (1 << k))
+                    sw[k].modifier = true;
+            }
+        }
+    }
+
+public:
+    scanner(uint32_t debounceMsec, uint32_t longMsec, uint32_t repeatDelayMsec, uint32_t repeatIntervalMsec,
+        uint8_t repeatMask)
+        : debounceMsec(debounceMsec), longMsec(longMsec), repeatDelayMsec(repeatDelayMsec),
+          repeatIntervalMsec(repeatIntervalMsec), repeatMask(repeatMask) {}
+
+    void process(uint8_t pressedMask, uint32_t now) // 読み取った状態 ビット位置がスイッチ番号 1:押している
+    {
+        for (uint8_t i = 0; i < SW_COUNT; i++) {
+            state& s = sw[i];
+            const bool raw = pressedMask & (1 << i);
+            if (raw != s.raw) {
+                s.raw = raw;
+                s.changeTime = now;
+            }
+            // 状態確定
+            if (raw != s.pressed && now - s.changeTime >= debounceMsec) {
+                s.pressed = raw;
+                if (raw) {
+                    s.pressTime = s.changeTime;
+                    s.repeatTime = s.pressTime + repeatDelayMsec;
+                    s.longCount = 0;
+                    s.modifier = false;
+                    s.repeated = false;
+                    emit(PRESS, i, 0);
+                }
+                else if (!s.modifier && s.longCount == 0 && !s.repeated) {
+                    emit(RELEASE, i, 0);
+                }
+            }
+            if (!s.pressed || s.modifier)
+                continue;
+            // 長押し
+            if (now - s.pressTime >= (s.longCount + 1u) * longMsec) {
+                s.longCount++;
+                emit(LONG, i, s.longCount);
+            }
+            if ((repeatMask & (1 << i)) && (int32_t)(now - s.repeatTime) >= 0) {
+                s.repeatTime += repeatIntervalMsec;
+                s.repeated = true;
+                emit(REPEAT, i, 0);
+            }
+        }
+    }
+
+    bool pop(event& e) { return queue.pop(e); } // 読出 空の場合はfalseを返す
+};
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <stdint.h>
+
+/* MIDI入力 バイト列 → メッセージ ---------------------------------------------------*/
+// 受信したバイトを1つずつ与え、メッセージが揃った時点で返す
+// ランニングステータス（ステータスバイトを省略したチャンネルメッセージ）に対応する
+// リアルタイムメッセージ（クロック等）は他のメッセージの途中に割り込んでもそのまま返し、途中のメッセージは続ける
+// システムエクスクルーシブは読み飛ばす
+// 1バイトの処理はループを含まず一定時間で終わるため、クロックとCCが続けて届いても処理時間が増えない
+// GPIO・RTOSに依存しないため、ホスト（PC）でもバイト列を与えてテストできる
+
+namespace midi {
+/// ステータス チャンネルメッセージは上位4ビット
+enum STATUS : uint8_t {
+    NOTE_OFF = 0x80,
+    NOTE_ON = 0x90,
+    POLY_PRESSURE = 0xA0,
+    CONTROL_CHANGE = 0xB0,
+    PROGRAM_CHANGE = 0xC0,
+    CHANNEL_PRESSURE = 0xD0,
+    PITCH_BEND = 0xE0,
+    SYSEX = 0xF0,
+    TIME_CODE = 0xF1,
+    SONG_POSITION = 0xF2,
+    SONG_SELECT = 0xF3,
+    TUNE_REQUEST = 0xF6,
+    SYSEX_END = 0xF7,
+    CLOCK = 0xF8, ///< タイミングクロック 1拍に24回
+    START = 0xFA,
+    CONTINUE = 0xFB,
+    STOP = 0xFC,
+    ACTIVE_SENSING = 0xFE,
+    RESET = 0xFF,
+};
+/// 1拍あたりのタイミングクロック数
+constexpr uint32_t CLOCK_PPQN = 24;
+/// メッセージ
+struct message {
+    uint8_t status; ///< ステータスバイト チャンネルメッセージは下位4ビットがチャンネル
+    uint8_t data1;  ///< データ1 ない場合0
+    uint8_t data2;  ///< データ2 ない場合0
+    uint32_t time;  ///< 最後のバイトを受け取った時刻 ms
+
+    uint8_t type() const { return (status < SYSEX) ? (status & 0xF0) : status; } ///< チャンネルを除いたステータス
+    uint8_t channel() const { return status & 0x0F; }                            ///< チャンネル 0 ～ 15
+};
+/// @brief 受信バイト列の取得元 実機: midi_uart.cpp ホスト（PC）でのテスト用: midi_host.cpp
+struct source {
+    void* context;
+    uint32_t (*read)(void* context, uint8_t* data, uint32_t size); ///< 受信済のバイトを最大size個移し、移した数を返す
+};
+class parser;
+
+/// @brief USART受信 31250bps 最初の呼出時にUSART・DMAを設定する midi_uart.cpp
+source const& uartSource();
+#ifdef MIDI_HOST
+/// @brief ホスト（PC）でのテスト用 ファイル・パイプから読む midi_host.cpp
+/// @param[in] fd ファイルディスクリプタ
+source const& hostSource(int fd);
+#endif
+} // namespace midi
+
+/// @brief 受信バイト → メッセージ
+class midi::parser {
+private:
+    uint8_t status = 0; // 受信中のステータス 0: なし（データバイトは無視する）
+    uint8_t length = 0; // データバイト数
+    uint8_t count = 0;  // 受け取ったデータバイト数
+    uint8_t data[2] = {};
+
+    static uint8_t dataLength(uint8_t s) // ステータスに続くデータバイト数
+    {
+        if (s < SYSEX)
+            return ((s & 0xF0) == PROGRAM_CHANGE || (s & 0xF0) == CHANNEL_PRESSURE) ? 1 : 2;
+        if (s == TIME_CODE || s == SONG_SELECT)
+            return 1;
+        return (s == SONG_POSITION) ? 2 : 0;
+    }
+
+public:
+    bool feed(uint8_t b, uint32_t time, message& m) // メッセージが揃った場合trueを返し、mに入れる
+    {
+        if (b >= CLOCK) {
+            // リアルタイム 受信中のメッセージはそのまま続ける
+            if (b == 0xF9 || b == 0xFD)
+                return false; // 未定義
+            m = { b, 0, 0, time };
+            return true;
+        }
+        if (b & 0x80) {
+            count = 0;
+            length = dataLength(b);
+            if (b < SYSEX) {
+                status = b; // ランニングステータスとして保持する
+                return false;
+            }
+            // システムコモン・システムエクスクルーシブはランニングステータスを解除する
+            status = (b == SYSEX || b == SYSEX_END || b == 0xF4 || b == 0xF5) ? 0 : b;
+            if (status != 0 && length == 0) {
+                m = { b, 0, 0, time }; // チューンリクエスト
+                status = 0;
+                return true;
+            }
+            return false;
+        }
+        if (status == 0)
+            return false; // システムエクスクルーシブのデータ、ステータスのないデータ
+        data[count++] = b;
+        if (count < length)
+            return false;
+        m = { status, data[0], (length > 1) ? data[1] : (uint8_t)0, time };
+        count = 0;
+        if (status >= SYSEX)
+            status = 0; // システムコモンは繰り返さない
+        return true;
+    }
+
+    void reset() // 受信中のメッセージ・ランニングステータスを捨てる
+    {
+        status = 0;
+        count = 0;
+    }
+};
@@ -0,0 +1,31 @@
+/**
+ * MIDI入力 受信元 ホスト（PC）でのテスト用 ファイル・パイプから読む
+ * MIDI_HOST を定義してビルドした場合のみ有効
+ *
+ * 使用例 演奏データ（バイト列）をそのまま流す
+ *   midi::source const& in = midi::hostSource(open("show.bin", O_RDONLY));
+ *   mkfifo で作ったパイプや標準入力（0）も使える 読出は1バイト以上届くまで待つ
+ */
+
+#ifdef MIDI_HOST
+
+#include "midi.hpp"
+#include <unistd.h> // read
+
+namespace {
+int s_fd = -1;
+midi::source s_source;
+
+uint32_t hostRead(void* context, uint8_t* data, uint32_t size) {
+    const ssize_t n = read(*static_cast<int*>(context), data, size);
+    return (n > 0) ? static_cast<uint32_t>(n) : 0; // 終端・エラーは0
+}
+} // namespace
+
+midi::source const& midi::hostSource(int fd) {
+    s_fd = fd;
+    s_source = { &s_fd, hostRead };
+    return s_source;
+}
+
+#endif
@@ -0,0 +1,72 @@
+/**
+ * MIDI入力 受信元 USART1 RX (PA10) 31250bps 8N1
+ * DMA2 Stream2 Channel4 を循環モードで動かし、受信したバイトをリングバッファへ書き込ませる
+ * 割込みは使わず、読出時にDMAの残り転送数から書込位置を求める
+ * リングバッファが一周する前（RING_SIZE バイト 約80ms）に読み出すこと
+ *
+ * CubeMXの設定に含まれないため、最初の呼出時にクロック・GPIO・USART・DMAを設定する
+ * 受信のみのため、他の機能とピン・DMAストリームが重ならないことを確認すること
+ */
+
+#include "midi.hpp"
+#include "main.h"
+
+namespace {
+/// リングバッファ サイズ 2のべき乗
+constexpr uint32_t RING_SIZE = 256;
+/// ボーレート
+constexpr uint32_t BAUD_RATE = 31250;
+
+/// リングバッファ DMAが書き込む Dキャッシュの無効化単位（32バイト）に揃える
+alignas(32) uint8_t s_ring[RING_SIZE];
+/// 読出位置
+uint32_t s_readPos = 0;
+midi::source s_source = { nullptr, nullptr };
+
+uint32_t uartRead(void* context, uint8_t* data, uint32_t size) {
+    const uint32_t writePos = (RING_SIZE - LL_DMA_GetDataLength(DMA2, LL_DMA_STREAM_2)) % RING_SIZE;
+    if (writePos == s_readPos)
+        return 0;
+    SCB_InvalidateDCache_by_Addr(reinterpret_cast<uint32_t*>(s_ring), RING_SIZE); // DMAが書き込んだ内容を読む
+    uint32_t n = 0;
+    while (s_readPos != writePos && n < size) {
+        data[n++] = s_ring[s_readPos];
+        s_readPos = (s_readPos + 1) & (RING_SIZE - 1);
+    }
+    return n;
+}
+} // namespace
+
+midi::source const& midi::uartSource() {
+    if (s_source.read)
+        return s_source;
+
+    LL_AHB1_GRP1_EnableClock(LL_AHB1_GRP1_PERIPH_GPIOA | LL_AHB1_GRP1_PERIPH_DMA2);
+    LL_APB2_GRP1_EnableClock(LL_APB2_GRP1_PERIPH_USART1);
+
+    // PA10 USART1_RX フォトカプラ出力のためプルアップ
+    LL_GPIO_SetPinMode(GPIOA, LL_GPIO_PIN_10, LL_GPIO_MODE_ALTERNATE);
+    LL_GPIO_SetAFPin_8_15(GPIOA, LL_GPIO_PIN_10, LL_GPIO_AF_7);
+    LL_GPIO_SetPinPull(GPIOA, LL_GPIO_PIN_10, LL_GPIO_PULL_UP);
+
+    // DMA USART1_RX → リングバッファ 循環モード
+    LL_DMA_SetChannelSelection(DMA2, LL_DMA_STREAM_2, LL_DMA_CHANNEL_4);
+    LL_DMA_SetDataTransferDirection(DMA2, LL_DMA_STREAM_2, LL_DMA_DIRECTION_PERIPH_TO_MEMORY);
+    LL_DMA_SetMode(DMA2, LL_DMA_STREAM_2, LL_DMA_MODE_CIRCULAR);
+    LL_DMA_SetPeriphIncMode(DMA2, LL_DMA_STREAM_2, LL_DMA_PERIPH_NOINCREMENT);
+    LL_DMA_SetMemoryIncMode(DMA2, LL_DMA_STREAM_2, LL_DMA_MEMORY_INCREMENT);
+    LL_DMA_SetPeriphSize(DMA2, LL_DMA_STREAM_2, LL_DMA_PDATAALIGN_BYTE);
+    LL_DMA_SetMemorySize(DMA2, LL_DMA_STREAM_2, LL_DMA_MDATAALIGN_BYTE);
+    LL_DMA_SetPeriphAddress(DMA2, LL_DMA_STREAM_2, reinterpret_cast<uint32_t>(&USART1->RDR));
+    LL_DMA_SetMemoryAddress(DMA2, LL_DMA_STREAM_2, reinterpret_cast<uint32_t>(s_ring));
+    LL_DMA_SetDataLength(DMA2, LL_DMA_STREAM_2, RING_SIZE);
+    LL_DMA_EnableStream(DMA2, LL_DMA_STREAM_2);
+
+    // USART1 受信のみ クロックはAPB2 オーバーランで受信を止めない
+    USART1->BRR = (HAL_RCC_GetPCLK2Freq() + BAUD_RATE / 2) / BAUD_RATE;
+    USART1->CR3 = USART_CR3_DMAR | USART_CR3_OVRDIS;
+    USART1->CR1 = USART_CR1_RE | USART_CR1_UE;
+
+    s_source = { nullptr, uartRead };
+    return s_source;
+}
@@ -1,62 +1,125 @@
 #include "ssd1306.hpp"
-#include "cmsis_os.h"
-#include <string.h> // strlen
+#include <string.h> // strlen, memcpy
 
 // Screenbuffer
 static uint8_t SSD1306_Buffer[SSD1306_WIDTH * SSD1306_HEIGHT / 8];
 
+// 画面に転送済の内容 差分のみ転送するために比較する
+static uint8_t SSD1306_Shadow[SSD1306_WIDTH * SSD1306_HEIGHT / 8];
+
+// 転送用バッファ DMA転送中も描画バッファへ次の画面を描画できるよう分けておく
+// D-Cacheのクリーンを32バイト単位で行うため32バイト境界に配置する
+static uint8_t SSD1306_TxBuffer[SSD1306_WIDTH * SSD1306_HEIGHT / 8] __attribute__((aligned(32)));
+static uint8_t SSD1306_TxCommand[32] __attribute__((aligned(32)));
+static uint16_t SSD1306_TxLength = 0;
+
+// 転送状態 コマンド(転送範囲指定)→データの順に送信する
+enum { SSD1306_TX_IDLE, SSD1306_TX_COMMAND, SSD1306_TX_DATA };
+static volatile uint8_t SSD1306_TxState = SSD1306_TX_IDLE;
+
+// 送信先
+static SSD1306_Backend const* SSD1306_Port = NULL;
+
+// 画面の内容が不明な場合（起動時・転送エラー時）は比較せず全体を転送する
+static volatile uint8_t SSD1306_ForceFull = 1;
+
+// ページ(8行)ごとの描画済の列範囲 Min > Max の場合は描画なし
+static uint8_t SSD1306_DirtyMin[SSD1306_HEIGHT / 8];
+static uint8_t SSD1306_DirtyMax[SSD1306_HEIGHT / 8];
+
+// 前回の画面更新で転送したバイト数 コマンドを含む
+static uint32_t SSD1306_FrameBytes = 0;
+
+#ifdef SSD1306_HOST
+// 描画処理で書き換えたピクセル数 ホストでの描画負荷計測用
+static uint32_t SSD1306_PixelOps = 0;
+#define SSD1306_COUNT_PIXELS(n) (SSD1306_PixelOps += (n))
+#else
+#define SSD1306_COUNT_PIXELS(n)
+#endif // SSD1306_HOST
+
 // Screen object
 static SSD1306_t SSD1306;
 
 //  Send a byte to the command register
-static uint8_t ssd1306_WriteCommand(I2C_HandleTypeDef* hi2c, uint8_t command) {
-    return HAL_I2C_Mem_Write(hi2c, SSD1306_I2C_ADDR, 0x00, 1, &command, 1, 10);
+//  初期化時のみ使用 完了まで待つ
+static uint8_t ssd1306_WriteCommand(uint8_t command) {
+    return SSD1306_Port->Write(SSD1306_Port->Context, 0x00, &command, 1);
+}
+
+//  転送開始 完了時は ssd1306_TxCpltCallback が呼ばれる
+static uint8_t ssd1306_Transmit(uint8_t control, uint8_t* data, uint16_t size) {
+    return SSD1306_Port->Transmit(SSD1306_Port->Context, control, data, size);
+}
+
+//  前回の転送完了を待つ 0:完了 1:転送中止できず転送用バッファを使用中
+static uint8_t ssd1306_WaitTx(void) {
+    while (SSD1306_TxState != SSD1306_TX_IDLE) {
+        if (SSD1306_Port->Wait(SSD1306_Port->Context) == 0) {
+            continue;
+        }
+        // 応答なし 次回は全体を転送する
+        // DMAが転送用バッファを読んでいる可能性があるため、転送を止めてから諦める
+        SSD1306_ForceFull = 1;
+        if (SSD1306_Port->Abort(SSD1306_Port->Context) != 0) {
+            return 1;
+        }
+        SSD1306_TxState = SSD1306_TX_IDLE;
+    }
+    return 0;
+}
+
+//  描画範囲を記録
+static inline void ssd1306_MarkDirty(uint8_t page, uint8_t x0, uint8_t x1) {
+    if (x0 < SSD1306_DirtyMin[page])
+        SSD1306_DirtyMin[page] = x0;
+    if (x1 > SSD1306_DirtyMax[page])
+        SSD1306_DirtyMax[page] = x1;
 }
 
 //  Initialize the oled screen
-uint8_t ssd1306_Init(I2C_HandleTypeDef* hi2c) {
+uint8_t ssd1306_Init(SSD1306_Backend const* backend) {
+    SSD1306_Port = backend;
+    SSD1306_TxState = SSD1306_TX_IDLE;
+
     // Wait for the screen to boot
-    osDelay(100);
-    int status = 0;
+    int status = SSD1306_Port->Init(SSD1306_Port->Context);
 
     // Init LCD
-    status += ssd1306_WriteCommand(hi2c, 0xAE); // Display off
-    status += ssd1306_WriteCommand(hi2c, 0x20); // Set Memory Addressing Mode
-    status += ssd1306_WriteCommand(hi2c, 0x10); // 00,Horizontal Addressing Mode;01,Vertical Addressing
-                                                // Mode;10,Page Addressing Mode (RESET);11,Invalid
-    status += ssd1306_WriteCommand(hi2c, 0xB0); // Set Page Start Address for Page Addressing Mode,0-7
-    status += ssd1306_WriteCommand(hi2c, 0xC8); // Set COM Output Scan Direction
-    status += ssd1306_WriteCommand(hi2c, 0x00); // Set low column address
-    status += ssd1306_WriteCommand(hi2c, 0x10); // Set high column address
-    status += ssd1306_WriteCommand(hi2c, 0x40); // Set start line address
-    status += ssd1306_WriteCommand(hi2c, 0x81); // set contrast control register
-    status += ssd1306_WriteCommand(hi2c, 0xFF);
-    status += ssd1306_WriteCommand(hi2c, 0xA1); // Set segment re-map 0 to 127
-    status += ssd1306_WriteCommand(hi2c, 0xA6); // Set normal display
-
-    status += ssd1306_WriteCommand(hi2c, 0xA8); // Set multiplex ratio(1 to 64)
-    status += ssd1306_WriteCommand(hi2c, SSD1306_HEIGHT - 1);
-
-    status += ssd1306_WriteCommand(hi2c, 0xA4); // 0xa4,Output follows RAM content;0xa5,Output ignores RAM content
-    status += ssd1306_WriteCommand(hi2c, 0xD3); // Set display offset
-    status += ssd1306_WriteCommand(hi2c, 0x00); // No offset
-    status += ssd1306_WriteCommand(hi2c, 0xD5); // Set display clock divide ratio/oscillator frequency
-    status += ssd1306_WriteCommand(hi2c, 0xF0); // Set divide ratio
-    status += ssd1306_WriteCommand(hi2c, 0xD9); // Set pre-charge period
-    status += ssd1306_WriteCommand(hi2c, 0x22);
-
-    status += ssd1306_WriteCommand(hi2c, 0xDA); // Set com pins hardware configuration
+    status += ssd1306_WriteCommand(0xAE); // Display off
+    status += ssd1306_WriteCommand(0x20); // Set Memory Addressing Mode
+    status += ssd1306_WriteCommand(0x00); // 00,Horizontal Addressing Mode;01,Vertical Addressing
+                                          // Mode;10,Page Addressing Mode (RESET);11,Invalid
+    status += ssd1306_WriteCommand(0xC8); // Set COM Output Scan Direction
+    status += ssd1306_WriteCommand(0x40); // Set start line address
+    status += ssd1306_WriteCommand(0x81); // set contrast control register
+    status += ssd1306_WriteCommand(0xFF);
+    status += ssd1306_WriteCommand(0xA1); // Set segment re-map 0 to 127
+    status += ssd1306_WriteCommand(0xA6); // Set normal display
+
+    status += ssd1306_WriteCommand(0xA8); // Set multiplex ratio(1 to 64)
+    status += ssd1306_WriteCommand(SSD1306_HEIGHT - 1);
+
+    status += ssd1306_WriteCommand(0xA4); // 0xa4,Output follows RAM content;0xa5,Output ignores RAM content
+    status += ssd1306_WriteCommand(0xD3); // Set display offset
+    status += ssd1306_WriteCommand(0x00); // No offset
+    status += ssd1306_WriteCommand(0xD5); // Set display clock divide ratio/oscillator frequency
+    status += ssd1306_WriteCommand(0xF0); // Set divide ratio
+    status += ssd1306_WriteCommand(0xD9); // Set pre-charge period
+    status += ssd1306_WriteCommand(0x22);
+
+    status += ssd1306_WriteCommand(0xDA); // Set com pins hardware configuration
 #ifdef SSD1306_COM_LR_REMAP
-    status += ssd1306_WriteCommand(hi2c, 0x32); // Enable COM left/right remap
+    status += ssd1306_WriteCommand(0x32); // Enable COM left/right remap
 #else
-    status += ssd1306_WriteCommand(hi2c, 0x12); // Do not use COM left/right remap
+    status += ssd1306_WriteCommand(0x12); // Do not use COM left/right remap
 #endif // SSD1306_COM_LR_REMAP
 
-    status += ssd1306_WriteCommand(hi2c, 0xDB); // Set vcomh
-    status += ssd1306_WriteCommand(hi2c, 0x20); // 0x20,0.77xVcc
-    status += ssd1306_WriteCommand(hi2c, 0x8D); // Set DC-DC enable
-    status += ssd1306_WriteCommand(hi2c, 0x14); //
-    status += ssd1306_WriteCommand(hi2c, 0xAF); // Turn on SSD1306 panel
+    status += ssd1306_WriteCommand(0xDB); // Set vcomh
+    status += ssd1306_WriteCommand(0x20); // 0x20,0.77xVcc
+    status += ssd1306_WriteCommand(0x8D); // Set DC-DC enable
+    status += ssd1306_WriteCommand(0x14); //
+    status += ssd1306_WriteCommand(0xAF); // Turn on SSD1306 panel
 
     if (status != 0) {
         return 1;
@@ -64,9 +127,10 @@ uint8_t ssd1306_Init(I2C_HandleTypeDef* hi2c) {
 
     // Clear screen
     ssd1306_Fill(Black);
+    SSD1306_ForceFull = 1; // 画面の内容は不明のため全体を転送する
 
     // Flush buffer to screen
-    ssd1306_UpdateScreen(hi2c);
+    ssd1306_UpdateScreen();
 
     // Set default values for screen object
     SSD1306.CurrentX = 0;
@@ -85,21 +149,124 @@ void ssd1306_Fill(SSD1306_COLOR color) {
     for (i = 0; i < sizeof(SSD1306_Buffer); i++) {
         SSD1306_Buffer[i] = (color == Black) ? 0x00 : 0xFF;
     }
+    for (i = 0; i < SSD1306_HEIGHT / 8; i++) {
+        ssd1306_MarkDirty(i, 0, SSD1306_WIDTH - 1);
+    }
+    SSD1306_COUNT_PIXELS(SSD1306_WIDTH * SSD1306_HEIGHT);
 }
 
 //  Write the screenbuffer with changed to the screen
-void ssd1306_UpdateScreen(I2C_HandleTypeDef* hi2c) {
+//  転送済の内容と異なる範囲（ページ・列の矩形）を転送用バッファへコピーし、1回のDMA転送で送る
+//  転送完了は待たずに戻るため、転送中に次の画面を描画できる
+void ssd1306_UpdateScreen(void) {
     uint8_t i;
 
-    for (i = 0; i < 8; i++) {
-        ssd1306_WriteCommand(hi2c, 0xB0 + i);
-        ssd1306_WriteCommand(hi2c, 0x00);
-        ssd1306_WriteCommand(hi2c, 0x10);
+    // 転送用バッファと転送済の内容を更新するため、前回の転送完了を待つ
+    // 転送を止められない場合は今回の画面更新を見送る 描画範囲は次回に持ち越す
+    if (ssd1306_WaitTx() != 0) {
+        SSD1306_FrameBytes = 0;
+        return;
+    }
+
+    const uint8_t forceFull = SSD1306_ForceFull;
+    SSD1306_ForceFull = 0;
+    uint8_t pageFirst = 0xFF, pageLast = 0; // 転送するページ範囲
+    uint8_t colFirst = 0xFF, colLast = 0;   // 転送する列範囲
+    for (i = 0; i < SSD1306_HEIGHT / 8; i++) {
+        int16_t first = SSD1306_DirtyMin[i];
+        int16_t last = SSD1306_DirtyMax[i];
+        SSD1306_DirtyMin[i] = 0xFF;
+        SSD1306_DirtyMax[i] = 0;
+        if (forceFull) {
+            first = 0;
+            last = SSD1306_WIDTH - 1;
+        }
+        else {
+            // 描画範囲内で転送済の内容と異なる最初と最後の列を探す
+            uint8_t const* buf = &SSD1306_Buffer[SSD1306_WIDTH * i];
+            uint8_t const* shadow = &SSD1306_Shadow[SSD1306_WIDTH * i];
+            while (first <= last && buf[first] == shadow[first]) {
+                first++;
+            }
+            while (last >= first && buf[last] == shadow[last]) {
+                last--;
+            }
+        }
+        if (first > last) {
+            continue; // 変化なし
+        }
+        if (pageFirst == 0xFF)
+            pageFirst = i;
+        pageLast = i;
+        if (first < colFirst)
+            colFirst = first;
+        if (last > colLast)
+            colLast = last;
+    }
+
+    SSD1306_FrameBytes = 0;
+    if (pageFirst == 0xFF) {
+        return; // 変化なし
+    }
+
+    // 矩形範囲を水平アドレッシングの順（ページごとに列方向）に詰める
+    const uint16_t width = colLast - colFirst + 1;
+    uint16_t len = 0;
+    for (i = pageFirst; i <= pageLast; i++) {
+        uint8_t const* buf = &SSD1306_Buffer[SSD1306_WIDTH * i + colFirst];
+        memcpy(&SSD1306_TxBuffer[len], buf, width);
+        memcpy(&SSD1306_Shadow[SSD1306_WIDTH * i + colFirst], buf, width);
+        len += width;
+    }
+    SSD1306_TxLength = len;
+
+    SSD1306_TxCommand[0] = 0x21; // Set column address
+    SSD1306_TxCommand[1] = colFirst;
+    SSD1306_TxCommand[2] = colLast;
+    SSD1306_TxCommand[3] = 0x22; // Set page address
+    SSD1306_TxCommand[4] = pageFirst;
+    SSD1306_TxCommand[5] = pageLast;
+    SSD1306_FrameBytes = (1 + 6) + (1 + len); // コントロールバイト + コマンド、コントロールバイト + データ
+
+    SSD1306_TxState = SSD1306_TX_COMMAND;
+    if (ssd1306_Transmit(0x00, SSD1306_TxCommand, 6) != 0) {
+        SSD1306_ForceFull = 1;
+        SSD1306_TxState = SSD1306_TX_IDLE;
+    }
+}
 
-        HAL_I2C_Mem_Write(hi2c, SSD1306_I2C_ADDR, 0x40, 1, &SSD1306_Buffer[SSD1306_WIDTH * i], SSD1306_WIDTH, 100);
+//  転送完了時に送信先から呼ぶ コマンド送信後はデータを送信する
+void ssd1306_TxCpltCallback(void) {
+    if (SSD1306_TxState == SSD1306_TX_COMMAND) {
+        SSD1306_TxState = SSD1306_TX_DATA;
+        if (ssd1306_Transmit(0x40, SSD1306_TxBuffer, SSD1306_TxLength) == 0) {
+            return;
+        }
+        SSD1306_ForceFull = 1;
     }
+    SSD1306_TxState = SSD1306_TX_IDLE;
 }
 
+//  転送エラー時に送信先から呼ぶ 次回は全体を転送する
+void ssd1306_TxErrorCallback(void) {
+    SSD1306_ForceFull = 1;
+    SSD1306_TxState = SSD1306_TX_IDLE;
+}
+
+//  前回の画面更新で転送したバイト数
+uint32_t ssd1306_GetFrameBytes(void) { return SSD1306_FrameBytes; }
+
+#ifdef SSD1306_HOST
+//  描画バッファ ページ順 SSD1306_WIDTH * SSD1306_HEIGHT / 8 バイト
+uint8_t const* ssd1306_GetBuffer(void) { return SSD1306_Buffer; }
+
+//  描画処理で書き換えたピクセル数
+uint32_t ssd1306_GetPixelOps(void) { return SSD1306_PixelOps; }
+
+//  描画処理で書き換えたピクセル数をリセット
+void ssd1306_ResetPixelOps(void) { SSD1306_PixelOps = 0; }
+#endif // SSD1306_HOST
+
 //  Draw one pixel in the screenbuffer
 //  X => X Coordinate
 //  Y => Y Coordinate
@@ -115,6 +282,9 @@ void ssd1306_DrawPixel(uint8_t x, uint8_t y, SSD1306_COLOR color) {
         color = (SSD1306_COLOR)!color;
     }
 
+    ssd1306_MarkDirty(y / 8, x, x);
+    SSD1306_COUNT_PIXELS(1);
+
     // Draw in the correct color
     if (color == White) {
         SSD1306_Buffer[x + (y / 8) * SSD1306_WIDTH] |= 1 << (y % 8);
@@ -128,29 +298,55 @@ void ssd1306_DrawPixel(uint8_t x, uint8_t y, SSD1306_COLOR color) {
 //  ch      => Character to write
 //  Font    => Font to use
 //  color   => Black or White
+//  フォントの1列分を縦に並べ、ページ単位でマスクを掛けて書き込む
 char ssd1306_WriteChar(char ch, FontDef Font, SSD1306_COLOR color) {
-    uint32_t i, b, j;
+    uint32_t i, j;
 
-    /*
-    // Check remaining space on current line
-    if (SSD1306_WIDTH <= (SSD1306.CurrentX + Font.FontWidth) ||
-        SSD1306_HEIGHT <= (SSD1306.CurrentY + Font.FontHeight))
-    {
-        // Not enough space on current line
-        return 0;
+    // Check if pixel should be inverted
+    if (SSD1306.Inverted) {
+        color = (SSD1306_COLOR)!color;
     }
-    */
 
-    // Translate font to screenbuffer
-    for (i = 0; i < Font.FontHeight; i++) {
-        b = Font.data[(ch - 32) * Font.FontHeight + i];
+    const uint16_t* glyph = &Font.data[(ch - 32) * Font.FontHeight];
+    const uint32_t heightMask = (Font.FontHeight >= 32) ? 0xFFFFFFFF : ((1UL << Font.FontHeight) - 1);
+    const uint32_t y = SSD1306.CurrentY;
+    const uint32_t pageFirst = y / 8;
+    const uint32_t pageLast = (y + Font.FontHeight - 1) / 8;
+
+    if (y < SSD1306_HEIGHT) {
+        uint32_t xFirst = SSD1306_WIDTH, xLast = 0;
         for (j = 0; j < Font.FontWidth; j++) {
-            if ((b << j) & 0x8000) {
-                ssd1306_DrawPixel(SSD1306.CurrentX + j, (SSD1306.CurrentY + i), (SSD1306_COLOR)color);
+            const uint32_t x = SSD1306.CurrentX + j;
+            if (x >= SSD1306_WIDTH) {
+                continue; // Don't write outside the buffer
             }
-            else {
-                ssd1306_DrawPixel(SSD1306.CurrentX + j, (SSD1306.CurrentY + i), (SSD1306_COLOR)!color);
+
+            // 1列分のビット 上の行から順にビット0, 1, 2...
+            uint32_t col = 0;
+            for (i = 0; i < Font.FontHeight; i++) {
+                if ((glyph[i] << j) & 0x8000) {
+                    col |= 1UL << i;
+                }
             }
+            if (color == Black) {
+                col = ~col & heightMask;
+            }
+
+            uint64_t bits = (uint64_t)col << (y % 8);
+            uint64_t mask = (uint64_t)heightMask << (y % 8);
+            for (uint32_t page = pageFirst; page <= pageLast && page < SSD1306_HEIGHT / 8; page++) {
+                uint8_t* buf = &SSD1306_Buffer[x + page * SSD1306_WIDTH];
+                *buf = (*buf & ~(uint8_t)mask) | ((uint8_t)bits & (uint8_t)mask);
+                bits >>= 8;
+                mask >>= 8;
+            }
+            SSD1306_COUNT_PIXELS(Font.FontHeight);
+            if (x < xFirst)
+                xFirst = x;
+            xLast = x;
+        }
+        for (uint32_t page = pageFirst; xFirst <= xLast && page <= pageLast && page < SSD1306_HEIGHT / 8; page++) {
+            ssd1306_MarkDirty(page, xFirst, xLast);
         }
     }
 
@@ -201,9 +397,79 @@ void ssd1306_R_xyWriteStrWT(uint8_t x, uint8_t y, char const* str, FontDef Font)
     ssd1306_WriteString(str, Font, White);
 }
 
+//  矩形範囲のビット操作 共通処理 画面外ははみ出した部分のみ無視する
+//  op: 0 消去, 1 描画, 2 反転
+static void ssd1306_RectOp(int16_t x, int16_t y, int16_t w, int16_t h, uint8_t op) {
+    int16_t x1 = x + w - 1;
+    int16_t y1 = y + h - 1;
+    if (x < 0)
+        x = 0;
+    if (y < 0)
+        y = 0;
+    if (x1 >= SSD1306_WIDTH)
+        x1 = SSD1306_WIDTH - 1;
+    if (y1 >= SSD1306_HEIGHT)
+        y1 = SSD1306_HEIGHT - 1;
+    if (x > x1 || y > y1)
+        return;
+    SSD1306_COUNT_PIXELS((x1 - x + 1) * (y1 - y + 1));
+
+    for (int16_t page = y / 8; page <= y1 / 8; page++) {
+        // ページ内で対象となる行のマスク
+        uint8_t mask = 0xFF;
+        if (page == y / 8)
+            mask &= 0xFF << (y % 8);
+        if (page == y1 / 8)
+            mask &= 0xFF >> (7 - y1 % 8);
+
+        uint8_t* buf = &SSD1306_Buffer[page * SSD1306_WIDTH];
+        int16_t i;
+        if (op == 0) {
+            for (i = x; i <= x1; i++)
+                buf[i] &= ~mask;
+        }
+        else if (op == 1) {
+            for (i = x; i <= x1; i++)
+                buf[i] |= mask;
+        }
+        else {
+            for (i = x; i <= x1; i++)
+                buf[i] ^= mask;
+        }
+        ssd1306_MarkDirty(page, x, x1);
+    }
+}
+
+//  塗りつぶした四角形を描画
+void ssd1306_FillRect(int16_t x, int16_t y, int16_t w, int16_t h, SSD1306_COLOR color) {
+    if (SSD1306.Inverted) {
+        color = (SSD1306_COLOR)!color;
+    }
+    ssd1306_RectOp(x, y, w, h, (color == White) ? 1 : 0);
+}
+
+//  四角形範囲の色反転
+void ssd1306_InvertRect(int16_t x, int16_t y, int16_t w, int16_t h) { ssd1306_RectOp(x, y, w, h, 2); }
+
+//  水平線を描画
+void ssd1306_DrawHLine(int16_t x, int16_t y, int16_t w, SSD1306_COLOR color) { ssd1306_FillRect(x, y, w, 1, color); }
+
+//  垂直線を描画
+void ssd1306_DrawVLine(int16_t x, int16_t y, int16_t h, SSD1306_COLOR color) { ssd1306_FillRect(x, y, 1, h, color); }
+
+//  四角形の枠を描画
+void ssd1306_DrawRect(int16_t x, int16_t y, int16_t w, int16_t h, SSD1306_COLOR color) {
+    ssd1306_DrawHLine(x, y, w, color);
+    ssd1306_DrawHLine(x, y + h - 1, w, color);
+    ssd1306_DrawVLine(x, y, h, color);
+    ssd1306_DrawVLine(x + w - 1, y, h, color);
+}
+
 //  色反転
 void ssd1306_InvertPixel(uint8_t x, uint8_t y) {
     if (x >= SSD1306_WIDTH || y >= SSD1306_HEIGHT)
         return;
+    ssd1306_MarkDirty(y / 8, x, x);
+    SSD1306_COUNT_PIXELS(1);
     SSD1306_Buffer[x + (y / 8) * SSD1306_WIDTH] ^= (1 << (y % 8));
 }
@@ -5,13 +5,17 @@
  * 変更点
  * ・文字を描画するスペースがなくても無理やり描画
  * ・xyWriteStrWT関数追加
+ * ・画面更新時は前回転送した内容と異なる範囲のみ転送
+ * ・水平アドレッシングモードで、変更範囲を1回のDMA転送で送信 転送完了は待たない
+ * ・文字・四角形・線はページ単位（8行）でまとめて描画
+ * ・送信先をバックエンドとして分離 I2C接続の画面 ssd1306_i2c.cpp、ホストのメモリ上の画面 ssd1306_host.cpp
  *
  */
 
 #pragma once
 
 #include "fonts.h"
-#include "stm32f7xx_hal.h"
+#include <stdint.h>
 
 // I2c address
 #ifndef SSD1306_I2C_ADDR
@@ -42,10 +46,28 @@ typedef struct {
     uint8_t Initialized;
 } SSD1306_t;
 
+//  送信先（バックエンド） 各関数の戻り値 0:成功
+typedef struct {
+    // 各関数の第1引数に渡す
+    void* Context;
+    // 画面の起動待ち等
+    uint8_t (*Init)(void* context);
+    // 送信 完了まで待つ 初期化時に使用
+    uint8_t (*Write)(void* context, uint8_t control, uint8_t const* data, uint16_t size);
+    // 送信開始 完了は待たない 完了時に ssd1306_TxCpltCallback、エラー時に ssd1306_TxErrorCallback を呼ぶこと
+    uint8_t (*Transmit)(void* context, uint8_t control, uint8_t* data, uint16_t size);
+    // 上記コールバックが呼ばれるまで待つ 1:タイムアウト
+    uint8_t (*Wait)(void* context);
+    // 送信中止 タイムアウト時に使用 0で戻った後は送信中のバッファを書き換えてよく、コールバックも呼ばないこと
+    uint8_t (*Abort)(void* context);
+} SSD1306_Backend;
+
 //  Function definitions
 
-uint8_t ssd1306_Init(I2C_HandleTypeDef* hi2c);
-void ssd1306_UpdateScreen(I2C_HandleTypeDef* hi2c);
+uint8_t ssd1306_Init(SSD1306_Backend const* backend);
+void ssd1306_UpdateScreen(void);
+void ssd1306_TxCpltCallback(void);
+void ssd1306_TxErrorCallback(void);
 void ssd1306_Fill(SSD1306_COLOR color);
 void ssd1306_DrawPixel(uint8_t x, uint8_t y, SSD1306_COLOR color);
 char ssd1306_WriteChar(char ch, FontDef Font, SSD1306_COLOR color);
@@ -55,3 +77,26 @@ void ssd1306_InvertColors(void);
 void ssd1306_xyWriteStrWT(uint8_t x, uint8_t y, char const* str, FontDef Font);
 void ssd1306_R_xyWriteStrWT(uint8_t x, uint8_t y, char const* str, FontDef Font);
 void ssd1306_InvertPixel(uint8_t x, uint8_t y);
+void ssd1306_FillRect(int16_t x, int16_t y, int16_t w, int16_t h, SSD1306_COLOR color);
+void ssd1306_InvertRect(int16_t x, int16_t y, int16_t w, int16_t h);
+void ssd1306_DrawHLine(int16_t x, int16_t y, int16_t w, SSD1306_COLOR color);
+void ssd1306_DrawVLine(int16_t x, int16_t y, int16_t h, SSD1306_COLOR color);
+void ssd1306_DrawRect(int16_t x, int16_t y, int16_t w, int16_t h, SSD1306_COLOR color);
+uint32_t ssd1306_GetFrameBytes(void);
+
+#ifdef SSD1306_HOST
+// ホスト（PC）でのテスト用 描画バッファ・描画負荷の確認
+uint8_t const* ssd1306_GetBuffer(void);
+uint32_t ssd1306_GetPixelOps(void);
+void ssd1306_ResetPixelOps(void);
+
+// ホスト（PC）でのテスト用 メモリ上の画面 ssd1306_host.cpp
+SSD1306_Backend const* ssd1306_HostBackend(void);
+uint8_t const* ssd1306_HostRam(void);
+uint32_t ssd1306_HostBytes(void);
+uint32_t ssd1306_HostWrites(void);
+void ssd1306_HostReset(void);
+void ssd1306_HostClearRam(uint8_t value);
+uint8_t ssd1306_HostSavePbm(char const* path);
+uint8_t ssd1306_HostSavePng(char const* path);
+#endif // SSD1306_HOST
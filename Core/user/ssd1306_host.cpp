@@ -0,0 +1,289 @@
+/**
+ * SSD1306 送信先 ホスト（PC）でのテスト用 メモリ上の画面
+ * SSD1306_HOST を定義してビルドした場合のみ有効
+ *
+ * I2Cの代わりに送信内容を受け取り、コマンドを解釈して画面メモリ(GDDRAM)を再現する
+ * 送信バイト数（スレーブアドレスを含む I2C上のバイト数）と送信回数を記録する
+ * 画面メモリの内容はPBM・PNG画像として保存できる
+ *
+ * 使用例
+ *   ssd1306_Init(ssd1306_HostBackend());
+ *   （描画）
+ *   ssd1306_UpdateScreen();
+ *   ssd1306_HostSavePng("frame.png");
+ */
+
+#ifdef SSD1306_HOST
+
+#include "ssd1306.hpp"
+#include <stdio.h>  // fopen
+#include <string.h> // memset
+
+// 再現した画面メモリ
+static uint8_t HostRam[SSD1306_HEIGHT / 8][SSD1306_WIDTH];
+
+// アドレッシング
+static uint8_t HostMode = 0x02; // 0x00:水平 0x01:垂直 0x02:ページ
+static uint8_t HostColStart = 0, HostColEnd = SSD1306_WIDTH - 1;
+static uint8_t HostPageStart = 0, HostPageEnd = SSD1306_HEIGHT / 8 - 1;
+static uint8_t HostCol = 0, HostPage = 0;
+
+// 引数を待っているコマンド
+static uint8_t HostCommand = 0;
+static uint8_t HostArgCount = 0;
+
+// 記録
+static uint32_t HostBytes = 0;
+static uint32_t HostWrites = 0;
+
+// 転送完了通知が未処理 DMA転送の代わりに host_Wait で完了させる
+static uint8_t HostPending = 0;
+
+//  引数の数
+static uint8_t host_ArgNum(uint8_t command) {
+    switch (command) {
+    case 0x20:
+    case 0x81:
+    case 0x8D:
+    case 0xA8:
+    case 0xD3:
+    case 0xD5:
+    case 0xD9:
+    case 0xDA:
+    case 0xDB:
+        return 1;
+    case 0x21:
+    case 0x22:
+        return 2;
+    default:
+        return 0;
+    }
+}
+
+//  コマンド1バイトを解釈
+static void host_Command(uint8_t c) {
+    if (HostArgCount < host_ArgNum(HostCommand)) {
+        // 引数
+        if (HostCommand == 0x20) {
+            HostMode = c & 0x03;
+        }
+        else if (HostCommand == 0x21) {
+            if (HostArgCount == 0)
+                HostColStart = HostCol = c & 0x7F;
+            else
+                HostColEnd = c & 0x7F;
+        }
+        else if (HostCommand == 0x22) {
+            if (HostArgCount == 0)
+                HostPageStart = HostPage = c & 0x07;
+            else
+                HostPageEnd = c & 0x07;
+        }
+        HostArgCount++;
+        return;
+    }
+
+    HostCommand = c;
+    HostArgCount = 0;
+    if (c <= 0x0F) {
+        HostCol = (HostCol & 0xF0) | c; // ページアドレッシング 開始列 下位4ビット
+    }
+    else if (c <= 0x1F) {
+        HostCol = (HostCol & 0x0F) | ((c & 0x0F) << 4); // ページアドレッシング 開始列 上位4ビット
+    }
+    else if ((c & 0xF8) == 0xB0) {
+        HostPage = c & 0x07; // ページアドレッシング ページ
+    }
+}
+
+//  データ1バイトを書込み、アドレスを進める
+static void host_Data(uint8_t d) {
+    HostRam[HostPage][HostCol] = d;
+    if (HostMode == 0x02) {
+        HostCol = (HostCol + 1) % SSD1306_WIDTH;
+        return;
+    }
+    if (HostMode == 0x00) {
+        if (HostCol < HostColEnd) {
+            HostCol++;
+            return;
+        }
+        HostCol = HostColStart;
+        HostPage = (HostPage < HostPageEnd) ? HostPage + 1 : HostPageStart;
+    }
+    else {
+        if (HostPage < HostPageEnd) {
+            HostPage++;
+            return;
+        }
+        HostPage = HostPageStart;
+        HostCol = (HostCol < HostColEnd) ? HostCol + 1 : HostColStart;
+    }
+}
+
+//  I2C送信の代わり 0x00:コマンド 0x40:データ
+static uint8_t host_Write(void* context, uint8_t control, uint8_t const* data, uint16_t size) {
+    HostBytes += 2 + size; // スレーブアドレス + コントロールバイト + データ
+    HostWrites++;
+    for (uint16_t i = 0; i < size; i++) {
+        if (control == 0x40)
+            host_Data(data[i]);
+        else
+            host_Command(data[i]);
+    }
+    return 0;
+}
+
+//  DMA転送の代わり 内容はすぐに反映し、完了通知は host_Wait で行う
+//  転送中に次の画面を描画する流れを実機と同じにするため
+static uint8_t host_Transmit(void* context, uint8_t control, uint8_t* data, uint16_t size) {
+    HostPending = 1;
+    return host_Write(context, control, data, size);
+}
+
+static uint8_t host_Init(void* context) { return 0; }
+
+static uint8_t host_Wait(void* context) {
+    if (!HostPending) {
+        return 1; // 転送していない
+    }
+    HostPending = 0;
+    ssd1306_TxCpltCallback();
+    return 0;
+}
+
+//  転送中止 内容は送信時に反映済のため、完了通知を取り消すのみ
+static uint8_t host_Abort(void* context) {
+    HostPending = 0;
+    return 0;
+}
+
+//  メモリ上の画面を送信先として取得
+SSD1306_Backend const* ssd1306_HostBackend(void) {
+    static const SSD1306_Backend backend = { NULL, host_Init, host_Write, host_Transmit, host_Wait, host_Abort };
+    HostPending = 0;
+    return &backend;
+}
+
+//  再現した画面メモリ ページ順 SSD1306_WIDTH * SSD1306_HEIGHT / 8 バイト
+uint8_t const* ssd1306_HostRam(void) { return &HostRam[0][0]; }
+
+//  送信バイト数
+uint32_t ssd1306_HostBytes(void) { return HostBytes; }
+
+//  送信回数
+uint32_t ssd1306_HostWrites(void) { return HostWrites; }
+
+//  記録をリセット
+void ssd1306_HostReset(void) {
+    HostBytes = 0;
+    HostWrites = 0;
+}
+
+//  画面メモリを消去（電源投入時の状態を再現する場合等）
+void ssd1306_HostClearRam(uint8_t value) { memset(HostRam, value, sizeof(HostRam)); }
+
+//  座標(x, y)の点灯状態
+static uint8_t host_Pixel(uint32_t x, uint32_t y) { return (HostRam[y / 8][x] >> (y % 8)) & 1; }
+
+//  PBM(P4 2値)で保存 点灯:白 0:成功
+uint8_t ssd1306_HostSavePbm(char const* path) {
+    FILE* fp = fopen(path, "wb");
+    if (!fp) {
+        return 1;
+    }
+    fprintf(fp, "P4\n%d %d\n", SSD1306_WIDTH, SSD1306_HEIGHT);
+    for (uint32_t y = 0; y < SSD1306_HEIGHT; y++) {
+        uint8_t row[(SSD1306_WIDTH + 7) / 8] = {};
+        for (uint32_t x = 0; x < SSD1306_WIDTH; x++) {
+            row[x / 8] |= (host_Pixel(x, y) ^ 1) << (7 - x % 8); // PBMは1:黒
+        }
+        fwrite(row, 1, sizeof(row), fp);
+    }
+    return fclose(fp) == 0 ? 0 : 1;
+}
+
+//  PNG用 CRC-32
+static uint32_t host_Crc32(uint32_t crc, uint8_t const* data, uint32_t size) {
+    crc = ~crc;
+    for (uint32_t i = 0; i < size; i++) {
+        crc ^= data[i];
+        for (uint32_t k = 0; k < 8; k++) {
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+//  PNG用 ビッグエンディアン32ビット
+static void host_Put32(uint8_t* p, uint32_t x) {
+    p[0] = x >> 24;
+    p[1] = x >> 16;
+    p[2] = x >> 8;
+    p[3] = x;
+}
+
+//  PNGのチャンクを書き出す
+static void host_PngChunk(FILE* fp, char const* type, uint8_t const* data, uint32_t size) {
+    uint8_t head[8];
+    host_Put32(head, size);
+    memcpy(&head[4], type, 4);
+    uint32_t crc = host_Crc32(host_Crc32(0, &head[4], 4), data, size);
+    uint8_t tail[4];
+    host_Put32(tail, crc);
+    fwrite(head, 1, 8, fp);
+    if (size > 0) {
+        fwrite(data, 1, size, fp); // IEND はデータなし
+    }
+    fwrite(tail, 1, 4, fp);
+}
+
+//  PNG(1ビット グレースケール 非圧縮)で保存 点灯:白 0:成功
+uint8_t ssd1306_HostSavePng(char const* path) {
+    static const uint32_t ROW = 1 + (SSD1306_WIDTH + 7) / 8; // フィルタ種類 + 1行分のデータ
+    static const uint32_t RAW = ROW * SSD1306_HEIGHT;
+
+    FILE* fp = fopen(path, "wb");
+    if (!fp) {
+        return 1;
+    }
+    static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    fwrite(signature, 1, sizeof(signature), fp);
+
+    uint8_t ihdr[13] = {};
+    host_Put32(&ihdr[0], SSD1306_WIDTH);
+    host_Put32(&ihdr[4], SSD1306_HEIGHT);
+    ihdr[8] = 1; // ビット深度
+    ihdr[9] = 0; // グレースケール
+    host_PngChunk(fp, "IHDR", ihdr, sizeof(ihdr));
+
+    // zlibヘッダ + 非圧縮ブロック1つ + Adler-32
+    uint8_t idat[2 + 5 + RAW + 4] = {};
+    idat[0] = 0x78;
+    idat[1] = 0x01;
+    idat[2] = 0x01; // 最終ブロック 非圧縮
+    idat[3] = RAW & 0xFF;
+    idat[4] = RAW >> 8;
+    idat[5] = ~RAW & 0xFF;
+    idat[6] = (~RAW >> 8) & 0xFF;
+    uint8_t* raw = &idat[7];
+    for (uint32_t y = 0; y < SSD1306_HEIGHT; y++) {
+        uint8_t* row = &raw[ROW * y];
+        row[0] = 0; // フィルタなし
+        for (uint32_t x = 0; x < SSD1306_WIDTH; x++) {
+            row[1 + x / 8] |= host_Pixel(x, y) << (7 - x % 8);
+        }
+    }
+    uint32_t a = 1, b = 0;
+    for (uint32_t i = 0; i < RAW; i++) {
+        a = (a + raw[i]) % 65521;
+        b = (b + a) % 65521;
+    }
+    host_Put32(&raw[RAW], (b << 16) | a);
+    host_PngChunk(fp, "IDAT", idat, sizeof(idat));
+    host_PngChunk(fp, "IEND", NULL, 0);
+
+    return fclose(fp) == 0 ? 0 : 1;
+}
+
+#endif // SSD1306_HOST
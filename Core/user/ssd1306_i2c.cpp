@@ -0,0 +1,82 @@
+#include "ssd1306_i2c.hpp"
+#include "cmsis_os.h"
+
+// 送信に使うI2C
+static I2C_HandleTypeDef* I2cHandle = NULL;
+
+// 転送完了を待つタスク 完了時にシグナルを送る 初期化したタスク（画面表示タスク）とする
+static osThreadId I2cWaitThread = NULL;
+static const int32_t I2C_TX_SIGNAL = 0x02;
+
+// 転送完了待ち時間 ミリ秒
+static const uint32_t I2C_TX_TIMEOUT = 100;
+
+//  画面の起動を待つ
+//  完了通知先は最初の転送より前に決めておく 転送開始（i2c_Transmit）は割込みからも呼ぶため、そこでは取得しない
+static uint8_t i2c_Init(void* context) {
+    I2cWaitThread = osThreadGetId();
+    osDelay(100);
+    return 0;
+}
+
+//  完了まで待って送信
+static uint8_t i2c_Write(void* context, uint8_t control, uint8_t const* data, uint16_t size) {
+    I2C_HandleTypeDef* hi2c = (I2C_HandleTypeDef*)context;
+    return HAL_I2C_Mem_Write(hi2c, SSD1306_I2C_ADDR, control, 1, (uint8_t*)data, size, 10);
+}
+
+//  DMA転送開始 完了時は ssd1306_I2cTxCpltCallback が呼ばれる
+static uint8_t i2c_Transmit(void* context, uint8_t control, uint8_t* data, uint16_t size) {
+    I2C_HandleTypeDef* hi2c = (I2C_HandleTypeDef*)context;
+    SCB_CleanDCache_by_Addr((uint32_t*)data, (size + 31) & ~31); // DMAが読むメモリへ書き戻す
+    return HAL_I2C_Mem_Write_DMA(hi2c, SSD1306_I2C_ADDR, control, 1, data, size);
+}
+
+//  転送完了を待つ 待つ間はタスクを休止する
+static uint8_t i2c_Wait(void* context) {
+    return (osSignalWait(I2C_TX_SIGNAL, I2C_TX_TIMEOUT).status == osEventTimeout) ? 1 : 0;
+}
+
+//  転送中止 DMAを止めてからI2Cを初期化し直す
+//  HAL_I2C_Master_Abort_IT はメモリ書込（Mem_Write_DMA）の転送には使えず、完了も待たないため使わない
+static uint8_t i2c_Abort(void* context) {
+    I2C_HandleTypeDef* hi2c = (I2C_HandleTypeDef*)context;
+    if (hi2c->hdmatx && hi2c->hdmatx->State == HAL_DMA_STATE_BUSY && HAL_DMA_Abort(hi2c->hdmatx) != HAL_OK) {
+        return 1; // DMAが止まらない
+    }
+    // 途中で止めたI2Cの状態を戻す 割込み・DMAの設定も初期化し直す
+    if (HAL_I2C_DeInit(hi2c) != HAL_OK || HAL_I2C_Init(hi2c) != HAL_OK) {
+        return 1;
+    }
+    return 0;
+}
+
+//  I2C接続の画面を送信先として取得
+SSD1306_Backend const* ssd1306_I2cBackend(I2C_HandleTypeDef* hi2c) {
+    static SSD1306_Backend backend = { NULL, i2c_Init, i2c_Write, i2c_Transmit, i2c_Wait, i2c_Abort };
+    I2cHandle = hi2c;
+    backend.Context = hi2c;
+    return &backend;
+}
+
+//  HAL_I2C_MemTxCpltCallback から呼ぶ
+void ssd1306_I2cTxCpltCallback(I2C_HandleTypeDef* hi2c) {
+    if (hi2c != I2cHandle) {
+        return;
+    }
+    ssd1306_TxCpltCallback();
+    if (I2cWaitThread) {
+        osSignalSet(I2cWaitThread, I2C_TX_SIGNAL);
+    }
+}
+
+//  HAL_I2C_ErrorCallback から呼ぶ
+void ssd1306_I2cTxErrorCallback(I2C_HandleTypeDef* hi2c) {
+    if (hi2c != I2cHandle) {
+        return;
+    }
+    ssd1306_TxErrorCallback();
+    if (I2cWaitThread) {
+        osSignalSet(I2cWaitThread, I2C_TX_SIGNAL);
+    }
+}
@@ -0,0 +1,13 @@
+/**
+ * SSD1306 送信先 I2C接続の画面
+ * 初期化コマンドは完了まで待って送信し、画面データはDMAで送信する
+ */
+
+#pragma once
+
+#include "ssd1306.hpp"
+#include "stm32f7xx_hal.h"
+
+SSD1306_Backend const* ssd1306_I2cBackend(I2C_HandleTypeDef* hi2c);
+void ssd1306_I2cTxCpltCallback(I2C_HandleTypeDef* hi2c);
+void ssd1306_I2cTxErrorCallback(I2C_HandleTypeDef* hi2c);
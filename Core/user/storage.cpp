@@ -0,0 +1,131 @@
+#include "storage.hpp"
+#include <string.h> // memcpy, memcmp
+
+namespace {
+/// レコードヘッダの識別値
+constexpr uint32_t MAGIC = 0xA5;
+/// コンパクション用 最新のレコードを集めるバッファ
+uint32_t s_compactBuf[storage::log::KEY_MAX * (4 + storage::log::DATA_MAX + 4) / 4];
+
+/// @brief CRC-32 (IEEE 802.3)
+uint32_t crc32(uint8_t const* data, uint32_t size) {
+    uint32_t crc = 0xFFFFFFFF;
+    for (uint32_t i = 0; i < size; i++) {
+        crc ^= data[i];
+        for (uint32_t k = 0; k < 8; k++)
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+    }
+    return ~crc;
+}
+
+/// @brief データバイト数を4バイト単位に切り上げ
+inline uint32_t align4(uint32_t size) { return (size + 3) & ~3u; }
+} // namespace
+
+uint32_t storage::log::recordSize(uint32_t header) const {
+    const uint32_t key = (header >> 8) & 0xFF;
+    const uint32_t size = header >> 16;
+    if ((header & 0xFF) != MAGIC || key >= KEY_MAX || size > DATA_MAX)
+        return 0;
+    return recordBytes(size);
+}
+
+bool storage::log::valid(uint32_t pos) const {
+    uint8_t const* p = flash_->mem + pos;
+    const uint32_t body = 4 + align4(*reinterpret_cast<uint32_t const*>(p) >> 16); // ヘッダ + データ
+    return crc32(p, body) == *reinterpret_cast<uint32_t const*>(p + body);
+}
+
+storage::log::STATUS storage::log::init(flash const& f) {
+    flash_ = &f;
+    for (uint32_t k = 0; k < KEY_MAX; k++)
+        latest_[k] = NONE;
+
+    uint32_t pos = 0;
+    while (pos + 4 <= f.size) {
+        const uint32_t header = *reinterpret_cast<uint32_t const*>(f.mem + pos);
+        if (header == 0xFFFFFFFF)
+            break; // 未書込領域
+        const uint32_t size = recordSize(header);
+        if (size == 0 || pos + size > f.size) {
+            end_ = f.size; // 壊れたヘッダ以降は使わず、次回の書込時にコンパクションする
+            return (pos == 0) ? UNKNOWN : OK;
+        }
+        if (valid(pos))
+            latest_[(header >> 8) & 0xFF] = pos; // 後のレコードほど新しい
+        pos += size;
+    }
+    end_ = pos;
+    return (pos == 0) ? EMPTY : OK;
+}
+
+bool storage::log::read(uint8_t key, void* data, uint32_t size) const {
+    if (key >= KEY_MAX || latest_[key] == NONE)
+        return false;
+    uint8_t const* p = flash_->mem + latest_[key];
+    if ((*reinterpret_cast<uint32_t const*>(p) >> 16) != size)
+        return false;
+    memcpy(data, p + 4, size);
+    return true;
+}
+
+bool storage::log::append(uint8_t key, void const* data, uint32_t size) {
+    uint32_t buf[RECORD_MAX / 4];
+    uint8_t* p = reinterpret_cast<uint8_t*>(buf);
+    const uint32_t body = 4 + align4(size);
+    buf[0] = MAGIC | key << 8 | size << 16;
+    memset(p + 4, 0xFF, align4(size));
+    memcpy(p + 4, data, size);
+    buf[body / 4] = crc32(p, body);
+
+    const uint32_t pos = end_;
+    end_ += body + 4; // 書込に失敗した場合もその範囲は使わない
+    if (!flash_->program(flash_->context, pos, buf, body / 4 + 1) || !valid(pos))
+        return false;
+    latest_[key] = pos;
+    return true;
+}
+
+bool storage::log::compact() {
+    // 最新のレコードをRAMへ集める
+    uint8_t* p = reinterpret_cast<uint8_t*>(s_compactBuf);
+    uint32_t size = 0;
+    uint32_t pos[KEY_MAX];
+    for (uint32_t k = 0; k < KEY_MAX; k++) {
+        pos[k] = NONE;
+        if (latest_[k] == NONE)
+            continue;
+        const uint32_t rec = recordSize(*reinterpret_cast<uint32_t const*>(flash_->mem + latest_[k]));
+        memcpy(p + size, flash_->mem + latest_[k], rec);
+        pos[k] = size;
+        size += rec;
+    }
+    // 消去して書き直す ※書き直し完了前に電源が切れた場合、保存データは失われる
+    eraseCount_++;
+    end_ = size;
+    for (uint32_t k = 0; k < KEY_MAX; k++)
+        latest_[k] = NONE;
+    if (!flash_->erase(flash_->context))
+        return false;
+    if (size > 0 && !flash_->program(flash_->context, 0, s_compactBuf, size / 4))
+        return false;
+    for (uint32_t k = 0; k < KEY_MAX; k++)
+        latest_[k] = (pos[k] != NONE && valid(pos[k])) ? pos[k] : NONE;
+    return true;
+}
+
+bool storage::log::write(uint8_t key, void const* data, uint32_t size) {
+    if (!flash_ || key >= KEY_MAX || size > DATA_MAX)
+        return false;
+    if (latest_[key] != NONE) {
+        uint8_t const* p = flash_->mem + latest_[key];
+        if ((*reinterpret_cast<uint32_t const*>(p) >> 16) == size && memcmp(p + 4, data, size) == 0)
+            return true; // 変更なし
+    }
+    const uint32_t rec = recordBytes(size);
+    if (end_ + rec > flash_->size && !compact())
+        return false;
+    if (end_ + rec > flash_->size)
+        return false; // コンパクションしても空きがない
+    return append(key, data, size);
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <stdint.h>
+
+/* プリセット保存 フラッシュ追記型ログ --------------------------------------------*/
+// 保存のたびにセクター全体を消去・再書込せず、内容が変わったデータだけをレコードとして空き領域へ追記する
+// 起動時にセクターを先頭から読み、キーごとに最新のレコードの位置を記録する
+// 空きがなくなった場合のみ、最新のレコードをRAMへ集めてセクターを消去し、書き直す（コンパクション）
+// ※F722RCはプログラム領域以外のセクターが1つのため、予備セクターへの移動は行わない
+//
+// レコード: ヘッダ 4バイト + データ（4バイト単位 余りは0xFF） + CRC-32 4バイト
+// ヘッダ:   MAGIC 8bit | キー 8bit | データバイト数 16bit
+// 書込途中で電源が切れたレコードはCRCが一致しないため、読込時に無視する
+
+namespace storage {
+struct flash;
+class log;
+
+/// @brief 内蔵フラッシュの1セクター storage_flash.cpp
+/// @param[in] sector セクター番号
+/// @param[in] addr セクター先頭アドレス
+/// @param[in] size セクターサイズ バイト
+flash const& sectorFlash(uint32_t sector, uint32_t addr, uint32_t size);
+
+#ifdef STORAGE_HOST
+/// ホスト（PC）でのテスト用 RAM上の模擬フラッシュ storage_host.cpp
+/// 消去・書込時間はSTM32F722のデータシート標準値で積算する
+struct hostStats {
+    uint32_t eraseCount;   ///< 消去回数（書換回数）
+    uint32_t programWords; ///< 書込ワード数
+    uint32_t busyUsec;     ///< 消去・書込の合計時間 マイクロ秒
+    uint32_t maxBusyUsec;  ///< 1回の消去・書込の最大時間 マイクロ秒
+};
+flash const& hostFlash(uint32_t size);
+hostStats const& hostGetStats();
+void hostResetStats();
+void hostCutAfter(uint32_t words); ///< 指定ワード数目の書込中に電源断を模擬し、以降を失敗させる 0: 解除
+#endif
+} // namespace storage
+
+/// @brief フラッシュ操作 実機: storage_flash.cpp ホスト（PC）でのテスト用: storage_host.cpp
+struct storage::flash {
+    uint8_t const* mem; ///< 読出用 セクター先頭アドレス
+    uint32_t size;      ///< セクターサイズ バイト
+    void* context;
+    bool (*erase)(void* context);                                                          ///< セクター消去
+    bool (*program)(void* context, uint32_t offset, uint32_t const* data, uint32_t words); ///< 32bit単位で書込
+};
+
+/// @brief 追記型ログ キーごとに最新のデータを保持する
+class storage::log {
+public:
+    static constexpr uint32_t KEY_MAX = 64;  ///< キーの数 キーは 0 ～ KEY_MAX-1
+    static constexpr uint32_t DATA_MAX = 48; ///< 1レコードのデータ最大バイト数
+
+    /// 読込結果
+    enum STATUS {
+        OK,      ///< レコードあり
+        EMPTY,   ///< 消去済
+        UNKNOWN, ///< 先頭がレコードではない（旧形式のデータ等） 次回の書込時に消去する
+    };
+
+private:
+    static constexpr uint32_t NONE = 0xFFFFFFFF;
+    static constexpr uint32_t RECORD_MAX = 4 + DATA_MAX + 4;
+
+    flash const* flash_ = nullptr;
+    uint32_t latest_[KEY_MAX]; // 各キーの最新レコードの位置 NONE: なし
+    uint32_t end_ = 0;         // 次のレコードの書込位置
+    uint32_t eraseCount_ = 0;  // コンパクション回数（起動後）
+
+    uint32_t recordSize(uint32_t header) const; // ヘッダが正しい場合レコード全体のバイト数 正しくない場合0
+    bool valid(uint32_t pos) const;             // posのレコードのCRCが一致するか
+    bool append(uint8_t key, void const* data, uint32_t size);
+
+public:
+    log() {}
+
+    /// @brief データ size バイトのレコード全体のバイト数
+    static constexpr uint32_t recordBytes(uint32_t size) { return 4 + ((size + 3) & ~3u) + 4; }
+
+    /// @brief セクターを読み、各キーの最新レコードを探す
+    STATUS init(flash const& f);
+    /// @brief 最新のデータを読み込む
+    /// @return 保存されていない、またはバイト数が違う場合false
+    bool read(uint8_t key, void* data, uint32_t size) const;
+    /// @brief データを追記する 最新のデータと同じ場合は書き込まない 空きがない場合はコンパクションを行う
+    /// @return 書込失敗時false
+    bool write(uint8_t key, void const* data, uint32_t size);
+    /// @brief コンパクション 最新のレコードのみ残してセクターを書き直す セクター消去を含む
+    /// @return 消去・書込失敗時false
+    bool compact();
+    /// @brief 使用済バイト数
+    uint32_t used() const { return end_; }
+    /// @brief 空きバイト数 書き込むレコードより少ない場合、次回の書込でコンパクションを行う
+    uint32_t remain() const { return flash_ ? flash_->size - end_ : 0; }
+    /// @brief コンパクション回数（起動後）
+    uint32_t eraseCount() const { return eraseCount_; }
+};
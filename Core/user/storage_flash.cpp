@@ -0,0 +1,71 @@
+/**
+ * プリセット保存 送信先 内蔵フラッシュ
+ * HALで1セクターを消去・書込する 書込は32bit単位
+ *
+ * 消去・書込中はフラッシュからの読出（命令・定数）が止まり、I2S割込みも待たされる
+ * 書込は1ワードずつ行い、PROGRAM_CHUNK_WORDS ワードごとに他のタスクへ切り替える
+ * 待たされる時間は1ワード分（標準16us）で、音声処理の1ブロック（約363us）に対して十分短い
+ * 消去（128KBで標準1s）は待ち時間が長いため、呼出側で出力をミュートすること
+ * タスクから呼ぶこと
+ */
+
+#include "storage.hpp"
+#include "cmsis_os.h"
+#include "stm32f7xx_hal.h"
+
+namespace {
+/// 続けて書き込むワード数
+constexpr uint32_t PROGRAM_CHUNK_WORDS = 4;
+
+/// 対象セクター
+struct sector {
+    uint32_t num;
+    uint32_t addr;
+    uint32_t size;
+};
+sector s_sector;
+storage::flash s_flash;
+
+/// @brief 書換範囲のDキャッシュを無効化 読出時に書換前の内容を使わないように
+void invalidate(uint32_t addr, uint32_t size) {
+    const uint32_t start = addr & ~31u;
+    SCB_InvalidateDCache_by_Addr(reinterpret_cast<uint32_t*>(start), (int32_t)((addr + size - start + 31) & ~31u));
+}
+
+bool flashErase(void* context) {
+    sector const* s = static_cast<sector const*>(context);
+    HAL_FLASH_Unlock(); // フラッシュ ロック解除
+    FLASH_EraseInitTypeDef erase = {};
+    erase.TypeErase = FLASH_TYPEERASE_SECTORS;
+    erase.Sector = s->num;
+    erase.NbSectors = 1;
+    erase.VoltageRange = FLASH_VOLTAGE_RANGE_3;
+    uint32_t error = 0;
+    const bool ok = HAL_FLASHEx_Erase(&erase, &error) == HAL_OK; // フラッシュ消去
+    HAL_FLASH_Lock();                                            // フラッシュ ロック
+    invalidate(s->addr, s->size);
+    return ok;
+}
+
+bool flashProgram(void* context, uint32_t offset, uint32_t const* data, uint32_t words) {
+    sector const* s = static_cast<sector const*>(context);
+    bool ok = true;
+    for (uint32_t i = 0; i < words && ok; i += PROGRAM_CHUNK_WORDS) {
+        if (i > 0)
+            osDelay(1); // 他のタスクへ
+        const uint32_t end = (i + PROGRAM_CHUNK_WORDS < words) ? i + PROGRAM_CHUNK_WORDS : words;
+        HAL_FLASH_Unlock(); // フラッシュ ロック解除
+        for (uint32_t k = i; k < end && ok; k++)
+            ok = HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, s->addr + offset + 4 * k, data[k]) == HAL_OK;
+        HAL_FLASH_Lock(); // フラッシュ ロック
+    }
+    invalidate(s->addr + offset, 4 * words);
+    return ok;
+}
+} // namespace
+
+storage::flash const& storage::sectorFlash(uint32_t sector, uint32_t addr, uint32_t size) {
+    s_sector = { sector, addr, size };
+    s_flash = { reinterpret_cast<uint8_t const*>(addr), size, &s_sector, flashErase, flashProgram };
+    return s_flash;
+}
@@ -0,0 +1,86 @@
+/**
+ * プリセット保存 送信先 ホスト（PC）でのテスト用 RAM上の模擬フラッシュ
+ * STORAGE_HOST を定義してビルドした場合のみ有効
+ *
+ * 消去は全バイト0xFF、書込は消去済のワードのみ可能（実機と同じ制約）
+ * 消去・書込の回数と時間を記録し、保存にかかる時間とセクターの書換回数を確認できる
+ *
+ * 使用例
+ *   storage::log log;
+ *   log.init(storage::hostFlash(128 * 1024));
+ *   log.write(0, data, sizeof(data));
+ *   printf("%u us\n", storage::hostGetStats().busyUsec);
+ */
+
+#ifdef STORAGE_HOST
+
+#include "storage.hpp"
+#include <stdlib.h> // malloc
+#include <string.h> // memset
+
+namespace {
+/// 128KBセクター消去時間 標準値 マイクロ秒
+constexpr uint32_t ERASE_USEC = 1000000;
+/// 32bit書込時間 標準値 マイクロ秒
+constexpr uint32_t PROGRAM_USEC = 16;
+
+uint8_t* s_mem = nullptr;
+storage::flash s_flash;
+storage::hostStats s_stats;
+uint32_t s_cutAfter = 0; // 電源断までの残りワード数 0: 模擬しない
+bool s_cut = false;      // 電源断済
+
+void busy(uint32_t usec) {
+    s_stats.busyUsec += usec;
+    if (usec > s_stats.maxBusyUsec)
+        s_stats.maxBusyUsec = usec;
+}
+
+bool hostErase(void* context) {
+    if (s_cut)
+        return false;
+    memset(s_mem, 0xFF, s_flash.size);
+    s_stats.eraseCount++;
+    busy(ERASE_USEC * (s_flash.size / 1024) / 128);
+    return true;
+}
+
+bool hostProgram(void* context, uint32_t offset, uint32_t const* data, uint32_t words) {
+    uint32_t* p = reinterpret_cast<uint32_t*>(s_mem + offset);
+    uint32_t done = 0;
+    for (; done < words; done++) {
+        if (s_cut || offset + 4 * (done + 1) > s_flash.size || p[done] != 0xFFFFFFFF)
+            break; // 電源断、範囲外、未消去
+        if (s_cutAfter && --s_cutAfter == 0) {
+            p[done] = data[done] | 0x0000FFFF; // 書込途中で電源断 一部のビットのみ書かれた状態
+            s_cut = true;
+            break;
+        }
+        p[done] = data[done];
+    }
+    s_stats.programWords += done;
+    busy(PROGRAM_USEC * done);
+    return done == words;
+}
+} // namespace
+
+storage::flash const& storage::hostFlash(uint32_t size) {
+    if (!s_mem || s_flash.size != size) {
+        free(s_mem);
+        s_mem = static_cast<uint8_t*>(malloc(size));
+        memset(s_mem, 0xFF, size);
+    }
+    s_flash = { s_mem, size, nullptr, hostErase, hostProgram };
+    return s_flash;
+}
+
+storage::hostStats const& storage::hostGetStats() { return s_stats; }
+
+void storage::hostResetStats() { s_stats = {}; }
+
+void storage::hostCutAfter(uint32_t words) {
+    s_cutAfter = words;
+    s_cut = false;
+}
+
+#endif // STORAGE_HOST
@@ -0,0 +1,149 @@
+#include "ui_screen.hpp"
+#include "common.h"
+#include "fx.h"
+#include "ui_widget.hpp"
+
+// 定数定義
+namespace {
+using ui::position;
+/// エフェクト名 ステータス 表示位置
+constexpr position POS_STATUS = { 4, 0 };
+/// エフェクトパラメータ ページ 表示位置
+constexpr position POS_PAGE = { 88, 0 };
+/// カーソル位置
+constexpr position POS_CURSOR[6] = { { 0, 11 }, { 0, 29 }, { 0, 47 }, { 65, 11 }, { 65, 29 }, { 65, 47 } };
+/// エフェクトパラメータ名表示位置
+constexpr position POS_PARAM_NAME[6] = { { 0, 17 }, { 0, 35 }, { 0, 53 }, { 65, 17 }, { 65, 35 }, { 65, 53 } };
+/// エフェクトパラメータ数値表示 右端の文字位置
+constexpr position POS_PARAM_VALUE[6] = { { 52, 11 }, { 52, 29 }, { 52, 47 }, { 117, 11 }, { 117, 29 }, { 117, 47 } };
+} // namespace
+
+// 画面表示ウィジェット 前回の表示内容を保持し、変化した部分のみ描き直す
+namespace {
+/// ステータス表示
+ui::label s_statusLabel(POS_STATUS.x, POS_STATUS.y, Font_7x10);
+/// エフェクトパラメータ名表示
+ui::label s_paramName[6] = { { POS_PARAM_NAME[0].x, POS_PARAM_NAME[0].y, Font_7x10 },
+    { POS_PARAM_NAME[1].x, POS_PARAM_NAME[1].y, Font_7x10 }, { POS_PARAM_NAME[2].x, POS_PARAM_NAME[2].y, Font_7x10 },
+    { POS_PARAM_NAME[3].x, POS_PARAM_NAME[3].y, Font_7x10 }, { POS_PARAM_NAME[4].x, POS_PARAM_NAME[4].y, Font_7x10 },
+    { POS_PARAM_NAME[5].x, POS_PARAM_NAME[5].y, Font_7x10 } };
+/// エフェクトパラメータ数値表示 文字列変換は各エフェクトで行う
+ui::number s_paramValue[6] = { { POS_PARAM_VALUE[0].x, POS_PARAM_VALUE[0].y, Font_11x18, ui::RIGHT },
+    { POS_PARAM_VALUE[1].x, POS_PARAM_VALUE[1].y, Font_11x18, ui::RIGHT },
+    { POS_PARAM_VALUE[2].x, POS_PARAM_VALUE[2].y, Font_11x18, ui::RIGHT },
+    { POS_PARAM_VALUE[3].x, POS_PARAM_VALUE[3].y, Font_11x18, ui::RIGHT },
+    { POS_PARAM_VALUE[4].x, POS_PARAM_VALUE[4].y, Font_11x18, ui::RIGHT },
+    { POS_PARAM_VALUE[5].x, POS_PARAM_VALUE[5].y, Font_11x18, ui::RIGHT } };
+/// エフェクトパラメータ ページ表示
+ui::number s_pageNumber(POS_PAGE.x, POS_PAGE.y, Font_7x10, ui::LEFT, "P");
+/// パラメータ選択カーソル
+ui::cursor s_cursor;
+/// 処理時間% 表示
+ui::number s_cpuPercent(ui::POS_PERCENT.x, ui::POS_PERCENT.y, Font_7x10, ui::LEFT, "", "%", 2);
+/// TAP画面 タイトル
+ui::label s_tapTitle(0, 0, Font_7x10);
+/// TAP画面 タップ間隔時間表示
+ui::number s_tapTimeNumber(114, 0, Font_7x10, ui::RIGHT, "", " ms");
+/// TAP画面 bpm表示
+ui::number s_tapBpm(103, 20, Font_16x26, ui::RIGHT, "", " bpm");
+/// TAP画面 点滅バー
+ui::bar s_tapBar(8, 47, 112, 2);
+} // namespace
+
+void ui::fxScreen(fxView const& v) {
+    uint8_t fxPage = v.paramIdx / 6; // エフェクトパラメータページ番号
+    // 選択中のパラメータ値が変わった場合、実際の値を単位付きでステータス表示する------------------------------
+    static char editStr[20] = {};         // 名称 実際の値 単位
+    static uint32_t editKey = UINT32_MAX; // エフェクト番号・パラメータ番号・パラメータ値 起動直後は表示しない
+    static uint32_t editTick = 0;         // 表示開始時刻
+    static bool editDisp = false;         // 表示中
+    {
+        const uint32_t key = g_fxNum << 24 | v.paramIdx << 16 | (uint16_t)g_fxParam[v.paramIdx].value;
+        fx::paramDef const* pd = fx::getParamDef(v.paramIdx);
+        if (pd && key != editKey && (key >> 16) == (editKey >> 16)) {
+            strFormat str(editStr);
+            str.str(pd->name).ch(' ');
+            pd->format(str, g_fxParam[v.paramIdx].value);
+            str.str(pd->unitStr());
+            editTick = v.now;
+            editDisp = true;
+        }
+        editKey = key;
+        if (editDisp && v.now - editTick > STATUS_DISP_MSEC)
+            editDisp = false;
+    }
+    // ステータス表示------------------------------
+    s_statusLabel.set(editDisp ? editStr : v.status);
+    // カーソル範囲内の表示が変わる場合、描き直す前にカーソルを消す------------------------------
+    {
+        const position& c = POS_CURSOR[v.cursor];
+        const uint8_t idx = v.cursor + 6 * fxPage;
+        if (!s_cursor.at(c.x, c.y, 62, 16) ||
+            s_paramName[v.cursor].changed(g_fxParam[idx].nameTxt ? g_fxParam[idx].nameTxt : "") ||
+            s_paramValue[v.cursor].changed(idx << 16 | (uint16_t)g_fxParam[idx].value)) {
+            s_cursor.hide();
+        }
+    }
+    for (int i = 0; i < 6; i++) {
+        const uint8_t idx = i + 6 * fxPage;
+        if (idx >= PARAM_COUNT) {
+            s_paramName[i].set("");
+            s_paramValue[i].setText(-1, "");
+            continue;
+        }
+        // 名称と数値は表示範囲が重なる場合があるため、どちらかが変わった場合は両方を名称→数値の順で描き直す
+        char const* name = g_fxParam[idx].nameTxt ? g_fxParam[idx].nameTxt : "";
+        const int32_t key = idx << 16 | (uint16_t)g_fxParam[idx].value;
+        if (s_paramName[i].changed(name) || s_paramValue[i].changed(key)) {
+            s_paramName[i].erase();
+            s_paramValue[i].erase();
+        }
+        // エフェクトパラメータ名称表示------------------------------
+        s_paramName[i].set(name);
+        // エフェクトパラメータ数値表示 数値が変わった場合のみ文字列に変換------------------------------
+        if (s_paramValue[i].changed(key)) {
+            fx::setParamStr(idx); // パラメータ数値を文字列に変換
+            s_paramValue[i].setText(key, g_fxParam[idx].valueTxt);
+        }
+    }
+    // エフェクトパラメータページ番号表示------------------------------
+    s_pageNumber.set(fxPage + 1);
+    // カーソル表示(選択したパラメータの白黒反転) ------------------------------
+    s_cursor.show(POS_CURSOR[v.cursor].x, POS_CURSOR[v.cursor].y, 62, 16);
+    // CPU使用率表示------------------------------
+    s_cpuPercent.set(v.cpuPercent);
+}
+
+void ui::tapScreen(float tapTime, uint32_t sinceBeat) {
+    s_tapTitle.set("TAP TEMPO");
+    s_tapTimeNumber.set((uint16_t)tapTime); // タップ間隔時間を表示
+    uint16_t bpm = (uint16_t)tapTime;
+    if (tapTime > 60.0f) {
+        bpm = (uint16_t)(60000.0f / tapTime); // bpmを計算
+    }
+    s_tapBpm.set(bpm); // bpm表示
+
+    const uint32_t blinkMsec = 1 + (uint32_t)tapTime; // 点滅周期 最後にタップした時刻に合わせる
+    if (sinceBeat % blinkMsec < 60)                   // 60msバーを表示、点滅
+    {
+        s_tapBar.set(112);
+    }
+    else {
+        s_tapBar.set(0);
+    }
+}
+
+void ui::screenInvalidate() {
+    s_statusLabel.invalidate();
+    for (int i = 0; i < 6; i++) {
+        s_paramName[i].invalidate();
+        s_paramValue[i].invalidate();
+    }
+    s_pageNumber.invalidate();
+    s_cursor.invalidate();
+    s_cpuPercent.invalidate();
+    s_tapTitle.invalidate();
+    s_tapTimeNumber.invalidate();
+    s_tapBpm.invalidate();
+    s_tapBar.invalidate();
+}
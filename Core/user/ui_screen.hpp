@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stdint.h>
+
+/* 画面表示 エフェクト画面・TAP画面 ------------------------------------------------*/
+// 描画はssd1306の描画関数のみで行い、送信先（実機: I2C ホスト: メモリ上の画面）によらない
+// 表示内容は引数で受け取り、時刻・HALに依存しないため、ホスト（PC）でも描画して画像と比べられる
+// 画面切替時は画面を消去した後、screenInvalidate() を呼ぶこと
+
+namespace ui {
+/// 位置型
+struct position {
+    uint8_t x;
+    uint8_t y;
+};
+/// 処理時間% 表示位置 エフェクト画面・スペクトラム画面
+constexpr position POS_PERCENT = { 107, 0 };
+
+/// エフェクト画面の表示内容 パラメータは g_fxNum・g_fxParam を表示する
+struct fxView {
+    uint8_t paramIdx;   ///< 選択中のパラメータ番号
+    uint8_t cursor;     ///< カーソル位置 0 ～ 5
+    char const* status; ///< ステータス表示文字列
+    int32_t cpuPercent; ///< I2S割込み処理時間 %
+    uint32_t now;       ///< 現在時刻 ms パラメータ値変更時の表示時間に使う
+};
+
+/// @brief エフェクト画面表示
+/// 前回から変化した表示のみ描き直す
+/// 選択中のパラメータ値が変わった場合、一定時間ステータスの代わりに名称と実際の値を単位付きで表示する
+void fxScreen(fxView const& v);
+
+/// @brief TAP画面表示
+/// @param[in] tapTime タップ間隔 ms
+/// @param[in] sinceBeat 最後の拍からの時間 ms 拍ごとにバーを点滅させる
+void tapScreen(float tapTime, uint32_t sinceBeat);
+
+/// @brief エフェクト画面・TAP画面の各ウィジェットを未描画の状態に戻す
+void screenInvalidate();
+} // namespace ui
@@ -0,0 +1,254 @@
+#pragma once
+
+#include "lib_format.hpp"
+#include "ssd1306.hpp"
+#include <stdint.h>
+#include <string.h> // strcmp
+
+/* 画面表示用ウィジェット --------------------------------------------------------*/
+// 前回描画した内容を保持し、変化した場合のみその範囲を描き直す
+// 描き直した範囲だけがssd1306の変更範囲となり、画面更新時の転送量・描画処理が減る
+// 画面切替時は画面を消去した後、各ウィジェットの invalidate() を呼ぶこと
+
+namespace ui {
+class label;
+class number;
+class bar;
+class meter;
+class cursor;
+template <uint32_t N>
+class barGraph;
+
+/// 文字列の揃え位置
+enum ALIGN {
+    LEFT,  ///< x: 左端の文字位置
+    RIGHT, ///< x: 右端の文字位置（ssd1306_R_xyWriteStrWTと同じ）
+};
+} // namespace ui
+
+/// @brief 文字列表示
+class ui::label {
+protected:
+    static constexpr uint32_t TEXT_SIZE = 20; // 保持する文字列の最大長 + 1
+
+    int16_t x_;
+    int16_t y_;
+    FontDef const* font_;
+    ALIGN align_;
+    char text_[TEXT_SIZE] = {}; // 描画済の文字列
+    int16_t drawX_ = 0;         // 描画済範囲 左端
+    int16_t drawW_ = 0;         // 描画済範囲 幅
+    bool valid_ = false;        // falseの場合、次回必ず描画する
+
+public:
+    label(int16_t x, int16_t y, FontDef const& font, ALIGN align = LEFT) : x_(x), y_(y), font_(&font), align_(align) {}
+
+    bool changed(char const* str) const // 描き直しが必要か
+    {
+        return !valid_ || strncmp(text_, str, TEXT_SIZE - 1) != 0;
+    }
+
+    bool set(char const* str) // 変化した場合のみ描き直し、trueを返す
+    {
+        if (!changed(str))
+            return false;
+
+        strncpy(text_, str, TEXT_SIZE - 1);
+        text_[TEXT_SIZE - 1] = '\0';
+
+        // 前回の範囲を消去 新しい文字の部分は文字描画で上書きされる
+        ssd1306_FillRect(drawX_, y_, drawW_, font_->FontHeight, Black);
+
+        const int16_t len = strlen(text_);
+        drawW_ = len * font_->FontWidth;
+        drawX_ = (align_ == RIGHT) ? x_ - font_->FontWidth * (len - 1) : x_;
+        if (len > 0) {
+            if (align_ == RIGHT)
+                ssd1306_R_xyWriteStrWT(x_, y_, text_, *font_);
+            else
+                ssd1306_xyWriteStrWT(x_, y_, text_, *font_);
+        }
+        valid_ = true;
+        return true;
+    }
+
+    void erase() // 描画済範囲を消去 重なって表示する他の表示と描画順を揃える場合に使う
+    {
+        ssd1306_FillRect(drawX_, y_, drawW_, font_->FontHeight, Black);
+        invalidate();
+    }
+
+    void invalidate() // 画面消去後に呼ぶ 描画済範囲は消去済として扱う
+    {
+        valid_ = false;
+        drawW_ = 0;
+    }
+};
+
+/// @brief 整数値表示 値が変化した場合のみ文字列に変換する
+class ui::number : public ui::label {
+private:
+    char const* prefix_;
+    char const* suffix_;
+    uint8_t minDigits_; // 最小桁数 足りない場合は空白で埋める
+    int32_t value_ = 0; // 描画済の値
+
+public:
+    number(int16_t x, int16_t y, FontDef const& font, ALIGN align = LEFT, char const* prefix = "",
+        char const* suffix = "", uint8_t minDigits = 1)
+        : label(x, y, font, align), prefix_(prefix), suffix_(suffix), minDigits_(minDigits) {}
+
+    bool changed(int32_t v) const { return !valid_ || v != value_; }
+
+    bool set(int32_t v) // 変化した場合のみ描き直し、trueを返す
+    {
+        if (!changed(v))
+            return false;
+        value_ = v;
+
+        char str[TEXT_SIZE];
+        return label::set(strFormat(str).str(prefix_).dec(v, minDigits_).str(suffix_).c_str());
+    }
+
+    bool setText(int32_t v, char const* str) // 文字列変換を呼出側で行う場合 値は変化判定用
+    {
+        value_ = v;
+        return label::set(str);
+    }
+};
+
+/// @brief 横棒表示 左端から長さlenを塗りつぶす 前回との差分のみ描き直す
+class ui::bar {
+protected:
+    int16_t x_;
+    int16_t y_;
+    int16_t w_;
+    int16_t h_;
+    int16_t len_ = 0;    // 描画済の長さ
+    bool valid_ = false; // falseの場合、次回必ず描画する
+
+public:
+    bar(int16_t x, int16_t y, int16_t w, int16_t h) : x_(x), y_(y), w_(w), h_(h) {}
+
+    bool set(int16_t len) // 長さ 0 ～ w 変化した場合のみ描き直し、trueを返す
+    {
+        len = (len < 0) ? 0 : (len > w_) ? w_ : len;
+        if (valid_ && len == len_)
+            return false;
+        if (!valid_)
+            len_ = 0; // 画面消去済
+        if (len > len_)
+            ssd1306_FillRect(x_ + len_, y_, len - len_, h_, White);
+        else
+            ssd1306_FillRect(x_ + len, y_, len_ - len, h_, Black);
+        len_ = len;
+        valid_ = true;
+        return true;
+    }
+
+    void invalidate() { valid_ = false; }
+};
+
+/// @brief レベルメーター 横棒 + ピークホールド位置の縦線
+class ui::meter : public ui::bar {
+private:
+    int16_t peak_ = -1; // 描画済のピーク位置 -1: 非表示
+
+public:
+    meter(int16_t x, int16_t y, int16_t w, int16_t h) : bar(x, y, w, h) {}
+
+    bool set(int16_t len, int16_t peak) // peak < 0 でピーク非表示
+    {
+        peak = (peak < 0) ? -1 : (peak >= w_) ? w_ - 1 : peak;
+        const bool peakChanged = !valid_ || peak != peak_;
+        if (!valid_)
+            peak_ = -1; // 画面消去済
+
+        // 前回のピーク線を消去 棒の範囲内は棒の描き直しに任せる
+        if (peakChanged && peak_ >= len_)
+            ssd1306_DrawVLine(x_ + peak_, y_, h_, Black);
+        bool redraw = bar::set(len);
+        // 棒の描き直しで消えた場合も含め、棒の外側にあるピーク線を描く
+        if ((peakChanged || redraw) && peak >= len_)
+            ssd1306_DrawVLine(x_ + peak, y_, h_, White);
+        peak_ = peak;
+        return peakChanged || redraw;
+    }
+};
+
+/// @brief カーソル表示 矩形範囲の白黒反転
+/// 反転範囲内の表示を描き直す前に hide() で元に戻し、描き直した後に show() で再度反転する
+class ui::cursor {
+private:
+    int16_t x_ = 0;
+    int16_t y_ = 0;
+    int16_t w_ = 0;
+    int16_t h_ = 0;
+    bool shown_ = false;
+
+public:
+    cursor() {}
+
+    bool at(int16_t x, int16_t y, int16_t w, int16_t h) const // 指定範囲に表示中か
+    {
+        return shown_ && x == x_ && y == y_ && w == w_ && h == h_;
+    }
+
+    void hide() {
+        if (shown_)
+            ssd1306_InvertRect(x_, y_, w_, h_);
+        shown_ = false;
+    }
+
+    void show(int16_t x, int16_t y, int16_t w, int16_t h) {
+        if (at(x, y, w, h))
+            return;
+        hide();
+        x_ = x;
+        y_ = y;
+        w_ = w;
+        h_ = h;
+        ssd1306_InvertRect(x_, y_, w_, h_);
+        shown_ = true;
+    }
+
+    void invalidate() { shown_ = false; } // 画面消去後に呼ぶ
+};
+
+/// @brief 縦棒グラフ N本の縦棒を等間隔に並べる 各棒は前回との差分のみ描き直す
+template <uint32_t N>
+class ui::barGraph {
+private:
+    int16_t x_;
+    int16_t y_;
+    int16_t barW_;  // 棒の幅
+    int16_t pitch_; // 棒の間隔
+    int16_t h_;
+    int16_t len_[N] = {}; // 描画済の長さ
+
+public:
+    barGraph(int16_t x, int16_t y, int16_t barW, int16_t pitch, int16_t h)
+        : x_(x), y_(y), barW_(barW), pitch_(pitch), h_(h) {}
+
+    int16_t get(uint32_t i) const { return len_[i]; } // 描画済の長さ
+
+    bool set(uint32_t i, int16_t len) // i本目の長さ 0 ～ h 変化した場合のみ描き直し、trueを返す
+    {
+        len = (len < 0) ? 0 : (len > h_) ? h_ : len;
+        if (len == len_[i])
+            return false;
+        const int16_t x = x_ + pitch_ * i;
+        if (len > len_[i])
+            ssd1306_FillRect(x, y_ + h_ - len, barW_, len - len_[i], White);
+        else
+            ssd1306_FillRect(x, y_ + h_ - len_[i], barW_, len_[i] - len, Black);
+        len_[i] = len;
+        return true;
+    }
+
+    void invalidate() // 画面消去後に呼ぶ 全ての棒を長さ0として扱う
+    {
+        for (uint32_t i = 0; i < N; i++)
+            len_[i] = 0;
+    }
+};
@@ -2,48 +2,57 @@
 #include "cmsis_os.h"
 #include "common.h"
 #include "fx.h"
+#include "input.hpp"
+#include "lib_calc.hpp"
+#include "lib_dynamics.hpp"
+#include "lib_meter.hpp"
+#include "lib_ringBuf.hpp"
+#include "lib_tempo.hpp"
 #include "main.h"
+#include "midi.hpp"
 #include "ssd1306.hpp"
+#include "ssd1306_i2c.hpp"
 #include "stm32f7xx_hal_i2s.h"
+#include "storage.hpp"
+#include "ui_screen.hpp"
+#include "ui_widget.hpp"
+#include <algorithm>
 #include <cmath>
 #include <string.h> // memset
-#include <string>
 
 #ifdef TUNER_ENABLED
 #include "tuner.h"
 #endif
 
+#ifdef SPECTRUM_ENABLED
+#include "spectrum.h"
+#endif
+
 extern I2C_HandleTypeDef hi2c1;
 extern I2S_HandleTypeDef hi2s2;
 extern I2S_HandleTypeDef hi2s3;
 
 // 定数定義
 namespace {
-/// 位置型
-struct Position {
-    uint8_t x;
-    uint8_t y;
-};
-/// エフェクト名 ステータス 表示位置
-constexpr Position POS_STATUS = { 4, 0 };
-/// エフェクトパラメータ ページ 表示位置
-constexpr Position POS_PAGE = { 88, 0 };
-/// 処理時間% 表示位置
-constexpr Position POS_PERCENT = { 107, 0 };
-/// カーソル位置
-constexpr Position POS_CURSOR[6] = { { 0, 11 }, { 0, 29 }, { 0, 47 }, { 65, 11 }, { 65, 29 }, { 65, 47 } };
-/// エフェクトパラメータ名表示位置
-constexpr Position POS_PARAM_NAME[6] = { { 0, 17 }, { 0, 35 }, { 0, 53 }, { 65, 17 }, { 65, 35 }, { 65, 53 } };
-/// エフェクトパラメータ数値表示 右端の文字位置
-constexpr Position POS_PARAM_VALUE[6] = { { 52, 11 }, { 52, 29 }, { 52, 47 }, { 117, 11 }, { 117, 29 }, { 117, 47 } };
 /// I2Sの割り込み間隔時間
 constexpr float I2S_INTERRUPT_INTERVAL = static_cast<float>(fx::BLOCK_SIZE) / SAMPLING_FREQ;
-/// スイッチ短押しのカウント数（1つのスイッチは4回に1回の読取のため4をかける）
-constexpr uint32_t SHORT_PUSH_COUNT = 1 + SHORT_PUSH_MSEC / (4 * 1000 * I2S_INTERRUPT_INTERVAL);
-/// スイッチ長押しのカウント数（1つのスイッチは4回に1回の読取のため4をかける）
-constexpr uint32_t LONG_PUSH_COUNT = 1 + LONG_PUSH_MSEC / (4 * 1000 * I2S_INTERRUPT_INTERVAL);
-/// ステータス情報表示時間のカウント数（1つのスイッチは4回に1回の読取のため4をかける）
-constexpr uint32_t STATUS_DISP_COUNT = 1 + STATUS_DISP_MSEC / (1000 * I2S_INTERRUPT_INTERVAL);
+/// レベルメーター 集計サンプル数 約23ms
+constexpr uint32_t METER_WINDOW = 1024;
+/// 旧形式の保存データのエフェクト数
+constexpr uint32_t LEGACY_FX_COUNT = 6;
+/// 保存データのキー 0 ～ LEGACY_FX_COUNT-1 は各エフェクトのパラメータ
+/// 保存済のキーを変えないよう、後から追加したエフェクトのパラメータはプリセットの後ろに置く
+constexpr uint8_t STORE_KEY_FXNUM = LEGACY_FX_COUNT;                    ///< 保存時のエフェクト番号
+constexpr uint8_t STORE_KEY_PRESET = STORE_KEY_FXNUM + 1;               ///< プリセット PRESET_COUNT個
+constexpr uint8_t STORE_KEY_FX_ADDED = STORE_KEY_PRESET + PRESET_COUNT; ///< 追加したエフェクトのパラメータ
+static_assert(STORE_KEY_FX_ADDED + fx::COUNT - LEGACY_FX_COUNT <= storage::log::KEY_MAX, "storage key");
+/// @brief エフェクトのパラメータの保存データのキー
+constexpr uint8_t storeKeyFx(uint32_t fxNum) {
+    return (fxNum < LEGACY_FX_COUNT) ? fxNum : STORE_KEY_FX_ADDED + fxNum - LEGACY_FX_COUNT;
+}
+static_assert(sizeof(int16_t) * (1 + PARAM_COUNT) <= storage::log::DATA_MAX, "storage data size");
+/// クリップと判定する入力レベル
+constexpr float INPUT_CLIP_LEVEL = 0.99f;
 } // namespace
 
 // スタティック変数定義
@@ -52,26 +61,142 @@ namespace {
 int32_t s_rxBuffer[fx::BLOCK_SIZE * 4] = {};
 /// 音声信号送信バッファ配列
 int32_t s_txBuffer[fx::BLOCK_SIZE * 4] = {};
-/// I2Sの割り込みごとにカウントアップ タイマとして利用
-uint32_t s_callbackCount = 0;
+/// 保存データ フラッシュ追記型ログ
+storage::log s_store;
 /// CPU使用サイクル数 各エフェクトごとに最大値を記録
 uint32_t s_cpuUsageCycleMax[fx::COUNT] = {};
+/// I2S割込み開始時のCPUサイクル数 CPU使用率計算用
+/// ※チューナー解析タスク等でもCPUサイクル数を使うため、リセットせず差分で計算する
+uint32_t s_blockStartCycle = 0;
 /// エフェクトパラメータ 現在何番目か ※0から始まる
 uint8_t s_fxParamIdx = 0;
-/// エフェクト種類変更フラグ 次エフェクトへ: 1 前エフェクトへ: -1
-int s_fxChangeFlag = 0;
 /// パラメータ選択カーソル位置 0 ～ 5
 uint8_t s_cursorPosition = 0;
 /// ステータス表示文字列
 char const* s_statusStr = PEDAL_NAME;
+/// ステータス表示文字列を変更した時刻 ms 一定時間後にエフェクト名表示に戻す
+uint32_t s_statusTick = 0;
+/// スイッチ操作イベント 右側のスイッチは長押しで繰り返し動作
+input::scanner s_input(SHORT_PUSH_MSEC, LONG_PUSH_MSEC, LONG_PUSH_MSEC / 2, LONG_PUSH_MSEC / 4,
+    1 << input::UPPER_R | 1 << input::LOWER_R);
+/// タップテンポ タップ間隔を平均し、拍の時刻を保持する 時刻はスイッチを押し始めた時刻 ms
+tempoClock s_tempo(MIN_TAP_TIME, MAX_TAP_TIME);
+#ifdef MIDI_ENABLED
+/// MIDI受信メッセージ スイッチ読取タスクで積み、画面表示タスクで処理する
+ringBuf<midi::message, 64> s_midiQueue;
+/// MIDIタイミングクロック数 1拍ごとにタップとして扱う
+uint32_t s_midiClockCount = 0;
+#endif
+/// 出力ミュート要求 フラッシュのセクター消去中 I2S割込みで無音を出力する
+volatile bool s_muteRequest = false;
+/// 保存状態定義
+enum SAVE_STATE : uint8_t { SAVE_IDLE, SAVE_BUSY, SAVE_DONE, SAVE_ERROR };
+/// 保存状態 画面表示タスクが SAVE_BUSY にし、保存タスクが完了時に SAVE_DONE / SAVE_ERROR にする
+volatile SAVE_STATE s_saveState = SAVE_IDLE;
+/// 保存中に受けた保存要求 画面表示タスクで完了後に改めて保存する
+bool s_savePending = false;
+/// 保存するデータ 保存要求時に画面表示タスクでコピーし、保存タスクが書き込む
+int16_t s_saveData[fx::COUNT][PARAM_COUNT] = {};
+/// 保存するエフェクト番号
+uint8_t s_saveFxNum = 0;
+/// プリセット エフェクト番号とパラメータ値の組
+struct Preset {
+    int16_t fxNum;              ///< エフェクト番号 範囲外: 未保存
+    int16_t value[PARAM_COUNT]; ///< パラメータ値
+};
+/// プリセット 起動時に読み込み、呼出はRAMからコピーのみ行う
+Preset s_presets[PRESET_COUNT];
+/// 保存するプリセット
+Preset s_savePresets[PRESET_COUNT];
+/// 選択中のプリセット番号
+uint8_t s_presetIdx = 0;
+/// 最後に呼び出した・記録したプリセット番号 PRESET_COUNT: なし
+uint8_t s_presetActive = PRESET_COUNT;
+/// モーフィング移行先のプリセット番号 PRESET_COUNT: モーフィングなし
+uint8_t s_morphSlot = PRESET_COUNT;
+/// モーフィング方向 true: 移行先へ
+bool s_morphToTarget = false;
+/// 保存タスク 保存要求を通知する
+osThreadId s_storageTaskId = nullptr;
+/// 保存要求シグナル
+constexpr int32_t SAVE_SIGNAL = 0x01;
 /// 動作モード定義
-enum MODE { NORMAL, TAP, TUNER };
-/// 動作モード 0:通常 1:タップテンポ 2:チューナー
+enum MODE { NORMAL, TAP, TUNER, METER, SPECTRUM, PRESET };
+/// 動作モード 0:通常 1:タップテンポ 2:チューナー 3:レベルメーター 4:スペクトラムアナライザー 5:プリセット
 MODE s_currentMode = NORMAL;
+/// 入力レベルメーター
+levelMeter<METER_WINDOW> s_inMeter;
+/// 出力レベルメーター
+levelMeter<METER_WINDOW> s_outMeter;
+#ifdef OUTPUT_LIMITER_ENABLED
+/// 出力リミッター
+brickwallLimiter s_outLimiter(OUTPUT_LIMIT_LEVEL, OUTPUT_LIMIT_RELEASE_MSEC, fx::BLOCK_SIZE);
+#endif
+/// スペクトラムアナライザー表示中のCPU使用サイクル数 最大値
+uint32_t s_spectrumCycleMax = 0;
+/// 画面表示中の動作モード 切替時に画面を全消去する
+int s_dispMode = -1;
+} // namespace
+
+// 画面表示ウィジェット 前回の表示内容を保持し、変化した部分のみ描き直す
+namespace {
+#ifdef METER_ENABLED
+/// レベルメーター画面 横棒の幅
+constexpr int16_t METER_WIDTH = 104;
+/// レベルメーター画面 1チャンネル分の表示
+struct MeterDisp {
+    char const* nameTxt; ///< チャンネル名
+    ui::label name;      ///< チャンネル名表示
+    ui::meter peak;      ///< ピーク・ピークホールド
+    ui::bar rms;         ///< RMS
+    ui::number clip;     ///< クリップ回数
+    ui::number hold;     ///< ピークホールド値 dB
+    float holdDb;        ///< ピークホールド値 dB
+    uint32_t holdCount;  ///< ピークホールド残り画面更新回数
+    uint32_t clipBase;   ///< 画面表示開始時のクリップ回数
+};
+/// レベルメーター画面 タイトル
+ui::label s_meterTitle(0, 0, Font_7x10);
+/// レベルメーター画面 入力・出力
+MeterDisp s_meterDisp[2] = {
+    { "IN", { 0, 14, Font_7x10 }, { 24, 14, METER_WIDTH, 6 }, { 24, 21, METER_WIDTH, 2 },
+        { 24, 25, Font_7x10, ui::LEFT, "CLIP " }, { 114, 25, Font_7x10, ui::RIGHT, "", "dB" }, -METER_RANGE_DB, 0, 0 },
+    { "OUT", { 0, 39, Font_7x10 }, { 24, 39, METER_WIDTH, 6 }, { 24, 46, METER_WIDTH, 2 },
+        { 24, 50, Font_7x10, ui::LEFT, "CLIP " }, { 114, 50, Font_7x10, ui::RIGHT, "", "dB" }, -METER_RANGE_DB, 0, 0 },
+};
+#endif
+#ifdef SPECTRUM_ENABLED
+/// スペクトラム画面 棒の最大の長さ
+constexpr int16_t SPECTRUM_HEIGHT = 52;
+/// スペクトラム画面 タイトル
+ui::label s_spectrumTitle(0, 0, Font_7x10);
+/// スペクトラム画面 I2S割込み処理のCPU使用率 %
+ui::number s_spectrumPercent(ui::POS_PERCENT.x, ui::POS_PERCENT.y, Font_7x10, ui::LEFT, "", "%", 2);
+/// スペクトラム画面 各帯域の縦棒 幅2 間隔3 左端から 42本 × 3 = 126ピクセル
+ui::barGraph<SPECTRUM_BANDS> s_spectrumBars(1, 64 - SPECTRUM_HEIGHT, 2, 3, SPECTRUM_HEIGHT);
+#endif
+#ifdef PRESET_ENABLED
+/// プリセット画面 タイトル
+ui::label s_presetTitle(0, 0, Font_7x10);
+/// プリセット画面 プリセット番号
+ui::number s_presetNumber(0, 16, Font_16x26, ui::LEFT, "P");
+/// プリセット画面 呼出中の表示
+ui::label s_presetActiveLabel(60, 16, Font_7x10);
+/// プリセット画面 エフェクト名
+ui::label s_presetFxName(60, 30, Font_7x10);
+/// プリセット画面 モーフィング移行先・位置
+ui::label s_presetMorph(0, 42, Font_7x10);
+/// プリセット画面 パラメータ反映（補間・係数計算）の1ブロックあたり最大処理時間
+ui::number s_presetUpdateUsec(113, 0, Font_7x10, ui::RIGHT, "", "us");
+/// プリセット画面 操作結果
+ui::label s_presetStatus(0, 54, Font_7x10);
+#endif
 } // namespace
 
-/// 現在のエフェクトパラメータ
+/// 現在のエフェクトパラメータ 画面表示タスクで使う
 FxParam g_fxParam[PARAM_COUNT];
+/// I2S割込みで使うエフェクトパラメータ 割込みの最初に画面表示タスクから受け取る
+FxParamSet g_audioParam;
 /// 現在のエフェクト番号
 uint8_t g_fxNum = 0;
 /// 全てのエフェクトパラメータデータ配列
@@ -80,22 +205,33 @@ int16_t g_fxAllData[fx::COUNT][PARAM_COUNT] = {};
 float g_tapTime = 0.0f;
 
 namespace {
-/// @brief エフェクト切替時、データ保存時のミュート
-inline void mute() { memset(s_txBuffer, 0, sizeof(s_txBuffer)); }
+/// @brief モーフィング解除 パラメータは現在の値に戻る
+inline void morphCancel() {
+    s_morphSlot = PRESET_COUNT;
+    s_morphToTarget = false;
+    fx::setMorph(nullptr, false, 0.0f);
+}
 /// @brief エフェクト変更
-inline void fxChange() {
-    mute();
-    fx::deinit();
-    fx::change(s_fxChangeFlag);
+/// エフェクトの終了処理・初期化はI2S割込みでパラメータを受け取った時に行う
+/// @param[in] shiftCount 次エフェクトへ: 1 前エフェクトへ: -1
+inline void fxChange(int shiftCount) {
+    morphCancel();
+    fx::change(shiftCount);
     s_fxParamIdx = 0;
     s_cursorPosition = 0;
-    fx::init();
-    s_fxChangeFlag = 0;
+    fx::loadParam(g_fxAllData[g_fxNum]);
 }
-/// @brief データ読み込み
-inline void loadData() {
+/// @brief 旧形式のデータ読み込み 全エフェクトのパラメータとエフェクト番号を順に並べたもの
+/// 次回の保存時にセクターを消去し、新しい形式で書き直す
+inline void loadLegacyData() {
+    for (uint32_t i = 0; i < PRESET_COUNT; i++) {
+        s_presets[i].fxNum = -1; // 旧形式にはプリセットがない
+    }
+    for (uint32_t i = LEGACY_FX_COUNT; i < fx::COUNT; i++) {
+        memset(g_fxAllData[i], 0xFF, sizeof(g_fxAllData[i])); // 旧形式にないエフェクト 初期値を使う
+    }
     uint32_t addr = DATA_ADDR;
-    for (uint32_t i = 0; i < fx::COUNT; i++) // エフェクトデータ フラッシュ読込
+    for (uint32_t i = 0; i < LEGACY_FX_COUNT; i++) // エフェクトデータ フラッシュ読込
     {
         for (uint32_t j = 0; j < PARAM_COUNT; j++) {
             g_fxAllData[i][j] = *reinterpret_cast<uint16_t*>(addr);
@@ -107,237 +243,501 @@ inline void loadData() {
         g_fxNum = 0;
     }
 }
+/// @brief データ読み込み 各キーの最新のレコードを読む
+inline void loadData() {
+    if (s_store.init(storage::sectorFlash(DATA_SECTOR, DATA_ADDR, DATA_SIZE)) == storage::log::UNKNOWN) {
+        loadLegacyData();
+        return;
+    }
+    for (uint32_t i = 0; i < fx::COUNT; i++) {
+        if (!s_store.read(storeKeyFx(i), g_fxAllData[i], sizeof(g_fxAllData[i])))
+            memset(g_fxAllData[i], 0xFF, sizeof(g_fxAllData[i])); // 未保存 範囲外の値(-1)とし、初期値を使う
+    }
+    uint32_t fxNum = 0;
+    s_store.read(STORE_KEY_FXNUM, &fxNum, sizeof(fxNum));
+    g_fxNum = (fxNum < fx::COUNT) ? fxNum : 0;
+    for (uint32_t i = 0; i < PRESET_COUNT; i++) {
+        if (!s_store.read(STORE_KEY_PRESET + i, &s_presets[i], sizeof(Preset)))
+            s_presets[i].fxNum = -1; // 未保存
+    }
+
+    // 空きが少ない場合は起動時にコンパクションし、演奏中にセクター消去が起きないようにする
+    if (s_store.remain() < DATA_SIZE / 4) {
+        s_muteRequest = true;
+        osDelay(2);
+        s_store.compact();
+        s_muteRequest = false;
+    }
+}
 /// @brief データ全消去
 inline void eraseData() {
-    HAL_FLASH_Unlock(); // フラッシュ ロック解除
-    FLASH_EraseInitTypeDef erase = {};
-    erase.TypeErase = FLASH_TYPEERASE_SECTORS;
-    erase.Sector = DATA_SECTOR;
-    erase.NbSectors = 1;
-    erase.VoltageRange = FLASH_VOLTAGE_RANGE_3;
-    uint32_t error = 0;
-    HAL_FLASHEx_Erase(&erase, &error); // フラッシュ消去
-    HAL_FLASH_Lock();                  // フラッシュ ロック
-}
-/// @brief データ保存
+    storage::flash const& f = storage::sectorFlash(DATA_SECTOR, DATA_ADDR, DATA_SIZE);
+    f.erase(f.context);
+}
+/// @brief レコード書込 セクター消去が必要な場合のみ、消去中は出力をミュートする
+/// @return 書込失敗時false
+inline bool storeRecord(uint8_t key, void const* data, uint32_t size) {
+    const bool erase = s_store.remain() < storage::log::recordBytes(size);
+    if (erase) {
+        s_muteRequest = true;
+        osDelay(2); // I2S割込みが送信バッファ全体に無音を書き込むまで待つ 1ブロック約0.36ms
+    }
+    const bool ok = s_store.write(key, data, size);
+    s_muteRequest = false;
+    return ok;
+}
+/// @brief データ保存 画面表示タスクから呼ぶ
+/// 保存するデータをコピーして保存タスクへ渡し、書込完了を待たずに戻る
+/// 保存中の場合は要求を記録し、完了後に inputProcess から改めて保存する
 inline void saveData() {
-    mute();
-    ssd1306_xyWriteStrWT(POS_STATUS.x, POS_STATUS.y, "WRITING... ", Font_7x10);
-
-    eraseData(); // フラッシュ消去
-
-    HAL_FLASH_Unlock(); // フラッシュ ロック解除
-
+    if (s_saveState == SAVE_BUSY) {
+        s_savePending = true; // 保存中 コピー済のデータは書き換えない
+        return;
+    }
+    s_savePending = false;
     // 現在のパラメータをデータ配列へ移す
     for (uint32_t i = 0; i < PARAM_COUNT; ++i) {
         g_fxAllData[g_fxNum][i] = g_fxParam[i].value;
     }
-
-    uint32_t addr = DATA_ADDR;
-    for (uint32_t i = 0; i < fx::COUNT; i++) // フラッシュ書込
-    {
-        for (uint32_t j = 0; j < PARAM_COUNT; j++) {
-            HAL_FLASH_Program(FLASH_TYPEPROGRAM_HALFWORD, addr, g_fxAllData[i][j]);
-            addr += 2;
+    memcpy(s_saveData, g_fxAllData, sizeof(s_saveData));
+    memcpy(s_savePresets, s_presets, sizeof(s_savePresets));
+    s_saveFxNum = g_fxNum;
+    s_saveState = SAVE_BUSY;
+    osSignalSet(s_storageTaskId, SAVE_SIGNAL);
+}
+/// @brief 保存タスク
+/// 内容が変わったデータのみ追記する 書込は少しずつ行い、音声処理を止めない
+void storageTask(void const* argument) {
+    for (;;) {
+        osSignalWait(SAVE_SIGNAL, osWaitForever);
+        bool ok = true;
+        for (uint32_t i = 0; i < fx::COUNT; i++) {
+            ok = storeRecord(storeKeyFx(i), s_saveData[i], sizeof(s_saveData[i])) && ok;
         }
+        const uint32_t fxNum = s_saveFxNum;
+        ok = storeRecord(STORE_KEY_FXNUM, &fxNum, sizeof(fxNum)) && ok; // 保存時のエフェクト番号記録
+        for (uint32_t i = 0; i < PRESET_COUNT; i++) {
+            if (s_savePresets[i].fxNum >= 0) // 未保存のプリセットは書き込まない
+                ok = storeRecord(STORE_KEY_PRESET + i, &s_savePresets[i], sizeof(Preset)) && ok;
+        }
+        s_saveState = ok ? SAVE_DONE : SAVE_ERROR;
     }
-    HAL_FLASH_Program(FLASH_TYPEPROGRAM_HALFWORD, addr, g_fxNum); // 保存時のエフェクト番号記録
-
-    HAL_FLASH_Lock(); // フラッシュ ロック
-
-    s_statusStr = "STORED!    "; // ステータス表示
-    s_callbackCount = 0;
-
-    DWT->CYCCNT = 0; // CPU使用率計算に影響しないように、CPUサイクル数を一旦リセット
 }
-/// @brief スイッチ処理
-/// @param[in] num
-inline void swProcess(uint8_t num) {
-    static uint32_t swCount[10] = {}; // スイッチが押されている間カウントアップ
+/// @brief 保存状態の表示文字列 画面表示タスクから呼ぶ
+/// 保存タスクの結果（完了・失敗）はここで1回だけ受け取り、どの画面でも一定時間同じ表示を返す
+/// @return 表示する文字列 表示しない場合nullptr
+inline char const* saveStatusStr() {
+    static char const* const SAVE_STR[] = { "", "SAVING...", "STORED!", "SAVE ERROR" };
+    static SAVE_STATE shown = SAVE_IDLE; // 表示中の保存状態
+    static uint32_t shownTick = 0;       // 表示開始時刻
+    const SAVE_STATE state = s_saveState;
+    if (state != SAVE_IDLE) {
+        shown = state;
+        shownTick = osKernelSysTick();
+        if (state != SAVE_BUSY)
+            s_saveState = SAVE_IDLE; // 結果を受け取った
+    }
+    else if (shown != SAVE_IDLE && osKernelSysTick() - shownTick > STATUS_DISP_MSEC) {
+        shown = SAVE_IDLE;
+    }
+    return (shown != SAVE_IDLE) ? SAVE_STR[shown] : nullptr;
+}
+/// @brief プリセット呼出 RAM上のプリセットを現在のパラメータへコピーする
+/// 係数の再計算はI2S割込みで変わったパラメータのみ行い、1ブロックで全て反映する
+/// @param[in] idx プリセット番号
+/// @return 未保存の場合false
+inline bool presetRecall(uint8_t idx) {
+    Preset const& p = s_presets[idx];
+    if (p.fxNum < 0 || p.fxNum >= (int16_t)fx::COUNT)
+        return false;
+    if (g_fxNum != p.fxNum) {
+        s_fxParamIdx = 0;
+        s_cursorPosition = 0;
+    }
+    morphCancel();
+    g_fxNum = p.fxNum;
+    fx::loadParam(p.value);
+    s_presetActive = idx;
+    return true;
+}
+/// @brief モーフィング開始・方向反転 呼び出したプリセットから同じエフェクトのプリセットへ移行する
+/// 移行中・移行後に同じプリセットを指定した場合は方向を反転し、元の音へ戻る
+/// 別のプリセットを指定した場合は、今鳴っている音を起点として移行し直す
+/// @param[in] idx 移行先のプリセット番号
+inline void presetMorph(uint8_t idx) {
+    Preset const& p = s_presets[idx];
+    if (p.fxNum != g_fxNum || idx == s_presetActive)
+        return; // 異なるエフェクト・未保存のプリセットへは移行しない
+    if (s_morphSlot != idx) {
+        fx::rebaseMorph();           // 別の移行先へ向かっている・到達している場合、今鳴っている音から移行する
+        fx::getUpdateCycleMax(true); // 処理時間は移行先ごとに計測し直す
+    }
+    s_morphToTarget = (s_morphSlot == idx) ? !s_morphToTarget : true;
+    s_morphSlot = idx;
+    fx::setMorph(p.value, s_morphToTarget, MORPH_MSEC);
+}
+/// @brief プリセット記録 現在のエフェクト番号とパラメータ値を記録し、保存する
+/// @param[in] idx プリセット番号
+inline void presetStore(uint8_t idx) {
+    if (idx == s_morphSlot)
+        morphCancel(); // 移行先を書き換える場合は現在の音に戻す
+    Preset& p = s_presets[idx];
+    p.fxNum = g_fxNum;
+    for (uint32_t i = 0; i < PARAM_COUNT; i++) {
+        p.value[i] = g_fxParam[i].value;
+    }
+    s_presetActive = idx;
+    saveData();
+}
+/// @brief 選択中のパラメータ値を変更 最小値～最大値に制限する
+/// @param[in] value
+inline void setParamValue(int32_t value) {
+    FxParam& fp = g_fxParam[s_fxParamIdx];
+    fp.value = clip(value, (int32_t)fp.min, (int32_t)fp.max);
+}
+/// @brief 通常モード時のスイッチ操作
+/// 左上・左下: パラメータ選択、長押しでエフェクト切替、同時長押しでデータ保存
+/// 右上・右下: パラメータ値増減、長押しで繰り返し 組合せで最大値・最小値・中間値
+/// @param[in] e 操作イベント
+inline void swEvent(input::event const& e) {
+    const bool withUpperL = e.held & (1 << input::UPPER_L);
+    const bool withLowerL = e.held & (1 << input::LOWER_L);
+    const bool withUpperR = e.held & (1 << input::UPPER_R);
+    const bool withLowerR = e.held & (1 << input::LOWER_R);
+    FxParam const& fp = g_fxParam[s_fxParamIdx];
+    const uint8_t count = fx::getParamTypeCount();
 
-    switch (num) {
-    case 0: // 左上スイッチ --------------------------------------------------------
-        if (!LL_GPIO_IsInputPinSet(SW0_UPPER_L_GPIO_Port, SW0_UPPER_L_Pin)) {
-            swCount[num]++;
-            // 長押し 1回のみ動作
-            if (swCount[num] == LONG_PUSH_COUNT) {
-                // 左下スイッチが押されている場合
-                if (swCount[num + 1] > SHORT_PUSH_COUNT) {
-                    swCount[num + 1] = LONG_PUSH_COUNT; // 左下スイッチも長押し済み扱いにする
-                    saveData();                         // データ保存
-                }
-                else {
-                    s_fxChangeFlag = -1;
-                }
-            }
+    switch (e.type) {
+    case input::LONG: // 長押し 1回のみ動作
+        if (e.count != 1)
+            break;
+        if (e.sw == input::UPPER_L) {
+            if (withLowerL)
+                saveData(); // 左下スイッチと同時長押しでデータ保存
+            else
+                fxChange(-1);
         }
-        else {
-            // 短押し 離した時の処理
-            if (swCount[num] >= SHORT_PUSH_COUNT && swCount[num] < LONG_PUSH_COUNT) {
-                // 右上スイッチが押されている場合、パラメータ数値を最大値へ
-                if (swCount[num + 2] > SHORT_PUSH_COUNT) {
-                    swCount[num + 2] = LONG_PUSH_COUNT + 1; // 右上スイッチは長押し済み扱いにする
-                    g_fxParam[s_fxParamIdx].value = g_fxParam[s_fxParamIdx].max;
-                }
-                // エフェクトパラメータ選択位置変更 0→最大値で循環
-                else {
-                    s_fxParamIdx = (fx::getParamTypeCount() + s_fxParamIdx - 1) % fx::getParamTypeCount();
-                    s_cursorPosition = s_fxParamIdx % 6;
-                }
-            }
-            swCount[num] = 0;
+        else if (e.sw == input::LOWER_L) {
+            if (withUpperL)
+                saveData(); // 左上スイッチと同時長押しでデータ保存
+            else
+                fxChange(1);
         }
         break;
-    case 1: // 左下スイッチ --------------------------------------------------------
-        if (!LL_GPIO_IsInputPinSet(SW1_LOWER_L_GPIO_Port, SW1_LOWER_L_Pin)) {
-            swCount[num]++;
-            // 長押し 1回のみ動作
-            if (swCount[num] == LONG_PUSH_COUNT) {
-                // 左上スイッチが押されている場合
-                if (swCount[num - 1] > SHORT_PUSH_COUNT) {
-                    swCount[num - 1] = LONG_PUSH_COUNT; // 左上スイッチも長押し済み扱いにする
-                    saveData();                         // データ保存
-                }
-                else {
-                    s_fxChangeFlag = 1;
-                }
+    case input::REPEAT: // 長押し 繰り返し動作
+        if (e.sw == input::UPPER_R)
+            setParamValue(fp.value + 10);
+        else if (e.sw == input::LOWER_R)
+            setParamValue(fp.value - 10);
+        break;
+    case input::RELEASE: // 短押し 離した時の処理
+        switch (e.sw) {
+        case input::UPPER_L:
+            if (withUpperR)
+                setParamValue(fp.max); // 右上スイッチが押されている場合、パラメータ数値を最大値へ
+            else
+                s_fxParamIdx = (count + s_fxParamIdx - 1) % count; // パラメータ選択位置変更 0→最大値で循環
+            break;
+        case input::LOWER_L:
+            if (withLowerR)
+                setParamValue(fp.min); // 右下スイッチが押されている場合、パラメータ数値を最小値へ
+            else
+                s_fxParamIdx = (s_fxParamIdx + 1) % count; // パラメータ選択位置変更 最大値→0で循環
+            break;
+        case input::UPPER_R:
+            if (withLowerR)
+                setParamValue((fp.min + fp.max) / 2); // 右下スイッチが押されている場合、パラメータ数値を中間値へ
+            else if (withUpperL)
+                setParamValue(fp.max); // 左上スイッチが押されている場合、パラメータ数値を最大値へ
+            else
+                setParamValue(fp.value + 1);
+            break;
+        case input::LOWER_R:
+            if (withUpperR)
+                setParamValue((fp.min + fp.max) / 2); // 右上スイッチが押されている場合、パラメータ数値を中間値へ
+            else if (withLowerL)
+                setParamValue(fp.min); // 左下スイッチが押されている場合、パラメータ数値を最小値へ
+            else
+                setParamValue(fp.value - 1);
+            break;
+        default:
+            break;
+        }
+        s_cursorPosition = s_fxParamIdx % 6;
+        break;
+    default:
+        break;
+    }
+}
+/// @brief タップテンポ解除 テンポに合わせた時間・LFOはパラメータの値に戻る
+inline void tempoClear() {
+    s_tempo.clear();
+    g_tapTime = 0.0f;
+}
+/// @brief フットスイッチ操作
+/// 短押し: エフェクトオン・オフ、タップテンポ入力
+/// 長押し: 1倍 タップテンポモード・通常モード切替 2倍 プリセット 3倍 チューナー 5倍 レベルメーター 7倍 スペクトラム
+/// プリセットモード中の短押し: 次の保存済プリセットを呼び出す
+/// @param[in] e 操作イベント
+inline void footSwEvent(input::event const& e) {
+    switch (e.type) {
+    case input::LONG:
+        if (e.count == 1) {
+            if (s_currentMode == NORMAL) {
+#ifdef TAP_ENABLED
+                s_currentMode = TAP; // タップテンポモードへ
+#endif
+            }
+            else {
+                s_currentMode = NORMAL; // タップテンポモード、チューナーモード終了 テンポは保持する
             }
         }
-        else {
-            // 短押し 離した時の処理
-            if (swCount[num] >= SHORT_PUSH_COUNT && swCount[num] < LONG_PUSH_COUNT) {
-                // 右下スイッチが押されている場合、パラメータ数値を最小値へ
-                if (swCount[num + 2] > SHORT_PUSH_COUNT) {
-                    swCount[num + 2] = LONG_PUSH_COUNT + 1; // 右下スイッチは長押し済み扱いにする
-                    g_fxParam[s_fxParamIdx].value = g_fxParam[s_fxParamIdx].min;
-                }
-                // エフェクトパラメータ選択位置変更 最大値→0で循環
-                else {
-                    s_fxParamIdx = (s_fxParamIdx + 1) % fx::getParamTypeCount();
-                    s_cursorPosition = s_fxParamIdx % 6;
-                }
+        else if (e.count == 2) {
+            if (s_currentMode == TAP) {
+#ifdef PRESET_ENABLED
+                s_currentMode = PRESET; // プリセットモードへ エフェクト処理は継続
+#endif
             }
-            swCount[num] = 0;
         }
-        break;
-    case 2: // 右上スイッチ --------------------------------------------------------
-        if (!LL_GPIO_IsInputPinSet(SW2_UPPER_R_GPIO_Port, SW2_UPPER_R_Pin)) {
-            swCount[num]++;
-            if (swCount[num] >= LONG_PUSH_COUNT / 2 &&
-                (swCount[num] % (LONG_PUSH_COUNT / 4)) == 0) // 長押し 繰り返し動作
-            {
-                g_fxParam[s_fxParamIdx].value =
-                    std::min<int32_t>(g_fxParam[s_fxParamIdx].value + 10, g_fxParam[s_fxParamIdx].max);
+        else if (e.count == 3) {
+            if (s_currentMode == TAP || s_currentMode == PRESET) {
+#ifdef TUNER_ENABLED
+                s_currentMode = TUNER; // チューナーモードへ エフェクト処理は継続
+#endif
             }
         }
-        else {
-            // 短押し 離した時の処理
-            if (swCount[num] >= SHORT_PUSH_COUNT && swCount[num] < LONG_PUSH_COUNT) {
-                // 右下スイッチが押されている場合、パラメータ数値を中間値へ
-                if (swCount[num + 1] > SHORT_PUSH_COUNT) {
-                    swCount[num + 1] = LONG_PUSH_COUNT + 1; // 右下スイッチは長押し済み扱いにする
-                    g_fxParam[s_fxParamIdx].value = (g_fxParam[s_fxParamIdx].min + g_fxParam[s_fxParamIdx].max) / 2;
-                }
-                // 左上スイッチが押されている場合、パラメータ数値を最大値へ
-                else if (swCount[num - 2] > SHORT_PUSH_COUNT) {
-                    swCount[num - 2] = LONG_PUSH_COUNT + 1; // 左上スイッチは長押し済み扱いにする
-                    g_fxParam[s_fxParamIdx].value = g_fxParam[s_fxParamIdx].max;
-                }
-                else
-                    g_fxParam[s_fxParamIdx].value =
-                        std::min<int32_t>(g_fxParam[s_fxParamIdx].value + 1, g_fxParam[s_fxParamIdx].max);
+        else if (e.count == 5) {
+            if (s_currentMode == TAP || s_currentMode == PRESET || s_currentMode == TUNER) {
+#ifdef METER_ENABLED
+                s_currentMode = METER; // レベルメーターモードへ エフェクト処理は継続
+#endif
+            }
+        }
+        else if (e.count == 7) {
+            if (s_currentMode == TAP || s_currentMode == PRESET || s_currentMode == TUNER ||
+                s_currentMode == METER) {
+#ifdef SPECTRUM_ENABLED
+                s_currentMode = SPECTRUM; // スペクトラムモードへ エフェクト処理は継続
+                s_spectrumCycleMax = 0;
+#endif
             }
-            swCount[num] = 0;
         }
         break;
-    case 3: // 右下スイッチ --------------------------------------------------------
-        if (!LL_GPIO_IsInputPinSet(SW3_LOWER_R_GPIO_Port, SW3_LOWER_R_Pin)) {
-            swCount[num]++;
-            if (swCount[num] >= LONG_PUSH_COUNT / 2 &&
-                (swCount[num] % (LONG_PUSH_COUNT / 4)) == 0) // 長押し 繰り返し動作
-            {
-                {
-                    g_fxParam[s_fxParamIdx].value =
-                        std::max<int32_t>(g_fxParam[s_fxParamIdx].value - 10, g_fxParam[s_fxParamIdx].min);
-                }
+    case input::RELEASE: // 短押し 離した時の処理
+        if (s_currentMode == NORMAL) {
+            fx::toggle();
+        }
+        else if (s_currentMode == TAP) {
+            // 長押しでないことが確定した離した時に、押し始めた時刻でタップする
+            if (s_tempo.tap(e.time)) {
+                g_tapTime = s_tempo.beatMsec();
             }
         }
-        else {
-            // 短押し 離した時の処理
-            if (swCount[num] >= SHORT_PUSH_COUNT && swCount[num] < LONG_PUSH_COUNT) {
-                // 右上スイッチが押されている場合、パラメータ数値を中間値へ
-                if (swCount[num - 1] > SHORT_PUSH_COUNT) {
-                    swCount[num - 1] = LONG_PUSH_COUNT + 1; // 右上スイッチは長押し済み扱いにする
-                    g_fxParam[s_fxParamIdx].value = (g_fxParam[s_fxParamIdx].min + g_fxParam[s_fxParamIdx].max) / 2;
-                }
-                // 左下スイッチが押されている場合、パラメータ数値を最小値へ
-                else if (swCount[num - 2] > SHORT_PUSH_COUNT) {
-                    swCount[num - 2] = LONG_PUSH_COUNT + 1; // 左下スイッチは長押し済み扱いにする
-                    g_fxParam[s_fxParamIdx].value = g_fxParam[s_fxParamIdx].min;
+#ifdef PRESET_ENABLED
+        else if (s_currentMode == PRESET) {
+            // 次の保存済プリセットへ 未保存の番号は飛ばす
+            for (uint32_t i = 1; i <= PRESET_COUNT; i++) {
+                const uint8_t idx = (s_presetIdx + i) % PRESET_COUNT;
+                if (presetRecall(idx)) {
+                    s_presetIdx = idx;
+                    break;
                 }
-                else
-                    g_fxParam[s_fxParamIdx].value =
-                        std::max<int32_t>(g_fxParam[s_fxParamIdx].value - 1, g_fxParam[s_fxParamIdx].min);
             }
-            swCount[num] = 0;
         }
+#endif
         break;
     default:
         break;
     }
 }
-/// @brief フットスイッチ処理
-inline void footSwProcess() {
-    static uint32_t footSwCount = 0; // スイッチが押されている間カウントアップ
-    static float tmpTapTime = 0;     // タップ間隔時間 一時保存用
-
-    if (!LL_GPIO_IsInputPinSet(SW4_FOOT_GPIO_Port, SW4_FOOT_Pin)) {
-        footSwCount++;
-        // スイッチを押した時のタップ間隔時間を記録
-        if (s_currentMode == TAP && footSwCount == 4 * SHORT_PUSH_COUNT) {
-            tmpTapTime = (float)s_callbackCount * I2S_INTERRUPT_INTERVAL * 1000.0f;
-            s_callbackCount = 0;
-        }
-        // 長押し
-        if (footSwCount == 4 * LONG_PUSH_COUNT) {
-            if (s_currentMode == NORMAL) {
-#ifdef TAP_ENABLED
-                s_currentMode = TAP; // タップテンポモードへ
-                s_callbackCount = 0;
-#endif
-            }
-            else {
-                s_currentMode = NORMAL; // タップテンポモード、チューナーモード終了
-                g_tapTime = 0.0f;       // タップ時間リセット
-            }
-        }
-        if (footSwCount == 12 * LONG_PUSH_COUNT) // 3倍長押し
-        {
-            if (s_currentMode == TAP) {
 #ifdef TUNER_ENABLED
-                mute();
-                s_currentMode = TUNER; // チューナーモードへ
+/// @brief チューナーモード時のスイッチ操作 短押しのみ
+/// 左上・左下: 推定方法切替 右上・右下: 基準A音周波数変更
+/// @param[in] e 操作イベント
+inline void tunerSwEvent(input::event const& e) {
+    if (e.type != input::RELEASE)
+        return;
+    switch (e.sw) {
+    case input::UPPER_L:
+        tunerChangeMethod(-1);
+        break;
+    case input::LOWER_L:
+        tunerChangeMethod(1);
+        break;
+    case input::UPPER_R:
+        tunerChangeFreqA(1);
+        break;
+    case input::LOWER_R:
+        tunerChangeFreqA(-1);
+        break;
+    default:
+        break;
+    }
+}
+#endif
+/// @brief タップテンポモード時のスイッチ操作 短押しのみ
+/// いずれかのスイッチ: タップテンポ解除
+/// @param[in] e 操作イベント
+inline void tapSwEvent(input::event const& e) {
+    if (e.type == input::RELEASE)
+        tempoClear();
+}
+#ifdef PRESET_ENABLED
+/// @brief プリセットモード時のスイッチ操作
+/// 左上・左下: プリセット番号選択 右上: 呼出、長押しで現在の音を記録・保存
+/// 右下: 選択中のプリセットへモーフィング、もう一度押すと元の音へ戻る
+/// @param[in] e 操作イベント
+inline void presetSwEvent(input::event const& e) {
+    if (e.type == input::LONG) {
+        if (e.count == 1 && e.sw == input::UPPER_R)
+            presetStore(s_presetIdx);
+        return;
+    }
+    if (e.type != input::RELEASE)
+        return;
+    switch (e.sw) {
+    case input::UPPER_L:
+        s_presetIdx = (PRESET_COUNT + s_presetIdx - 1) % PRESET_COUNT;
+        break;
+    case input::LOWER_L:
+        s_presetIdx = (s_presetIdx + 1) % PRESET_COUNT;
+        break;
+    case input::UPPER_R:
+        presetRecall(s_presetIdx);
+        break;
+    case input::LOWER_R:
+        presetMorph(s_presetIdx);
+        break;
+    default:
+        break;
+    }
+}
 #endif
+#ifdef MIDI_ENABLED
+/// @brief MIDI受信 スイッチ読取タスクから呼ぶ
+/// 受信済のバイトを全てメッセージにし、使うものだけを積む 1バイトの処理時間は一定
+inline void midiPoll(midi::source const& in, uint32_t now) {
+    static midi::parser parser;
+    uint8_t buf[32];
+    uint32_t n = 0;
+    while ((n = in.read(in.context, buf, sizeof(buf))) > 0) {
+        for (uint32_t i = 0; i < n; i++) {
+            midi::message m;
+            if (!parser.feed(buf[i], now, m))
+                continue;
+            const uint8_t type = m.type();
+            if (type == midi::CLOCK || type == midi::START || type == midi::CONTINUE ||
+                ((type == midi::PROGRAM_CHANGE || type == midi::CONTROL_CHANGE) &&
+                    (MIDI_CHANNEL == 0 || m.channel() == MIDI_CHANNEL - 1))) {
+                s_midiQueue.push(m); // 満杯の場合は捨てる
             }
         }
     }
-    else {
-        // 短押し 離した時の処理
-        if (footSwCount >= 4 * SHORT_PUSH_COUNT && footSwCount < 4 * LONG_PUSH_COUNT) {
-            if (s_currentMode == NORMAL) {
+}
+/// @brief MIDIメッセージ処理 画面表示タスクから呼ぶ
+/// プログラムチェンジ: プリセット呼出・エフェクト切替 コントロールチェンジ: パラメータ値・オンオフ
+/// タイミングクロック: 1拍ごとにタップテンポへ
+/// @param[in] m メッセージ
+inline void midiEvent(midi::message const& m) {
+    switch (m.type()) {
+    case midi::PROGRAM_CHANGE:
+        if (m.data1 < MIDI_PC_FX_BASE) {
+            if (m.data1 < PRESET_COUNT && presetRecall(m.data1))
+                s_presetIdx = m.data1;
+        }
+        else if (m.data1 - MIDI_PC_FX_BASE < (int)fx::COUNT) {
+            fxChange(m.data1 - MIDI_PC_FX_BASE - g_fxNum);
+        }
+        break;
+    case midi::CONTROL_CHANGE:
+        if (m.data1 == MIDI_CC_ON) {
+            if ((m.data2 >= 64) != fx::isOn())
                 fx::toggle();
-            }
-            else if (s_currentMode == TAP) {
-                // スイッチを押した時記録していたタップ間隔時間をスイッチを離した時に反映させる
-                if (100.0f < tmpTapTime && tmpTapTime < MAX_TAP_TIME) {
-                    g_tapTime = tmpTapTime;
-                }
-                else {
-                    g_tapTime = 0.0f;
-                }
-            }
         }
-        footSwCount = 0;
+        else if (m.data1 == MIDI_CC_EXPRESSION) {
+            fx::setExpression((float)m.data2 * (1.0f / 127.0f));
+        }
+        else if (MIDI_CC_PARAM_BASE <= m.data1 && m.data1 - MIDI_CC_PARAM_BASE < fx::getParamTypeCount()) {
+            FxParam& fp = g_fxParam[m.data1 - MIDI_CC_PARAM_BASE];
+            fp.value = fp.min + ((fp.max - fp.min) * m.data2 + 63) / 127; // 0 ～ 127 → 最小値～最大値
+        }
+        break;
+    case midi::START:
+    case midi::CONTINUE:
+        s_midiClockCount = 0; // 次のクロックが拍の先頭
+        s_tempo.restart();
+        break;
+    case midi::CLOCK:
+        if (s_midiClockCount++ % midi::CLOCK_PPQN == 0 && s_tempo.tap(m.time))
+            g_tapTime = s_tempo.beatMsec();
+        break;
+    default:
+        break;
+    }
+}
+#endif
+/// @brief 操作イベント処理 溜まったイベントを全て処理する
+/// 画面表示タスクから呼ぶ パラメータ変更等の結果のみI2S割込みへ渡す
+inline void inputProcess() {
+    input::event e;
+    while (s_input.pop(e)) {
+        if (e.sw == input::FOOT) {
+            footSwEvent(e);
+        }
+        else if (s_currentMode == NORMAL) {
+            swEvent(e);
+        }
+        else if (s_currentMode == TAP) {
+            tapSwEvent(e); // テンポ解除
+        }
+#ifdef TUNER_ENABLED
+        else if (s_currentMode == TUNER) {
+            tunerSwEvent(e); // 推定方法切替、基準A音周波数変更
+        }
+#endif
+#ifdef PRESET_ENABLED
+        else if (s_currentMode == PRESET) {
+            presetSwEvent(e); // プリセット選択・呼出・記録
+        }
+#endif
+    }
+#ifdef MIDI_ENABLED
+    midi::message m;
+    while (s_midiQueue.pop(m)) {
+        midiEvent(m);
+    }
+#endif
+    if (s_savePending && s_saveState != SAVE_BUSY) {
+        saveData(); // 保存中に受けた保存要求 最新のデータを保存し直す
+    }
+    fx::setBeat(g_tapTime, s_tempo.seq(), s_tempo.beatPos(osKernelSysTick())); // 拍位置は受け渡し時点の値
+    fx::publish(); // 変更したパラメータをI2S割込みへ渡す
+}
+/// @brief スイッチ読取タスク
+/// 一定間隔でスイッチを読み取り、チャタリング除去・長押し判定を行って操作イベントを積む
+/// MIDI入力も同じ間隔で受信済のバイトを読み、受信時刻付きのメッセージを積む
+void inputTask(void const* argument) {
+#ifdef MIDI_ENABLED
+    midi::source const& midiIn = midi::uartSource();
+#endif
+    for (;;) {
+        uint8_t pressed = 0; // 押されている場合1 (プルアップのため入力Lowで押されている)
+        if (!LL_GPIO_IsInputPinSet(SW0_UPPER_L_GPIO_Port, SW0_UPPER_L_Pin))
+            pressed |= 1 << input::UPPER_L;
+        if (!LL_GPIO_IsInputPinSet(SW1_LOWER_L_GPIO_Port, SW1_LOWER_L_Pin))
+            pressed |= 1 << input::LOWER_L;
+        if (!LL_GPIO_IsInputPinSet(SW2_UPPER_R_GPIO_Port, SW2_UPPER_R_Pin))
+            pressed |= 1 << input::UPPER_R;
+        if (!LL_GPIO_IsInputPinSet(SW3_LOWER_R_GPIO_Port, SW3_LOWER_R_Pin))
+            pressed |= 1 << input::LOWER_R;
+        if (!LL_GPIO_IsInputPinSet(SW4_FOOT_GPIO_Port, SW4_FOOT_Pin))
+            pressed |= 1 << input::FOOT;
+        const uint32_t now = osKernelSysTick();
+        s_input.process(pressed, now);
+#ifdef MIDI_ENABLED
+        midiPoll(midiIn, now);
+#endif
+        osDelay(INPUT_SCAN_MSEC);
     }
 }
 /// @brief DMA用に上位16ビットと下位16ビットを入れ替える
@@ -346,109 +746,218 @@ inline int32_t swap16(int32_t x) { return (0x0000FFFF & x >> 16) | x << 16; }
 /// @brief メイン信号処理等
 /// @param[in] start_sample
 inline void mainProcess(uint16_t start_sample) {
-    DWT->CYCCNT = 0; // CPU使用率計算用 CPUサイクル数をリセット
+    s_blockStartCycle = DWT->CYCCNT; // CPU使用率計算用 開始時のCPUサイクル数を記録
+
+    // パラメータ受取り エフェクト種類が変わった場合は終了処理・初期化も行う
+    // ※ディレイメモリ確保前に信号処理に進まないように割り込み内で行う
+    const bool fxChanged = fx::receive();
 
     float xL[fx::BLOCK_SIZE] = {}; // Lch float計算用データ
     float xR[fx::BLOCK_SIZE] = {}; // Rch float計算用データ 不使用
 
+    float inPeak = 0.0f, inSumSq = 0.0f; // 入力レベルメーター用 ピーク・2乗和
     for (uint32_t i = 0; i < fx::BLOCK_SIZE; i++) {
         // データ配列の偶数添字計算 Lch（Rch不使用）
         uint16_t m = (start_sample + i) * 2;
         // 受信データを計算用データ配列へ 値を-1～+1(float)へ変更
         xL[i] = static_cast<float>(swap16(s_rxBuffer[m])) / 2147483648.0f;
+        inPeak = std::max(inPeak, fabsf(xL[i]));
+        inSumSq += xL[i] * xL[i];
     }
+    s_inMeter.add(inPeak, inSumSq, fx::BLOCK_SIZE, inPeak >= INPUT_CLIP_LEVEL);
 
-    if (s_currentMode == TUNER) {
 #ifdef TUNER_ENABLED
-        tunerProcess(xL, xR); // チューナー
+    if (s_currentMode == TUNER) {
+        tunerInput(xL); // チューナーへ入力音を渡す 解析は別タスク
+    }
 #endif
+
+    fx::process(xL, xR); // エフェクト処理 計算用配列を渡す
+
+#ifdef TUNER_ENABLED
+    if (TUNER_MUTE && s_currentMode == TUNER) {
+        memset(xL, 0, sizeof(xL)); // 出力ミュート
     }
-    else {
-        fx::process(xL, xR); // エフェクト処理 計算用配列を渡す
+#endif
+    if (s_muteRequest || fxChanged) {
+        memset(xL, 0, sizeof(xL)); // フラッシュ書込中、エフェクト切替時 出力ミュート
     }
+#ifdef OUTPUT_LIMITER_ENABLED
+    s_outLimiter.process(xL); // 高いLEVEL等でクリップしないよう、1ブロック単位でゲインを下げる
+#endif
 
+    float outPeak = 0.0f, outSumSq = 0.0f; // 出力レベルメーター用 ピーク・2乗和
+    bool outClipped = false;
     for (uint32_t i = 0; i < fx::BLOCK_SIZE; i++) {
         // オーバーフロー防止
         if (xL[i] < -1.0f) {
             xL[i] = -1.0f;
+            outClipped = true;
         }
         if (xL[i] > 0.99f) {
             xL[i] = 0.99f;
+            outClipped = true;
         }
+        outPeak = std::max(outPeak, fabsf(xL[i]));
+        outSumSq += xL[i] * xL[i];
         uint16_t m = (start_sample + i) * 2; // データ配列の偶数添字計算 Lch（Rch不使用）
         // 計算済データを送信バッファへ 値を32ビット整数へ戻す
         s_txBuffer[m] = swap16((int32_t)(2147483648.0f * xL[i]));
     }
+    s_outMeter.add(outPeak, outSumSq, fx::BLOCK_SIZE, outClipped);
+#ifdef SPECTRUM_ENABLED
+    if (s_currentMode == SPECTRUM) {
+        spectrumInput(xL); // スペクトラム表示へ出力音を渡す 解析は画面表示タスク
+    }
+#endif
 
-    s_callbackCount++; // I2Sの割り込みごとにカウントアップ タイマとして利用
-    footSwProcess();   // フットスイッチ処理
-    if (s_currentMode == NORMAL) {
-        swProcess(s_callbackCount % 4); // 割り込みごとにスイッチ処理するが、スイッチ1つずつを順番に行う
-        const uint32_t cyccnt = DWT->CYCCNT;
-        s_cpuUsageCycleMax[g_fxNum] = std::max<uint32_t>(s_cpuUsageCycleMax[g_fxNum], cyccnt); // CPU使用率計算用
+    if (s_currentMode == NORMAL && !fxChanged) { // エフェクト切替時は初期化を含むため除く
+        const uint8_t n = g_audioParam.fxNum;
+        const uint32_t cyccnt = DWT->CYCCNT - s_blockStartCycle;
+        s_cpuUsageCycleMax[n] = std::max<uint32_t>(s_cpuUsageCycleMax[n], cyccnt); // CPU使用率計算用
     }
-    // ※ディレイメモリ確保前に信号処理に進まないように割り込み内で行う
-    if (s_fxChangeFlag) {
-        fxChange(); // エフェクト変更
+#ifdef SPECTRUM_ENABLED
+    else if (s_currentMode == SPECTRUM) {
+        // 受け渡しを含む処理時間が1ブロックの時間内に収まっているか確認する
+        const uint32_t cyccnt = DWT->CYCCNT - s_blockStartCycle;
+        s_spectrumCycleMax = std::max<uint32_t>(s_spectrumCycleMax, cyccnt);
     }
+#endif
 }
 /// @brief エフェクト画面表示
+/// ステータス表示文字列を決め、描画は ui::fxScreen で行う
 inline void fxDisp() {
-    uint8_t fxPage = s_fxParamIdx / 6; // エフェクトパラメータページ番号
-    // ステータス表示------------------------------
-    if (s_callbackCount > STATUS_DISP_COUNT) // ステータス表示が変わり一定時間経過後、デフォルト表示に戻す
+    if (char const* save = saveStatusStr()) // 保存状態
+    {
+        s_statusStr = save;
+        s_statusTick = osKernelSysTick();
+    }
+    if (osKernelSysTick() - s_statusTick > STATUS_DISP_MSEC) // 一定時間経過後、デフォルト表示に戻す
     {
         s_statusStr = fx::getName(); // エフェクト名表示
     }
-    ssd1306_xyWriteStrWT(POS_STATUS.x, POS_STATUS.y, s_statusStr, Font_7x10);
-    // エフェクトパラメータ名称表示------------------------------
-    for (int i = 0; i < 6; i++) {
-        ssd1306_xyWriteStrWT(POS_PARAM_NAME[i].x, POS_PARAM_NAME[i].y, g_fxParam[i + 3 * fxPage].nameTxt, Font_7x10);
+    const float cpuUsagePercent = 100.0f * s_cpuUsageCycleMax[g_fxNum] / SystemCoreClock / I2S_INTERRUPT_INTERVAL;
+    ui::fxScreen({ s_fxParamIdx, s_cursorPosition, s_statusStr, static_cast<int32_t>(cpuUsagePercent),
+        osKernelSysTick() });
+}
+/// @brief TAP画面表示
+inline void tapDisp() { ui::tapScreen(g_tapTime, osKernelSysTick() - s_tempo.beatTime()); }
+#ifdef METER_ENABLED
+/// @brief レベルメーター画面表示 1チャンネル分
+/// ピーク（ピークホールド付き）とRMSを横棒で、クリップ回数とピークホールド値を数値で表示する
+inline void meterChannelDisp(levelMeter<METER_WINDOW> const& meter, MeterDisp& d) {
+    constexpr uint32_t holdFrames = METER_PEAK_HOLD_MSEC / DISP_INTERVAL_MSEC; // ピークホールド 画面更新回数
+    constexpr float decayDb = 0.5f;                                            // ピークホールド後の下降 dB/画面更新
+
+    float peak = 0.0f, rms = 0.0f;
+    meter.get(peak, rms);
+    const float peakDb = std::max(gainToDb(peak), -METER_RANGE_DB);
+    const float rmsDb = std::max(gainToDb(rms), -METER_RANGE_DB);
+
+    // ピークホールド
+    if (peakDb >= d.holdDb) {
+        d.holdDb = peakDb;
+        d.holdCount = holdFrames;
     }
-    // エフェクトパラメータ数値表示------------------------------
-    for (int i = 0; i < 6; i++) {
-        fx::setParamStr(i + 6 * fxPage); // パラメータ数値を文字列に変換
-        ssd1306_R_xyWriteStrWT(
-            POS_PARAM_VALUE[i].x, POS_PARAM_VALUE[i].y, g_fxParam[i + 3 * fxPage].valueTxt, Font_11x18);
+    else if (d.holdCount > 0) {
+        d.holdCount--;
     }
-    // エフェクトパラメータページ番号表示------------------------------
-    {
-        char str[8] = { 0 };
-        snprintf(str, sizeof(str), "P%d", fxPage + 1);
-        ssd1306_xyWriteStrWT(POS_PAGE.x, POS_PAGE.y, str, Font_7x10);
-    }
-    // カーソル表示(選択したパラメータの白黒反転) ------------------------------
-    for (int dx = 0; dx < 62; dx++) {
-        for (int dy = 0; dy < 16; dy++) {
-            ssd1306_InvertPixel(POS_CURSOR[s_cursorPosition].x + dx, POS_CURSOR[s_cursorPosition].y + dy);
-        }
+    else {
+        d.holdDb = std::max(d.holdDb - decayDb, peakDb);
     }
-    // CPU使用率表示------------------------------
-    {
-        auto cpuUsagePercent = 100.0f * s_cpuUsageCycleMax[g_fxNum] / SystemCoreClock / I2S_INTERRUPT_INTERVAL;
-        char str[8] = { 0 };
-        snprintf(str, sizeof(str), "%2d%%", static_cast<int>(cpuUsagePercent));
-        ssd1306_xyWriteStrWT(POS_PERCENT.x, POS_PERCENT.y, str, Font_7x10);
+
+    // dB → 横棒の長さ
+    auto toLength = [](float db) {
+        return static_cast<int16_t>((db + METER_RANGE_DB) * (METER_WIDTH / METER_RANGE_DB));
+    };
+    d.name.set(d.nameTxt);
+    d.peak.set(toLength(peakDb), d.holdDb > -METER_RANGE_DB ? toLength(d.holdDb) : -1);
+    d.rms.set(toLength(rmsDb));
+    d.clip.set(meter.getClipCount() - d.clipBase);
+    d.hold.set(static_cast<int32_t>(floorf(d.holdDb + 0.5f)));
+}
+/// @brief レベルメーター画面表示
+inline void meterDisp() {
+    s_meterTitle.set("LEVEL");
+    meterChannelDisp(s_inMeter, s_meterDisp[0]);
+    meterChannelDisp(s_outMeter, s_meterDisp[1]);
+}
+#endif
+#ifdef SPECTRUM_ENABLED
+/// @brief スペクトラムアナライザー画面表示
+/// 解析は一定間隔ごと、表示は画面更新ごとに行い、棒は一定の速さで下げる
+inline void spectrumDisp() {
+    constexpr int16_t fall = 2; // 棒が下がる速さ ピクセル/画面更新
+
+    static float bandDb[SPECTRUM_BANDS] = {};
+    spectrumUpdate(bandDb); // 解析しなかった場合は前回の結果のまま
+
+    s_spectrumTitle.set("SPECTRUM");
+    for (uint32_t b = 0; b < SPECTRUM_BANDS; b++) {
+        const int16_t len =
+            static_cast<int16_t>((bandDb[b] + SPECTRUM_RANGE_DB) * (SPECTRUM_HEIGHT / SPECTRUM_RANGE_DB));
+        s_spectrumBars.set(b, std::max<int16_t>(len, s_spectrumBars.get(b) - fall));
     }
+    // 出力音の受け渡しを含むI2S割込み処理のCPU使用率
+    auto cpuUsagePercent = 100.0f * s_spectrumCycleMax / SystemCoreClock / I2S_INTERRUPT_INTERVAL;
+    s_spectrumPercent.set(static_cast<int>(cpuUsagePercent));
 }
-/// @brief TAP画面表示
-inline void tapDisp() {
-    ssd1306_xyWriteStrWT(0, 0, "TAP TEMPO", Font_7x10);
-    std::string tmpStr = std::to_string((uint16_t)g_tapTime);
-    ssd1306_R_xyWriteStrWT(114, 0, (tmpStr + " ms").c_str(), Font_7x10); // タップ間隔時間を表示
-    if (g_tapTime > 60.0f) {
-        tmpStr = std::to_string((uint16_t)(60000.0f / g_tapTime)); // bpmを計算
+#endif
+#ifdef PRESET_ENABLED
+/// @brief プリセット画面表示
+/// 選択中のプリセット番号、記録されているエフェクト名、モーフィング状態、保存状態を表示する
+inline void presetDisp() {
+    char const* statusStr = saveStatusStr();
+    Preset const& p = s_presets[s_presetIdx];
+    s_presetTitle.set("PRESET");
+    s_presetNumber.set(s_presetIdx + 1);
+    s_presetActiveLabel.set(s_presetIdx == s_presetActive ? "ACTIVE" : "");
+    s_presetFxName.set((0 <= p.fxNum && p.fxNum < (int16_t)fx::COUNT) ? fx::getName(p.fxNum) : "EMPTY");
+    if (s_morphSlot < PRESET_COUNT) {
+        char str[20];
+        const int32_t percent = static_cast<int32_t>(fx::getMorphPos() * 100.0f + 0.5f);
+        s_presetMorph.set(strFormat(str).str("MORPH P").dec(s_morphSlot + 1).ch(' ').dec(percent, 3).ch('%').c_str());
     }
-    ssd1306_R_xyWriteStrWT(103, 20, (tmpStr + " bpm").c_str(), Font_16x26); // bpm表示
-
-    uint16_t blinkCount = 1 + g_tapTime / (1000 * I2S_INTERRUPT_INTERVAL);   // 点滅用カウント数
-    if (s_callbackCount % blinkCount < 60 / (1000 * I2S_INTERRUPT_INTERVAL)) // 60msバーを表示、点滅
-    {
-        for (int i = 0; i < 112; i++) {
-            ssd1306_DrawPixel(8 + i, 47, White);
-            ssd1306_DrawPixel(8 + i, 48, White);
-        }
+    else {
+        s_presetMorph.set("");
+    }
+    s_presetUpdateUsec.set(static_cast<int32_t>(1000000.0f * fx::getUpdateCycleMax(false) / SystemCoreClock));
+    s_presetStatus.set(statusStr ? statusStr : "");
+}
+#endif
+/// @brief 画面全消去 各ウィジェットは未描画の状態に戻す
+inline void dispClear() {
+    ssd1306_Fill(Black);
+    ui::screenInvalidate(); // エフェクト画面・TAP画面
+#ifdef METER_ENABLED
+    s_meterTitle.invalidate();
+    for (int i = 0; i < 2; i++) {
+        MeterDisp& d = s_meterDisp[i];
+        d.name.invalidate();
+        d.peak.invalidate();
+        d.rms.invalidate();
+        d.clip.invalidate();
+        d.hold.invalidate();
     }
+    // クリップ回数は画面を表示するたびに0から数える
+    s_meterDisp[0].clipBase = s_inMeter.getClipCount();
+    s_meterDisp[1].clipBase = s_outMeter.getClipCount();
+#endif
+#ifdef SPECTRUM_ENABLED
+    s_spectrumTitle.invalidate();
+    s_spectrumPercent.invalidate();
+    s_spectrumBars.invalidate();
+    spectrumClear(); // 前回表示時の古い音を解析しない
+#endif
+#ifdef PRESET_ENABLED
+    s_presetTitle.invalidate();
+    s_presetNumber.invalidate();
+    s_presetActiveLabel.invalidate();
+    s_presetFxName.invalidate();
+    s_presetMorph.invalidate();
+    s_presetUpdateUsec.invalidate();
+    s_presetStatus.invalidate();
+#endif
 }
 /// @brief LED表示
 inline void ledDisp() {
@@ -491,14 +1000,14 @@ void mainInit() {
     DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
 
     // ディスプレイ初期化
-    ssd1306_Init(&hi2c1);
+    ssd1306_Init(ssd1306_I2cBackend(&hi2c1));
 
 #if 0
     // ディスプレイ点灯確認
     ssd1306_Fill(White);
     ssd1306_SetCursor(3, 22);
     ssd1306_WriteString(PEDAL_NAME, Font_11x18, Black);
-    ssd1306_UpdateScreen(&hi2c1);
+    ssd1306_UpdateScreen();
 
     // LED点灯確認
     LL_GPIO_SetOutputPin(LED_RED_GPIO_Port, LED_RED_Pin);
@@ -526,7 +1035,7 @@ void mainInit() {
     while (__HAL_I2S_GET_FLAG(&hi2s2, I2S_FLAG_FRE) || __HAL_I2S_GET_FLAG(&hi2s3, I2S_FLAG_FRE)) {
         ssd1306_SetCursor(0, 0);
         ssd1306_WriteString("ERROR", Font_11x18, Black);
-        ssd1306_UpdateScreen(&hi2c1);
+        ssd1306_UpdateScreen();
         LL_GPIO_ResetOutputPin(CODEC_RST_GPIO_Port, CODEC_RST_Pin);
         osDelay(100);
         LL_GPIO_SetOutputPin(CODEC_RST_GPIO_Port, CODEC_RST_Pin);
@@ -539,7 +1048,7 @@ void mainInit() {
         !LL_GPIO_IsInputPinSet(SW4_FOOT_GPIO_Port, SW4_FOOT_Pin)) {
         ssd1306_SetCursor(0, 0);
         ssd1306_WriteString("ERASE ALL DATA", Font_7x10, Black);
-        ssd1306_UpdateScreen(&hi2c1);
+        ssd1306_UpdateScreen();
         eraseData();
         osDelay(1000);
     }
@@ -547,14 +1056,36 @@ void mainInit() {
     // 保存済パラメータ読込
     loadData();
 
-    // 初期エフェクト読込
-    fx::init();
+    // 初期エフェクト読込 I2S割込みへ渡し、割込み内で初期化する
+    fx::loadParam(g_fxAllData[g_fxNum]);
+    fx::publish();
+
+#ifdef TUNER_ENABLED
+    // チューナー解析タスク開始
+    tunerInit();
+#endif
+#ifdef SPECTRUM_ENABLED
+    // スペクトラム表示 帯域計算
+    spectrumInit();
+#endif
+    // 保存タスク 他のタスクより低い優先度で書き込む
+    osThreadDef(storageTask, storageTask, osPriorityLow, 0, 256);
+    s_storageTaskId = osThreadCreate(osThread(storageTask), NULL);
+
+    // スイッチ・MIDI読取タスク 操作イベント・MIDIメッセージはメインループで処理する
+    osThreadDef(inputTask, inputTask, osPriorityBelowNormal, 0, 192);
+    osThreadCreate(osThread(inputTask), NULL);
 }
 
 /// @brief メインループ
 void mainLoop() {
-
-    ssd1306_Fill(Black); // 一旦画面表示を全て消す
+    inputProcess(); // スイッチ操作イベント処理
+    // 動作モードが変わった場合のみ画面表示を全て消す
+    // チューナー画面は解析結果で毎回全体が変わるため、毎回消去して描き直す
+    if (s_dispMode != s_currentMode || s_currentMode == TUNER) {
+        dispClear();
+        s_dispMode = s_currentMode;
+    }
     switch (s_currentMode) {
     case NORMAL:
         fxDisp();
@@ -567,9 +1098,26 @@ void mainLoop() {
         tunerDisp();
         break;
 #endif
+#ifdef METER_ENABLED
+    case METER:
+        meterDisp();
+        break;
+#endif
+#ifdef SPECTRUM_ENABLED
+    case SPECTRUM:
+        spectrumDisp();
+        break;
+#endif
+#ifdef PRESET_ENABLED
+    case PRESET:
+        presetDisp();
+        break;
+#endif
+    default:
+        break;
     }
-    ssd1306_UpdateScreen(&hi2c1); // 画面更新
-    // osDelay(10);
+    ssd1306_UpdateScreen();      // 画面更新 DMA転送開始のみ行い、転送中に次の画面を描画する
+    osDelay(DISP_INTERVAL_MSEC); // 画面更新間隔 待つ間は他のタスクへ
     ledDisp();
 }
 
@@ -582,3 +1130,9 @@ void HAL_I2S_RxHalfCpltCallback(I2S_HandleTypeDef* hi2s) {
 void HAL_I2S_RxCpltCallback(I2S_HandleTypeDef* hi2s) {
     mainProcess(fx::BLOCK_SIZE); // 16 ～ 31 を処理(BLOCK_SIZE ～ BLOCK_SIZE*2-1)
 }
+
+/// @brief I2C(画面)のDMA送信が完了したときの割り込み
+void HAL_I2C_MemTxCpltCallback(I2C_HandleTypeDef* hi2c) { ssd1306_I2cTxCpltCallback(hi2c); }
+
+/// @brief I2C(画面)の送信エラー時の割り込み
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef* hi2c) { ssd1306_I2cTxErrorCallback(hi2c); }